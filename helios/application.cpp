@@ -7,6 +7,15 @@
 using hr_clock = std::chrono::high_resolution_clock;
 #include <ctime>
 #include <iomanip>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+#include <future>
+#include <fstream>
+#include <regex>
+
+#include "rapidjson/prettywriter.h"
+#include "rapidjson/stringbuffer.h"
 
 #ifdef _WIN32
 #include "Windows.h"
@@ -19,24 +28,184 @@ static constexpr uint32_t OPENGL_MAJOR_VERSION = 4;
 static constexpr uint32_t OPENGL_MINOR_VERSION = 3;
 static constexpr const char* WINDOW_NAME = "Helios";
 
+/* Headless frames are rendered with a fixed simulated time step, so every run produces the same images */
+static constexpr float HEADLESS_TIME_STEP = 1.f / 60.f;
+/* Number of frames the readback of a headless frame lags behind its rendering, to never stall the GPU */
+static constexpr uint32_t READBACK_LATENCY = 2;
+/* Like a swap chain would, the benchmark never lets the CPU run more than this many frames ahead of the GPU */
+static constexpr uint32_t BENCHMARK_FRAMES_IN_FLIGHT = 2;
+static constexpr uint64_t BENCHMARK_FENCE_TIMEOUT = 1000000000;
+
+/* OpenGL 4.3 guarantees 1024 invocations per work group, so this size always fits */
+static constexpr uint32_t DEFAULT_GROUP_SIZE = 32;
+/* Shapes timed by the autotuner, from the smallest to the largest */
+static const glm::uvec2 GROUP_SIZE_CANDIDATES[] = { { 8, 4 }, { 8, 8 }, { 16, 8 }, { 8, 16 }, { 32, 4 }, { 16, 16 }, { 32, 8 },
+													{ 64, 4 }, { 32, 16 }, { 32, 32 } };
+static constexpr uint32_t AUTOTUNE_WARMUP_FRAMES = 4;
+static constexpr uint32_t AUTOTUNE_FRAMES = 16;
+
+/* Pixels covered by a texel of the finest level of the cone prepass */
+static constexpr uint32_t CONE_FINEST_FACTOR = 4;
+/* Image units of the cone prepass, the output image of the raymarch program is bound to the first */
+static constexpr uint32_t CONE_INPUT_UNIT = 1;
+static constexpr uint32_t CONE_OUTPUT_UNIT = 2;
+
+// Mirrored by the _HL_REPROJECTION_* constants in raymarch_main.comp
+static constexpr int32_t REPROJECTION_NONE = 0;
+static constexpr int32_t REPROJECTION_WRITE = 1;
+static constexpr int32_t REPROJECTION_START = 2;
+/* Image units of the reprojection */
+static constexpr uint32_t DEPTH_UNIT = 3;
+static constexpr uint32_t REPROJECTED_DEPTH_UNIT = 4;
+/* Texels no point of the previous frame falls into keep this value */
+static constexpr uint32_t NO_DEPTH = 0xFFFFFFFF;
+
+// Mirrored by the _HL_RECONSTRUCTION_* constants in raymarch_main.comp
+static constexpr int32_t RECONSTRUCTION_SPATIAL = 1;
+static constexpr int32_t RECONSTRUCTION_TEMPORAL = 2;
+/* Image units of the rebuilt frames */
+static constexpr uint32_t PREVIOUS_FRAME_UNIT = 5;
+static constexpr uint32_t NEXT_FRAME_UNIT = 6;
+/* Order of the pixels of every 2x2 block traced by the quarter pattern, each one diagonal to the one before */
+static constexpr int32_t QUARTER_PHASES[] = { 0, 3, 1, 2 };
+
+/* Frames presented after any event when there is nothing to render, so the GUI reacts to it and settles again */
+static constexpr uint32_t IDLE_GUI_FRAMES = 3;
+
+static constexpr int32_t MAX_ANTIALIASING_SAMPLES = 8;
+static constexpr uint32_t GEOMETRY_UNIT = 7;
+/* The groups of the indirect dispatch along x, y and z, then the number of pixels on an edge, before the pixels themselves */
+static constexpr uint32_t EMPTY_EDGE_LIST[] = { 0, 1, 1, 0 };
+
+/* Element of the Halton sequence in the given base, evenly spread over [0, 1) for any number of consecutive indices */
+static float halton(uint32_t index, uint32_t base)
+{
+	float result = 0.f;
+	float fraction = 1.f;
+
+	for (uint32_t i = index; i > 0; i /= base)
+	{
+		fraction /= static_cast<float>(base);
+		result += fraction * static_cast<float>(i % base);
+	}
+
+	return result;
+}
+
+static bool parse_interlace_mode(const std::string& name, interlace_mode& mode)
+{
+	if (name == "none")
+		mode = interlace_mode::NONE;
+	else if (name == "half")
+		mode = interlace_mode::HALF;
+	else if (name == "quarter")
+		mode = interlace_mode::QUARTER;
+	else
+		return false;
+
+	return true;
+}
+
+static uint32_t cone_factor(size_t level, size_t levels)
+{
+	return CONE_FINEST_FACTOR << (levels - 1 - level);
+}
+
+/* The defines must follow the version directive, which is the first line of the source */
+static void insert_defines(std::string& source, const std::string& defines)
+{
+	size_t version_end = source.find('\n');
+	source.insert(version_end != std::string::npos ? version_end + 1 : source.size(), defines);
+}
+
 application::application() : _config(), _window(nullptr), _render_context(nullptr), _compiler_context(nullptr),
-	_fullscreen_quad(invalid_handle), _offscreen_buffer(invalid_handle), _raymarch_program(invalid_handle),
-	_copy_program(invalid_handle), _uniforms(), _should_run(false), _initialized(false), _render_gui(true),
-	_raymarch_watcher(), _temp_program(invalid_handle), _swap_program(false), _raymarch(), _camera(), _light(),
-	_scene(), _postprocess()
+	_headless(), _headless_framebuffer(invalid_handle), _headless_color_buffer(invalid_handle), _readback_buffers(),
+	_cpu_renderer(), _cpu_scene(),
+	_fullscreen_quad(invalid_handle), _offscreen_buffer(invalid_handle), _cone_levels(),
+	_depth_buffer(invalid_handle), _reprojected_depth(invalid_handle), _reprojection_framebuffer(invalid_handle),
+	_rebuilt_frames{ { invalid_handle, invalid_handle } }, _next_rebuilt_frame(0),
+	_geometry_buffer(invalid_handle), _edge_list(invalid_handle), _raymarch_program(),
+	_raymarch_key(0), _raymarch_variants(), _requested_variant(), _active_program(), _group_size(0),
+	_copy_program(invalid_handle), _uniform_buffer(), _user_uniform_buffer(), _dispatch_buffer(), _dispatch(), _program_cache(), _profiler(), _statistics(), _resolution(), _sdf_bake(), _uniforms(), _should_run(false), _initialized(false), _render_gui(true),
+	_wake_event(0), _gui_frames(0),
+	_raymarch_watcher(), _rebuild_queue(), _raymarch(), _camera(), _light(),
+	_scene(), _postprocess(), _dynamic_resolution(), _bake(), _time_running(), _previous_camera(), _depth_key(), _scene_reads_time(false),
+	_interlaced_frames(0), _rebuilt_size(0), _frame_key(), _settling_frames(0), _accumulated_samples(0), _time_paused(false),
+	_bake_key()
 {
 	// NOTE(Corralx): Nothing to do, everything is postponed to init()
 }
 
-bool application::init()
+bool application::init(const config_t& config)
 {
 	if (_initialized)
 		return true;
 
-	_config = load_config();
+	_config = config;
+	bool headless = _config.headless.enabled;
+
+	/* Offscreen runs are compared and measured frame by frame, so they always render at the configured resolution */
+	_dynamic_resolution.enabled = _config.dynamic_resolution.enabled && !headless;
+	_dynamic_resolution.target_ms = _config.dynamic_resolution.target_ms;
+	_dynamic_resolution.min_scale = _config.dynamic_resolution.min_scale;
+	_dynamic_resolution.max_scale = _config.dynamic_resolution.max_scale;
+
+	if (!parse_interlace_mode(_config.interlacing.mode, _raymarch.interlacing))
+		std::cout << "ERROR: Interlacing mode " << _config.interlacing.mode << " is unknown, every pixel is traced!" << std::endl;
+
+	_raymarch.antialiasing_samples = static_cast<int32_t>(std::min(_config.antialiasing.samples, static_cast<uint32_t>(MAX_ANTIALIASING_SAMPLES)));
+	_raymarch.progressive = _config.progressive.enabled;
+	_raymarch.progressive_samples = static_cast<int32_t>(std::max(_config.progressive.samples, 1u));
+	_bake.min = _config.bake.min;
+	_bake.max = _config.bake.max;
+
+	/* The rebuilt and the supersampled pixels would never match the ones of the CPU reference */
+	if (headless && _config.headless.compare)
+	{
+		_raymarch.interlacing = interlace_mode::NONE;
+		_raymarch.antialiasing_samples = 0;
+	}
+
+	/* The CPU reference tracer does not need any OpenGL context, only the user uniforms declared in the scene */
+	if (headless && (_config.headless.cpu || _config.headless.compare))
+	{
+		/* The reference tracer marches every ray on its own without any SIMD, exactly like the compute shader */
+		const packet_kernels_t* kernels = nullptr;
+		const std::string& isa = _config.headless.cpu_isa;
+
+		if (isa == "auto")
+		{
+			kernels = best_packet_kernels();
+		}
+		else if (isa != "reference")
+		{
+			kernels = find_packet_kernels(isa.c_str());
+			if (!kernels)
+			{
+				std::cout << "ERROR: Instruction set " << isa << " is unknown or not supported by this CPU!" << std::endl;
+				kernels = best_packet_kernels();
+			}
+		}
+
+		_cpu_renderer = std::make_unique<cpu_renderer>(_config.headless.cpu_threads, kernels);
+	}
+
+	if (headless && _config.headless.cpu)
+	{
+		std::string cs_source;
+		scene_program_t scene_program;
+		if (!assemble_raymarch_source(cs_source) || !extract_uniform(cs_source, _uniforms, &scene_program) ||
+			!setup_cpu_scene(std::move(scene_program)))
+			return false;
+
+		setup_scene();
+
+		_initialized = true;
+		return true;
+	}
 
 	// NOTE(Corralx): If something fails, everything else after will fail too, but that's not a problem
-	bool ret = open_window();
+	bool ret = headless ? create_headless_context(_headless, OPENGL_MAJOR_VERSION, OPENGL_MINOR_VERSION) : open_window();
 	assert(ret);
 
 	ret &= initialize_opengl();
@@ -45,7 +214,10 @@ bool application::init()
 	ret &= create_opengl_resources();
 	assert(ret);
 
-	ret &= imgui_init(_window);
+	if (headless)
+		ret &= create_headless_resources();
+	else
+		ret &= imgui_init(_window);
 	assert(ret);
 
 	if (!ret)
@@ -55,24 +227,48 @@ bool application::init()
 	}
 
 	/* Init the file watcher */
-	_raymarch_watcher.path = fs::current_path() / _config.assets.folder / _config.assets.raymarch_program.scene_file;
+	fs::path full_assets_path = fs::current_path() / _config.assets.folder;
+	_raymarch_watcher.paths =
+	{
+		full_assets_path / _config.assets.raymarch_program.base_file,
+		full_assets_path / _config.assets.raymarch_program.library_file,
+		full_assets_path / _config.assets.raymarch_program.scene_file,
+		full_assets_path / _config.assets.raymarch_program.main_file,
+		get_config_path()
+	};
 	_raymarch_watcher.interval = _config.assets.raymarch_program.scene_reload_interval;
-	_raymarch_watcher.callback = [this]()
+	_raymarch_watcher.debounce = _config.assets.raymarch_program.scene_reload_debounce;
+	_raymarch_watcher.callback = [this](const std::vector<fs::path>& changed)
 	{
 		/* Print formatted time */
 		std::time_t current_time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-		std::cout << std::put_time(std::localtime(&current_time), "[%T]") << " Recompiling scene..." << std::endl;
+		auto timestamp = std::put_time(std::localtime(&current_time), "[%T]");
 
-		/* Make sure a valid GL context is current in the calling thread */
-		SDL_GL_MakeCurrent(_window, _compiler_context);
+		// The configuration is only read at startup, every other file is part of the raymarch program
+		auto config_path = get_config_path();
+		if (std::find(changed.begin(), changed.end(), config_path) != changed.end())
+			std::cout << timestamp << " WARNING: The configuration changed, restart to apply it!" << std::endl;
 
-		_temp_program = recompile_raymarch_program();
+		if (std::any_of(changed.begin(), changed.end(), [&config_path](const fs::path& p) { return p != config_path; }))
+		{
+			std::cout << timestamp << " Recompiling scene..." << std::endl;
 
-		if (_temp_program != invalid_handle)
-			_swap_program = true;
+			/* Compiled on the worker of the queue, the frame loop picks up the result once it is ready */
+			_rebuild_queue.request();
+		}
 	};
 
-	/* Scene setup */
+	setup_scene();
+
+	if (_config.group_size.autotune)
+		autotune_group_size();
+
+	_initialized = true;
+	return true;
+}
+
+void application::setup_scene()
+{
 	_camera.focal_length = 1.67f;
 	_camera.position = { .0f, 2.f, 5.f };
 	_camera.view = { .0f, -.5f, -1.f };
@@ -85,23 +281,56 @@ bool application::init()
 	_scene.floor_height = -.3f;
 	_scene.fog_color = { .6f, .7f, .8f };
 	_scene.sky_color = { .8f, .9f, 1.f };
-
-	_initialized = true;
-	return true;
 }
 
 void application::cleanup()
 {
-	if (_raymarch_program != invalid_handle)
-		glDeleteProgram(_raymarch_program);
+	if (_config.headless.enabled && _config.headless.cpu)
+		return;
+
+	release_raymarch_variants();
+	release_raymarch_program(_raymarch_program);
 	if (_copy_program != invalid_handle)
 		glDeleteProgram(_copy_program);
+	destroy_uniform_buffer(_uniform_buffer);
+	destroy_uniform_buffer(_user_uniform_buffer);
+	destroy_dispatch_buffer(_dispatch_buffer);
+	_profiler.destroy();
+	_statistics.destroy();
+	_sdf_bake.destroy();
 
 	if (_offscreen_buffer != invalid_handle)
 		glDeleteTextures(1, &_offscreen_buffer);
+	if (!_cone_levels.empty())
+		glDeleteTextures(static_cast<int32_t>(_cone_levels.size()), _cone_levels.data());
+	if (_reprojection_framebuffer != invalid_handle)
+		glDeleteFramebuffers(1, &_reprojection_framebuffer);
+	if (_reprojected_depth != invalid_handle)
+		glDeleteTextures(1, &_reprojected_depth);
+	if (_depth_buffer != invalid_handle)
+		glDeleteTextures(1, &_depth_buffer);
+	if (_rebuilt_frames[0] != invalid_handle)
+		glDeleteTextures(static_cast<int32_t>(_rebuilt_frames.size()), _rebuilt_frames.data());
+	if (_geometry_buffer != invalid_handle)
+		glDeleteTextures(1, &_geometry_buffer);
+	if (_edge_list != invalid_handle)
+		glDeleteBuffers(1, &_edge_list);
 	if (_fullscreen_quad != invalid_handle)
 		glDeleteVertexArrays(1, &_fullscreen_quad);
 
+	if (!_readback_buffers.empty())
+		glDeleteBuffers(static_cast<int32_t>(_readback_buffers.size()), _readback_buffers.data());
+	if (_headless_color_buffer != invalid_handle)
+		glDeleteTextures(1, &_headless_color_buffer);
+	if (_headless_framebuffer != invalid_handle)
+		glDeleteFramebuffers(1, &_headless_framebuffer);
+
+	if (_config.headless.enabled)
+	{
+		destroy_headless_context(_headless);
+		return;
+	}
+
 	imgui_shutdown();
 
 	if (_render_context)
@@ -119,38 +348,135 @@ void application::run()
 	if (!_initialized)
 		return;
 
+	if (_config.benchmark.enabled)
+	{
+		run_benchmark();
+		return;
+	}
+
+	if (_config.headless.enabled)
+	{
+		run_headless();
+		return;
+	}
+
+	/* The compiler context is only ever current on the worker of the queue, which wakes up the loop once a build is ready */
+	_wake_event = SDL_RegisterEvents(1);
+	_rebuild_queue.start([this]() { make_compiler_context_current(); },
+						 [this](raymarch_build_t& build) { return build_raymarch_program(build); },
+						 [this]()
+						 {
+							 SDL_Event event{};
+							 event.type = _wake_event;
+							 SDL_PushEvent(&event);
+						 });
 	_raymarch_watcher.start();
 	_should_run = true;
-	auto start_time = hr_clock::now();
+	auto last_time = hr_clock::now();
+	bool rendered = true;
+	_gui_frames = IDLE_GUI_FRAMES;
 
 	while (_should_run)
 	{
+		/* An idle frame might have waited for events, which is not part of the time the frame took */
+		_profiler.begin_frame();
+
 		/* Process OS Events */
-		process_messages();
+		if (process_messages())
+			_gui_frames = IDLE_GUI_FRAMES;
 
-		/* Swap the program if it has been modified */
+		/* Swap the program if it has been modified, and march with the variant of the current settings once it is built */
 		swap_raymarch_program();
+		select_raymarch_program(false);
+
+		auto now = hr_clock::now();
+		if (!_time_paused)
+			_time_running += std::chrono::duration_cast<millis_interval>(now - last_time);
+		last_time = now;
+
+		/* Only the frames rendering the view again tell how expensive it is, and the scale only changes while it does */
+		if (rendered)
+			_resolution.update(_dynamic_resolution, _profiler.last(), _profiler.frame());
+		else
+			_resolution.skip(_profiler.frame());
+
+		/* The march reads the bake only once it is complete, so the user uniforms come first to tell if it is still the right one */
+		update_user_uniforms();
+		update_default_uniforms();
+		bool baking = update_bake(_config.bake.layers_per_frame);
+
+		/* The interlaced patterns need a full cycle to trace every pixel of a still view once */
+		if (frame_changed())
+		{
+			_settling_frames = _raymarch.interlacing == interlace_mode::QUARTER ? 4 :
+							   _raymarch.interlacing == interlace_mode::HALF ? 2 : 1;
+			_accumulated_samples = 0;
+		}
 
-		_time_running = std::chrono::duration_cast<millis_interval>(hr_clock::now() - start_time);
+		/* Actual rendering, a still view is only refined and once that is done too the last image is presented again */
+		bool refine = _raymarch.progressive && _raymarch.debug == debug_mode::NONE &&
+					  _accumulated_samples < static_cast<uint32_t>(_raymarch.progressive_samples);
+		rendered = _settling_frames > 0;
 
-		/* Actual rendering */
-		raymarch();
-		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-		copy_to_framebuffer();
+		if (rendered)
+		{
+			_profiler.begin(gpu_pass::RAYMARCH);
+			raymarch();
+			_profiler.end(gpu_pass::RAYMARCH);
+
+			--_settling_frames;
+			_accumulated_samples = 1;
+		}
+		else if (refine)
+		{
+			_profiler.begin(gpu_pass::RAYMARCH);
+			accumulate();
+			_profiler.end(gpu_pass::RAYMARCH);
+		}
+
+		/* When the image did not change and no event arrived for a while, the window already shows this very frame */
+		bool idle = !rendered && !refine && !baking;
+		bool present = !idle || _gui_frames > 0;
+		if (idle && _gui_frames > 0)
+			--_gui_frames;
+
+		if (present)
+		{
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+			_profiler.begin(gpu_pass::COPY);
+			copy_to_framebuffer();
+			_profiler.end(gpu_pass::COPY);
+		}
+
+		advance_uniform_buffer(_uniform_buffer);
+		if (_user_uniform_buffer.buffer != invalid_handle)
+			advance_uniform_buffer(_user_uniform_buffer);
 
-		/* Generate the GUI */
-		if (_render_gui)
+		if (present)
 		{
-			imgui_new_frame();
-			generate_gui();
-			ImGui::Render();
+			/* Generate the GUI */
+			if (_render_gui)
+			{
+				imgui_new_frame();
+				generate_gui();
+				_profiler.begin(gpu_pass::GUI);
+				ImGui::Render();
+				_profiler.end(gpu_pass::GUI);
+			}
+
+			/* Swap buffers */
+			SDL_GL_SwapWindow(_window);
 		}
 
-		/* Swap buffers */
-		SDL_GL_SwapWindow(_window);
+		_profiler.end_frame();
+
+		/* Sleeps until the next input, or until the rebuild queue has a program or a variant ready */
+		if (!present)
+			SDL_WaitEvent(nullptr);
 	}
 
 	_raymarch_watcher.stop();
+	_rebuild_queue.stop();
 }
 
 bool application::open_window()
@@ -195,185 +521,1149 @@ bool application::open_window()
 	return true;
 }
 
-bool application::initialize_opengl()
+void application::run_headless()
 {
-	/* Create contexts */
-	_render_context = SDL_GL_CreateContext(_window);
-	_compiler_context = SDL_GL_CreateContext(_window);
-	SDL_GL_MakeCurrent(_window, _render_context);
-
-	/* Load Extensions */
-	gl3wInit();
-	if (!gl3wIsSupported(OPENGL_MAJOR_VERSION, OPENGL_MINOR_VERSION))
+	std::error_code error;
+	fs::create_directories(_config.headless.output_folder, error);
+	if (error)
 	{
-		std::cout << "ERROR: OpenGL " << OPENGL_MAJOR_VERSION << "." << OPENGL_MINOR_VERSION << " core not supported!" << std::endl;
-		return false;
+		std::cout << "ERROR: Could not create the output folder " << _config.headless.output_folder << "!" << std::endl;
+		return;
 	}
 
-	/* Basic OpenGL initialization */
-	glDisable(GL_DEPTH_TEST);
-	glDisable(GL_STENCIL_TEST);
-	glDisable(GL_CULL_FACE);
+	uint32_t frames = _config.headless.frames;
+	auto start_time = hr_clock::now();
 
-#ifdef _DEBUG
-	glEnable(GL_DEBUG_OUTPUT);
-	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-	glDebugMessageCallback((GLDEBUGPROC)gl_debug_callback, nullptr);
-#endif
+	if (_config.headless.cpu)
+	{
+		auto kernels = _cpu_renderer->kernels();
+		std::cout << "Rendering on the CPU with " << _cpu_renderer->num_threads() << " threads ("
+				  << (kernels ? kernels->name : "reference") << " marcher)" << std::endl;
 
-	if (glGetError() != GL_NO_ERROR)
+		std::vector<uint8_t> rgba;
+		for (uint32_t frame = 0; frame < frames; ++frame)
+		{
+			render_cpu_frame(frame, rgba);
+			write_frame(frame, rgba.data());
+		}
+	}
+	else
 	{
-		std::cout << "ERROR: Failed to initialize OpenGL!" << std::endl;
-		return false;
+		select_raymarch_program(true);
+
+		for (uint32_t frame = 0; frame < frames; ++frame)
+		{
+			_time_running = millis_interval(frame * HEADLESS_TIME_STEP);
+
+			_profiler.begin(gpu_pass::RAYMARCH);
+			raymarch();
+			_profiler.end(gpu_pass::RAYMARCH);
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+			_profiler.begin(gpu_pass::COPY);
+			copy_to_framebuffer();
+			_profiler.end(gpu_pass::COPY);
+			advance_uniform_buffer(_uniform_buffer);
+			if (_user_uniform_buffer.buffer != invalid_handle)
+				advance_uniform_buffer(_user_uniform_buffer);
+
+			/* Queue the readback of this frame and write to disk the one which is surely completed by now */
+			read_back_frame(frame);
+			if (frame >= READBACK_LATENCY)
+				save_frame(frame - READBACK_LATENCY);
+
+			_profiler.end_frame();
+		}
+
+		for (uint32_t frame = frames > READBACK_LATENCY ? frames - READBACK_LATENCY : 0; frame < frames; ++frame)
+			save_frame(frame);
+
+		/* Every query has completed after the last readback, so the remaining frames are collected too */
+		for (uint32_t i = 0; i < GPU_PROFILER_LATENCY; ++i)
+			_profiler.end_frame();
+
+		if (!_config.headless.timings_file.empty())
+			_profiler.dump(_config.headless.timings_file);
+
+		_statistics.flush();
+		if (!_config.headless.statistics_file.empty())
+			_statistics.dump(_config.headless.statistics_file);
 	}
 
-	return true;
+	auto elapsed = std::chrono::duration_cast<std::chrono::duration<float, std::milli>>(hr_clock::now() - start_time);
+	std::cout << "Rendered " << frames << " frames in " << elapsed.count() << " ms";
+	if (frames > 0)
+		std::cout << " (" << elapsed.count() / frames << " ms/frame)";
+	std::cout << std::endl;
 }
 
-bool application::create_opengl_resources()
+void application::run_benchmark()
 {
-	/* Geometry used to issue the copy of the image onto the framebuffer */
-	glGenVertexArrays(1, &_fullscreen_quad);
-	glBindVertexArray(_fullscreen_quad);
+	if (_config.headless.cpu)
+	{
+		std::cout << "ERROR: The benchmark can only measure the GPU renderer!" << std::endl;
+		return;
+	}
 
-	/* Image written by the compute and copied onto the framebuffer */
-	glGenTextures(1, &_offscreen_buffer);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, _offscreen_buffer);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F,
-                 static_cast<int32_t> (_config.resolution.width),
-				 static_cast<int32_t> (_config.resolution.height),
-                 0, GL_RGBA, GL_FLOAT, nullptr);
-	glBindImageTexture(0, _offscreen_buffer, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+	camera_path_t camera_path = create_orbit_camera_path(_config.benchmark.orbit_duration);
+	if (!_config.benchmark.camera_path.empty() && !load_camera_path(_config.benchmark.camera_path, camera_path))
+		return;
 
-	/* Raymarch program */
-	_raymarch_program = recompile_raymarch_program();
-	if (_raymarch_program == invalid_handle)
-		return false;
+	uint32_t warmup = _config.benchmark.warmup_frames;
+	uint32_t frames = _config.benchmark.frames;
+	std::array<GLsync, BENCHMARK_FRAMES_IN_FLIGHT> fences = {};
 
-	/* Copy program */
-	{
-		auto vs_source = get_content_of_file(_config.assets.folder / _config.assets.copy_program.vertex_shader_filename);
-		uint32_t vs = compile_shader(vs_source, shader_type::VERTEX);
-		assert(vs != invalid_handle);
+	std::cout << "Benchmarking " << _config.assets.raymarch_program.scene_file << " at " << _config.resolution.width << "x"
+			  << _config.resolution.height << " for " << frames << " frames, after " << warmup << " warm-up frames" << std::endl;
 
-		auto fs_source = get_content_of_file(_config.assets.folder / _config.assets.copy_program.fragment_shader_filename);
-		uint32_t fs = compile_shader(fs_source, shader_type::FRAGMENT);
-		assert(fs != invalid_handle);
+	/* The variant is compiled before the warm-up, so no frame is marched by the generic program */
+	select_raymarch_program(true);
 
-		_copy_program = link_program({ vs, fs });
+	for (uint32_t frame = 0; frame < warmup + frames; ++frame)
+	{
+		/* Only the measured frames are kept, those of the warm-up still in flight are discarded when they arrive */
+		if (frame == warmup)
+		{
+			_profiler.reset(frames);
+			_statistics.reset(frames);
+		}
 
-		glDeleteShader(vs);
-		glDeleteShader(fs);
-	
-		if (_copy_program == invalid_handle)
+		/* The measure restarts from the beginning of the path, so it does not depend on the number of warm-up frames */
+		float time = static_cast<float>(frame < warmup ? frame : frame - warmup) * HEADLESS_TIME_STEP;
+		_time_running = millis_interval(time);
+		evaluate_camera_path(camera_path, time, _camera);
+
+		GLsync& fence = fences[frame % BENCHMARK_FRAMES_IN_FLIGHT];
+		if (fence)
 		{
-			std::cout << "ERROR: Failed to create a valid OpenGL program!" << std::endl;
-			return false;
+			glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, BENCHMARK_FENCE_TIMEOUT);
+			glDeleteSync(fence);
 		}
+
+		_profiler.begin(gpu_pass::RAYMARCH);
+		raymarch();
+		_profiler.end(gpu_pass::RAYMARCH);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		_profiler.begin(gpu_pass::COPY);
+		copy_to_framebuffer();
+		_profiler.end(gpu_pass::COPY);
+		advance_uniform_buffer(_uniform_buffer);
+		if (_user_uniform_buffer.buffer != invalid_handle)
+			advance_uniform_buffer(_user_uniform_buffer);
+
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		_profiler.end_frame();
 	}
 
-	if (glGetError() != GL_NO_ERROR)
+	glFinish();
+	for (GLsync fence : fences)
 	{
-		std::cout << "ERROR: Failed to create OpenGL resources!" << std::endl;
-		return false;
+		if (fence)
+			glDeleteSync(fence);
 	}
 
-	return true;
+	for (uint32_t i = 0; i < GPU_PROFILER_LATENCY; ++i)
+		_profiler.end_frame();
+	_statistics.flush();
+
+	auto show_statistics = [](const char* name, const pass_statistics_t& s)
+	{
+		std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(3)
+				  << std::setw(10) << s.p50 << std::setw(10) << s.p95 << std::setw(10) << s.p99 << std::defaultfloat << std::endl;
+	};
+
+	std::cout << std::left << std::setw(10) << "ms" << std::right << std::setw(10) << "p50" << std::setw(10) << "p95"
+			  << std::setw(10) << "p99" << std::endl;
+	for (uint32_t p = 0; p < GPU_PASS_COUNT; ++p)
+		show_statistics(gpu_profiler::pass_name(static_cast<gpu_pass>(p)), _profiler.statistics(static_cast<gpu_pass>(p)));
+	show_statistics("gpu", _profiler.gpu_statistics());
+	show_statistics("cpu", _profiler.cpu_statistics());
+	std::cout << std::setprecision(6);
+
+	if (!_config.benchmark.report_file.empty() && write_benchmark_report(_config.benchmark.report_file))
+		std::cout << "Benchmark report written to " << _config.benchmark.report_file << std::endl;
+	if (!_config.headless.timings_file.empty())
+		_profiler.dump(_config.headless.timings_file);
+	if (!_config.headless.statistics_file.empty())
+		_statistics.dump(_config.headless.statistics_file);
 }
 
-void application::process_messages()
+void application::autotune_group_size()
 {
-	static SDL_Event event;
+	/* The fastest size depends on the scene and on the driver, the cache already has a folder for every driver */
+	std::string cs_source;
+	if (!assemble_raymarch_source(cs_source))
+		return;
 
-	while (SDL_PollEvent(&event))
+	uint64_t scene_key = hash_source(cs_source);
+	glm::uvec2 group_size;
+	if (load_cached_group_size(_program_cache, scene_key, group_size) && valid_group_size(group_size))
 	{
-		imgui_process_event(&event);
-
-		switch (event.type)
+		std::cout << "Work groups of " << group_size.x << "x" << group_size.y << ", tuned for this scene" << std::endl;
+		if (group_size != _group_size)
 		{
-			case SDL_QUIT:
-				_should_run = false;
-				break;
+			_group_size = group_size;
+			rebuild_raymarch_program();
+		}
 
-			case SDL_KEYDOWN:
-				if (event.key.keysym.sym == SDLK_ESCAPE)
-					_should_run = false;
-				else if (event.key.keysym.sym == SDLK_g)
-					_render_gui = !_render_gui;
-				break;
+		return;
+	}
 
-			default:
-				break;
+	if (_program_cache.folder.empty())
+		std::cout << "WARNING: Without the program cache the work groups are tuned again at every launch!" << std::endl;
+
+	std::cout << "Tuning the size of the work groups..." << std::endl;
+
+	camera_path_t camera_path = create_orbit_camera_path(_config.benchmark.orbit_duration);
+	camera_t camera = _camera;
+	glm::uvec2 best = _group_size;
+	float best_time = std::numeric_limits<float>::max();
+
+	for (const auto& candidate : GROUP_SIZE_CANDIDATES)
+	{
+		if (!valid_group_size(candidate))
+			continue;
+
+		_group_size = candidate;
+		if (!rebuild_raymarch_program())
+			continue;
+
+		/* The variant is what the frames are marched with, so it is the one timed */
+		select_raymarch_program(true);
+
+		float time = time_group_size(camera_path);
+		std::cout << "  " << candidate.x << "x" << candidate.y << ": " << time << " ms" << std::endl;
+
+		if (time < best_time)
+		{
+			best = candidate;
+			best_time = time;
 		}
 	}
+
+	_camera = camera;
+	_time_running = millis_interval(0.f);
+
+	if (_group_size != best)
+	{
+		_group_size = best;
+		rebuild_raymarch_program();
+	}
+
+	std::cout << "Work groups of " << best.x << "x" << best.y << " are the fastest" << std::endl;
+	if (best_time < std::numeric_limits<float>::max())
+		store_cached_group_size(_program_cache, scene_key, best);
 }
 
-void application::swap_raymarch_program()
+float application::time_group_size(const camera_path_t& camera_path)
 {
-	if (!_swap_program)
-		return;
+	std::vector<float> times;
+	for (uint32_t frame = 0; frame < AUTOTUNE_WARMUP_FRAMES + AUTOTUNE_FRAMES; ++frame)
+	{
+		/* Along the path of the benchmark, so the rays start from a reprojected depth like they do while moving */
+		float time = static_cast<float>(frame) * HEADLESS_TIME_STEP;
+		_time_running = millis_interval(time);
+		evaluate_camera_path(camera_path, time, _camera);
+
+		auto start_time = hr_clock::now();
+		raymarch();
+		glFinish();
+		auto elapsed = std::chrono::duration_cast<std::chrono::duration<float, std::milli>>(hr_clock::now() - start_time);
 
-	glUseProgram(0);
-	glDeleteProgram(_raymarch_program);
+		advance_uniform_buffer(_uniform_buffer);
+		if (_user_uniform_buffer.buffer != invalid_handle)
+			advance_uniform_buffer(_user_uniform_buffer);
 
-	_raymarch_program = _temp_program;
-	_temp_program = invalid_handle;
+		if (frame >= AUTOTUNE_WARMUP_FRAMES)
+			times.push_back(elapsed.count());
+	}
 
-	_swap_program = false;
+	/* The median ignores the frames slowed down by anything else running on the machine */
+	std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+	return times[times.size() / 2];
 }
 
-void application::raymarch()
+bool application::valid_group_size(const glm::uvec2& group_size) const
 {
-	glUseProgram(_raymarch_program);
+	int32_t max_x = 0;
+	int32_t max_y = 0;
+	int32_t max_invocations = 0;
+	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &max_x);
+	glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 1, &max_y);
+	glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &max_invocations);
+
+	return group_size.x > 0 && group_size.y > 0 && group_size.x <= static_cast<uint32_t>(max_x) &&
+		   group_size.y <= static_cast<uint32_t>(max_y) && group_size.x * group_size.y <= static_cast<uint32_t>(max_invocations);
+}
 
-	bind_default_uniforms();
-	bind_user_uniforms();
+bool application::write_benchmark_report(const fs::path& path) const
+{
+	rapidjson::StringBuffer buffer;
+	rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
 
-	// TODO(Corralx): Find a better way to handle this (Maybe just precompute the values?)
-	uint32_t x = static_cast<uint32_t>(std::ceil(_config.resolution.width / static_cast<float>(_config.group_size.x)));
-	uint32_t y = static_cast<uint32_t>(std::ceil(_config.resolution.height / static_cast<float>(_config.group_size.y)));
-	glDispatchCompute(x, y, 1);
+	auto write_string = [&writer](const char* key, const char* value)
+	{
+		writer.Key(key);
+		writer.String(value ? value : "");
+	};
+
+	auto write_statistics = [&writer](const char* key, const pass_statistics_t& s)
+	{
+		writer.Key(key);
+		writer.StartObject();
+		writer.Key("p50");
+		writer.Double(static_cast<double>(s.p50));
+		writer.Key("p95");
+		writer.Double(static_cast<double>(s.p95));
+		writer.Key("p99");
+		writer.Double(static_cast<double>(s.p99));
+		writer.EndObject();
+	};
+
+	writer.StartObject();
+
+	/* Enough to tell apart the runs of different drivers and scenes */
+	write_string("vendor", reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+	write_string("renderer", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	write_string("version", reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+	write_string("scene", _config.assets.raymarch_program.scene_file.string().c_str());
+	write_string("camera_path", _config.benchmark.camera_path.empty() ? "orbit" : _config.benchmark.camera_path.string().c_str());
+
+	writer.Key("width");
+	writer.Uint(_config.resolution.width);
+	writer.Key("height");
+	writer.Uint(_config.resolution.height);
+	writer.Key("warmup_frames");
+	writer.Uint(_config.benchmark.warmup_frames);
+	writer.Key("frames");
+	writer.Uint(_config.benchmark.frames);
+
+	/* The frames whose timings arrived, which might be less than the measured ones if the GPU fell behind */
+	writer.Key("timed_frames");
+	writer.Uint(static_cast<uint32_t>(_profiler.history().size()));
+
+	writer.Key("timings");
+	writer.StartObject();
+	for (uint32_t p = 0; p < GPU_PASS_COUNT; ++p)
+		write_statistics(gpu_profiler::pass_name(static_cast<gpu_pass>(p)), _profiler.statistics(static_cast<gpu_pass>(p)));
+	write_statistics("gpu", _profiler.gpu_statistics());
+	write_statistics("cpu", _profiler.cpu_statistics());
+	writer.EndObject();
+
+	/* The raymarch statistics do not depend on the machine, so they tell a slower driver from a more expensive scene */
+	auto history = _statistics.history();
+	writer.Key("per_ray");
+	writer.StartObject();
+	for (uint32_t c = 1; c < RAYMARCH_COUNTER_COUNT; ++c)
+	{
+		auto counter = static_cast<raymarch_counter>(c);
+		double sum = 0.0;
+		for (const auto& statistics : history)
+			sum += static_cast<double>(statistics.per_ray(counter));
+
+		writer.Key(raymarch_statistics::counter_name(counter));
+		writer.Double(history.empty() ? 0.0 : sum / static_cast<double>(history.size()));
+	}
+	writer.EndObject();
+
+	writer.EndObject();
+
+	std::ofstream stream(path);
+	if (!stream.is_open() || !stream.good())
+	{
+		std::cout << "ERROR: Could not write the benchmark report to " << path << "!" << std::endl;
+		return false;
+	}
+
+	stream << buffer.GetString() << std::endl;
+	return stream.good();
 }
 
-void application::copy_to_framebuffer()
+void application::read_back_frame(uint32_t frame)
 {
-	using namespace locations;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _readback_buffers[frame % _readback_buffers.size()]);
+	glReadPixels(0, 0, static_cast<int32_t>(_config.resolution.width), static_cast<int32_t>(_config.resolution.height),
+				 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
 
-	glUseProgram(_copy_program);
+void application::save_frame(uint32_t frame)
+{
+	size_t size = static_cast<size_t>(_config.resolution.width) * _config.resolution.height * 4;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _readback_buffers[frame % _readback_buffers.size()]);
+	auto pixels = static_cast<const uint8_t*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_READ_BIT));
 
-	glUniform1ui(SCREEN_WIDTH, _config.resolution.width);
-	glUniform1ui(SCREEN_HEIGHT, _config.resolution.height);
+	if (pixels)
+	{
+		write_frame(frame, pixels);
 
-	glUniform1f(VIGNETTE_RADIUS, _postprocess.vignette_radius);
-	glUniform1f(VIGNETTE_SMOOTHNESS, _postprocess.vignette_smoothness);
+		/* Without a scene the CPU can render there is nothing to compare with, the error was printed when the program was built */
+		if (_config.headless.compare && _cpu_scene)
+			compare_with_cpu_frame(frame, pixels);
 
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 }
 
-void application::generate_gui()
+void application::write_frame(uint32_t frame, const uint8_t* pixels)
 {
-	// NOTE(Corralx): The version of ImGui we are using is patched to support a custom sized spacing
-	static float gui_space = 10.f;
+	std::ostringstream filename;
+	filename << "frame_" << std::setw(5) << std::setfill('0') << frame << ".ppm";
 
-	ImGui::Text("Scene info");
-	ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+	fs::path path = _config.headless.output_folder / filename.str();
+	if (!save_image_ppm(path, _config.resolution.width, _config.resolution.height, pixels))
+		std::cout << "ERROR: Could not write " << path << "!" << std::endl;
+}
 
-	if (ImGui::Button("Open Scene", ImVec2(120, 25)))
-		open_scene_file();
-	ImGui::Spacing(gui_space);
+void application::render_cpu_frame(uint32_t frame, std::vector<uint8_t>& rgba)
+{
+	uint32_t width = _config.resolution.width;
+	uint32_t height = _config.resolution.height;
+
+	_cpu_scene->update(frame * HEADLESS_TIME_STEP, _uniforms);
+
+	std::vector<glm::vec3> pixels;
+	_cpu_renderer->render(*_cpu_scene, _raymarch, _camera, _light, _scene, width, height, pixels);
+	resolve_cpu_frame(pixels, _postprocess, width, height, rgba);
+}
+
+void application::compare_with_cpu_frame(uint32_t frame, const uint8_t* pixels)
+{
+	std::vector<uint8_t> reference;
+	render_cpu_frame(frame, reference);
+
+	double squared_error = 0.0;
+	uint32_t max_error = 0;
+	for (size_t i = 0; i < reference.size(); ++i)
+	{
+		uint32_t error = static_cast<uint32_t>(std::abs(static_cast<int32_t>(reference[i]) - pixels[i]));
+		squared_error += static_cast<double>(error * error);
+		max_error = std::max(max_error, error);
+	}
+
+	double rmse = reference.empty() ? 0.0 : std::sqrt(squared_error / reference.size());
+	std::cout << "Frame " << frame << ": RMSE " << rmse << ", max error " << max_error << " against the CPU reference" << std::endl;
+}
+
+void application::make_compiler_context_current()
+{
+	if (_config.headless.enabled)
+		make_headless_context_current(_headless, true);
+	else
+		SDL_GL_MakeCurrent(_window, _compiler_context);
+}
+
+bool application::initialize_opengl()
+{
+	/* Create contexts, the headless ones are already current at this point */
+	if (!_config.headless.enabled)
+	{
+		_render_context = SDL_GL_CreateContext(_window);
+		_compiler_context = SDL_GL_CreateContext(_window);
+		SDL_GL_MakeCurrent(_window, _render_context);
+	}
+
+	// gl3w resolves the entry points through libGL, which dispatches to the current EGL context too
+
+	/* Load Extensions */
+	gl3wInit();
+	if (!gl3wIsSupported(OPENGL_MAJOR_VERSION, OPENGL_MINOR_VERSION))
+	{
+		std::cout << "ERROR: OpenGL " << OPENGL_MAJOR_VERSION << "." << OPENGL_MINOR_VERSION << " core not supported!" << std::endl;
+		return false;
+	}
+
+	/* Basic OpenGL initialization */
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_STENCIL_TEST);
+	glDisable(GL_CULL_FACE);
+
+#ifdef _DEBUG
+	glEnable(GL_DEBUG_OUTPUT);
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	glDebugMessageCallback((GLDEBUGPROC)gl_debug_callback, nullptr);
+#endif
+
+	if (_config.program_cache.enabled)
+		create_program_cache(_program_cache, fs::current_path() / _config.program_cache.folder);
+
+	if (glGetError() != GL_NO_ERROR)
+	{
+		std::cout << "ERROR: Failed to initialize OpenGL!" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool application::create_opengl_resources()
+{
+	/* Geometry used to issue the copy of the image onto the framebuffer */
+	glGenVertexArrays(1, &_fullscreen_quad);
+	glBindVertexArray(_fullscreen_quad);
+
+	/* Distances of the cone prepass, created first so the offscreen buffer stays bound for the copy program */
+	_cone_levels.resize(_config.cone_prepass.levels);
+	if (!_cone_levels.empty())
+		glGenTextures(static_cast<int32_t>(_cone_levels.size()), _cone_levels.data());
+
+	for (size_t level = 0; level < _cone_levels.size(); ++level)
+	{
+		uint32_t factor = cone_factor(level, _cone_levels.size());
+		glBindTexture(GL_TEXTURE_2D, _cone_levels[level]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32F,
+					   static_cast<int32_t>((_config.resolution.width + factor - 1) / factor),
+					   static_cast<int32_t>((_config.resolution.height + factor - 1) / factor));
+	}
+
+	if (_config.reprojection.enabled)
+	{
+		auto width = static_cast<int32_t>(_config.resolution.width);
+		auto height = static_cast<int32_t>(_config.resolution.height);
+
+		glGenTextures(1, &_depth_buffer);
+		glBindTexture(GL_TEXTURE_2D, _depth_buffer);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32F, width, height);
+
+		glGenTextures(1, &_reprojected_depth);
+		glBindTexture(GL_TEXTURE_2D, _reprojected_depth);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, width, height);
+
+		/* glClearTexImage needs OpenGL 4.4, so the reprojected depth is cleared as a color attachment */
+		glGenFramebuffers(1, &_reprojection_framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _reprojection_framebuffer);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _reprojected_depth, 0);
+		bool complete = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+		if (!complete)
+		{
+			std::cout << "ERROR: Could not create the framebuffer of the reprojected depth!" << std::endl;
+			return false;
+		}
+	}
+
+	/* Only 16 bits per channel, they are never shown and only used to rebuild the next frame */
+	glGenTextures(static_cast<int32_t>(_rebuilt_frames.size()), _rebuilt_frames.data());
+	for (auto rebuilt_frame : _rebuilt_frames)
+	{
+		glBindTexture(GL_TEXTURE_2D, rebuilt_frame);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F,
+					   static_cast<int32_t>(_config.resolution.width), static_cast<int32_t>(_config.resolution.height));
+	}
+
+	/* In the worst case every pixel is on an edge */
+	glGenTextures(1, &_geometry_buffer);
+	glBindTexture(GL_TEXTURE_2D, _geometry_buffer);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F,
+				   static_cast<int32_t>(_config.resolution.width), static_cast<int32_t>(_config.resolution.height));
+	glBindImageTexture(GEOMETRY_UNIT, _geometry_buffer, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+
+	glGenBuffers(1, &_edge_list);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _edge_list);
+	glBufferData(GL_SHADER_STORAGE_BUFFER,
+				 static_cast<GLsizeiptr>(sizeof(EMPTY_EDGE_LIST) + sizeof(uint32_t) * _config.resolution.width * _config.resolution.height),
+				 nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	/* Image written by the compute and copied onto the framebuffer, read back by the compute to rebuild the pixels not traced */
+	glGenTextures(1, &_offscreen_buffer);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, _offscreen_buffer);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F,
+                 static_cast<int32_t> (_config.resolution.width),
+				 static_cast<int32_t> (_config.resolution.height),
+                 0, GL_RGBA, GL_FLOAT, nullptr);
+	glBindImageTexture(0, _offscreen_buffer, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+
+	/* Parameters of both the raymarch and the copy programs, each block index matches its binding point */
+	if (!create_uniform_buffer(_uniform_buffer, { sizeof(raymarch_parameters_block_t), sizeof(postprocess_block_t) }))
+		return false;
+	if (!create_dispatch_buffer(_dispatch_buffer, sizeof(dispatch_block_t), bindings::DISPATCH_PARAMETERS))
+		return false;
+
+	/* The timings and the statistics are not essential, so the application can run without them */
+	_profiler.create();
+	_statistics.create();
+
+	/* Without the bake the baked march is the plain one */
+	if (_config.bake.resolution > 0)
+		_sdf_bake.create(_config.bake.resolution, _config.bake.max_bricks);
+
+	/* The work groups are compiled into the program, a size the driver can not run falls back to the default one */
+	_group_size = glm::uvec2(_config.group_size.x, _config.group_size.y);
+	if (!valid_group_size(_group_size))
+	{
+		std::cout << "WARNING: Work groups of " << _group_size.x << "x" << _group_size.y << " are not supported, using "
+				  << DEFAULT_GROUP_SIZE << "x" << DEFAULT_GROUP_SIZE << "!" << std::endl;
+		_group_size = glm::uvec2(DEFAULT_GROUP_SIZE);
+	}
+
+	/* Raymarch program */
+	if (!rebuild_raymarch_program())
+		return false;
+
+	/* Copy program */
+	{
+		auto vs_source = get_content_of_file(_config.assets.folder / _config.assets.copy_program.vertex_shader_filename);
+		uint32_t vs = compile_shader(vs_source, shader_type::VERTEX);
+		assert(vs != invalid_handle);
+
+		auto fs_source = get_content_of_file(_config.assets.folder / _config.assets.copy_program.fragment_shader_filename);
+		uint32_t fs = compile_shader(fs_source, shader_type::FRAGMENT);
+		assert(fs != invalid_handle);
+
+		_copy_program = link_program({ vs, fs });
+
+		glDeleteShader(vs);
+		glDeleteShader(fs);
+	
+		if (_copy_program == invalid_handle)
+		{
+			std::cout << "ERROR: Failed to create a valid OpenGL program!" << std::endl;
+			return false;
+		}
+	}
+
+	if (glGetError() != GL_NO_ERROR)
+	{
+		std::cout << "ERROR: Failed to create OpenGL resources!" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool application::create_headless_resources()
+{
+	int32_t width = static_cast<int32_t>(_config.resolution.width);
+	int32_t height = static_cast<int32_t>(_config.resolution.height);
+
+	/* There is no default framebuffer without a window, so the copy pass renders into this one */
+	glGenTextures(1, &_headless_color_buffer);
+	glBindTexture(GL_TEXTURE_2D, _headless_color_buffer);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+
+	glGenFramebuffers(1, &_headless_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, _headless_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _headless_color_buffer, 0);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glViewport(0, 0, width, height);
+
+	/* The copy program samples the offscreen buffer from the first texture unit */
+	glBindTexture(GL_TEXTURE_2D, _offscreen_buffer);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR: The headless framebuffer is incomplete!" << std::endl;
+		return false;
+	}
+
+	/* Pixel buffers used to read back the frames asynchronously */
+	_readback_buffers.resize(READBACK_LATENCY + 1);
+	glGenBuffers(static_cast<int32_t>(_readback_buffers.size()), _readback_buffers.data());
+	for (auto buffer : _readback_buffers)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(width) * height * 4, nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (glGetError() != GL_NO_ERROR)
+	{
+		std::cout << "ERROR: Failed to create headless OpenGL resources!" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool application::process_messages()
+{
+	static SDL_Event event;
+
+	bool received = false;
+	while (SDL_PollEvent(&event))
+	{
+		received = true;
+		imgui_process_event(&event);
+
+		switch (event.type)
+		{
+			case SDL_QUIT:
+				_should_run = false;
+				break;
+
+			case SDL_KEYDOWN:
+				if (event.key.keysym.sym == SDLK_ESCAPE)
+					_should_run = false;
+				else if (event.key.keysym.sym == SDLK_g)
+					_render_gui = !_render_gui;
+				else if (event.key.keysym.sym == SDLK_p)
+					_time_paused = !_time_paused;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	return received;
+}
+
+void application::swap_raymarch_program()
+{
+	raymarch_build_t build;
+	if (!_rebuild_queue.poll(build))
+		return;
+
+	if (build.variant.empty())
+	{
+		publish_raymarch_program(std::move(build));
+		return;
+	}
+
+	/* A variant of an older source is useless, the one for the current source is requested again */
+	if (build.key != _raymarch_key)
+	{
+		release_raymarch_program(build.program);
+		return;
+	}
+
+	/* A failed variant is kept without any pass too, so the generic program is used for it from now on */
+	auto it = _raymarch_variants.find(build.variant);
+	if (it != _raymarch_variants.end())
+		release_raymarch_program(it->second);
+	_raymarch_variants[build.variant] = build.program;
+}
+
+std::string application::raymarch_variant() const
+{
+	std::ostringstream defines;
+	defines << "#define _HL_ENABLE_SHADOW " << (_raymarch.enable_shadow ? "true" : "false") << "\n";
+	defines << "#define _HL_SOFT_SHADOW " << (_raymarch.soft_shadow ? "true" : "false") << "\n";
+	defines << "#define _HL_ENABLE_AMBIENT_OCCLUSION " << (_raymarch.enable_ambient_occlusion ? "true" : "false") << "\n";
+
+	return defines.str();
+}
+
+void application::select_raymarch_program(bool wait)
+{
+	_active_program = _raymarch_program;
+	if (!_config.assets.raymarch_program.specialize || !_raymarch_program.valid())
+		return;
+
+	/* A variant which failed to build is kept without any pass, so the generic program is used without asking again */
+	std::string variant = raymarch_variant();
+	auto it = _raymarch_variants.find(variant);
+	if (it != _raymarch_variants.end())
+	{
+		if (it->second.valid())
+			_active_program = specialize_raymarch_program(_raymarch_program, it->second);
+		return;
+	}
+
+	/* Offscreen the settings never change, so the variant is worth waiting for. Otherwise the frames are marched with the
+	 * generic program until the worker is done with it
+	 */
+	if (wait)
+	{
+		raymarch_build_t build;
+		build.variant = variant;
+		if (build_raymarch_program(build))
+			_active_program = specialize_raymarch_program(_raymarch_program, build.program);
+		_raymarch_variants[variant] = build.program;
+		return;
+	}
+
+	if (variant != _requested_variant)
+	{
+		_requested_variant = variant;
+		_rebuild_queue.request_variant(variant);
+	}
+}
+
+void application::release_raymarch_variants()
+{
+	for (auto& variant : _raymarch_variants)
+		release_raymarch_program(variant.second);
+
+	_raymarch_variants.clear();
+	_requested_variant.clear();
+	_active_program = _raymarch_program;
+}
+
+void application::raymarch()
+{
+	update_user_uniforms();
+	update_default_uniforms();
+
+	/* Offscreen the whole bake is done before the first frame, with a window a few layers of it every frame */
+	if (_headless_framebuffer != invalid_handle && update_bake(_config.bake.resolution))
+		update_default_uniforms();
+
+	_statistics.begin();
+
+	uint32_t width = render_width();
+	uint32_t height = render_height();
+
+	int32_t reprojection = begin_reprojection();
+
+	/* From the coarsest level to the finest, each one starting from the distances of the previous one */
+	uint32_t input_factor = 0;
+	if (_raymarch.cone_prepass)
+	{
+		for (size_t level = 0; level < _cone_levels.size(); ++level)
+		{
+			uint32_t factor = cone_factor(level, _cone_levels.size());
+			if (level > 0)
+				glBindImageTexture(CONE_INPUT_UNIT, _cone_levels[level - 1], 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+			glBindImageTexture(CONE_OUTPUT_UNIT, _cone_levels[level], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+			_dispatch.cone_factor = static_cast<int32_t>(factor);
+			_dispatch.cone_input_factor = static_cast<int32_t>(input_factor);
+			dispatch_raymarch(raymarch_pass::CONE, (width + factor - 1) / factor, (height + factor - 1) / factor);
+			glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+			input_factor = factor;
+		}
+
+		if (!_cone_levels.empty())
+			glBindImageTexture(CONE_INPUT_UNIT, _cone_levels.back(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+	}
+
+	_dispatch.cone_factor = 0;
+	_dispatch.cone_input_factor = static_cast<int32_t>(input_factor);
+	_dispatch.reprojection = reprojection;
+
+	if (_raymarch.interlacing != interlace_mode::NONE)
+	{
+		raymarch_interlaced(width, height);
+	}
+	else
+	{
+		_dispatch.interlace = static_cast<int32_t>(interlace_mode::NONE);
+		dispatch_raymarch(raymarch_pass::MARCH, width, height);
+		_rebuilt_size = glm::uvec2(0);
+	}
+
+	if (antialiasing_samples() > 0)
+		antialias(width, height);
+
+	_statistics.end();
+
+	_previous_camera = _camera;
+}
+
+int32_t application::begin_reprojection()
+{
+	if (!_raymarch.reprojection || _depth_buffer == invalid_handle)
+	{
+		_depth_key.clear();
+		return REPROJECTION_NONE;
+	}
+
+	auto key = scene_key();
+	bool reproject = key == _depth_key;
+	_depth_key = std::move(key);
+
+	glBindImageTexture(DEPTH_UNIT, _depth_buffer, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32F);
+	glBindImageTexture(REPROJECTED_DEPTH_UNIT, _reprojected_depth, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+
+	if (!reproject)
+		return REPROJECTION_WRITE;
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _reprojection_framebuffer);
+	glClearBufferuiv(GL_COLOR, 0, &NO_DEPTH);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _headless_framebuffer != invalid_handle ? _headless_framebuffer : 0);
+
+	/* Every pixel of the last frame is moved onto the current camera, before any ray of this frame starts */
+	dispatch_raymarch(raymarch_pass::REPROJECT, render_width(), render_height());
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+	return REPROJECTION_START;
+}
+
+std::vector<uint8_t> application::scene_key() const
+{
+	/* Everything but the camera the depth depends on, as it was uploaded for this frame */
+	const auto& parameters = _uniform_buffer.data;
+	auto raymarch = parameters.begin() + _uniform_buffer.block_offsets[bindings::RAYMARCH_PARAMETERS];
+	std::vector<uint8_t> key(raymarch + offsetof(raymarch_parameters_block_t, raymarch),
+							 raymarch + offsetof(raymarch_parameters_block_t, raymarch) + sizeof(raymarch_block_t));
+	key.insert(key.end(), raymarch + offsetof(raymarch_parameters_block_t, scene),
+			   raymarch + offsetof(raymarch_parameters_block_t, scene) + sizeof(scene_block_t));
+	key.insert(key.end(), raymarch + offsetof(raymarch_parameters_block_t, frame) + offsetof(frame_block_t, screen_width),
+			   raymarch + offsetof(raymarch_parameters_block_t, frame) + offsetof(frame_block_t, _padding));
+	key.insert(key.end(), _user_uniform_buffer.data.begin(), _user_uniform_buffer.data.end());
+
+	if (_scene_reads_time)
+	{
+		float time = _time_running.count();
+		auto bytes = reinterpret_cast<const uint8_t*>(&time);
+		key.insert(key.end(), bytes, bytes + sizeof(time));
+	}
+
+	return key;
+}
+
+bool application::frame_changed()
+{
+	auto key = scene_key();
+	const auto& parameters = _uniform_buffer.data;
+	auto raymarch = parameters.begin() + _uniform_buffer.block_offsets[bindings::RAYMARCH_PARAMETERS];
+	key.insert(key.end(), raymarch + offsetof(raymarch_parameters_block_t, camera),
+			   raymarch + offsetof(raymarch_parameters_block_t, light) + sizeof(light_block_t));
+
+	/* The passes which are not part of the parameters still change how the image looks */
+	key.push_back(static_cast<uint8_t>(_raymarch.cone_prepass));
+	key.push_back(static_cast<uint8_t>(_raymarch.reprojection));
+	key.push_back(static_cast<uint8_t>(_raymarch.interlacing));
+
+	if (key == _frame_key)
+		return false;
+
+	_frame_key = std::move(key);
+	return true;
+}
+
+void application::accumulate()
+{
+	/* Consecutive points of the Halton sequence cover the pixel evenly however many samples end up being taken */
+	glm::vec2 jitter(halton(_accumulated_samples, 2), halton(_accumulated_samples, 3));
+	jitter -= glm::vec2(.5f);
+
+	_statistics.begin();
+
+	/* Every pixel is traced again from scratch, neither the cone nor the depth of the centre of the pixel hold for another point in it */
+	_dispatch.cone_factor = 0;
+	_dispatch.cone_input_factor = 0;
+	_dispatch.reprojection = REPROJECTION_NONE;
+	_dispatch.interlace = static_cast<int32_t>(interlace_mode::NONE);
+	_dispatch.jitter = jitter;
+	_dispatch.accumulated_samples = static_cast<int32_t>(_accumulated_samples);
+	dispatch_raymarch(raymarch_pass::MARCH, render_width(), render_height());
+	_dispatch.jitter = glm::vec2(0.f);
+	_dispatch.accumulated_samples = 0;
+
+	_statistics.end();
+
+	++_accumulated_samples;
+}
+
+void application::raymarch_interlaced(uint32_t width, uint32_t height)
+{
+	bool half = _raymarch.interlacing == interlace_mode::HALF;
+	int32_t phase = half ? static_cast<int32_t>(_interlaced_frames % 2) : QUARTER_PHASES[_interlaced_frames % 4];
+	++_interlaced_frames;
+
+	/* Only the pixels of the pattern are dispatched, two per row or one per 2x2 block */
+	_dispatch.interlace = static_cast<int32_t>(_raymarch.interlacing);
+	_dispatch.interlace_phase = phase;
+	dispatch_raymarch(raymarch_pass::MARCH, (width + 1) / 2, half ? height : (height + 1) / 2);
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+	/* The last rebuilt frame is reprojected only if it has the same resolution, the clamp takes care of anything else that changed */
+	glm::uvec2 size(width, height);
+	bool temporal = _rebuilt_size == size;
+
+	glBindImageTexture(PREVIOUS_FRAME_UNIT, _rebuilt_frames[1 - _next_rebuilt_frame], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	glBindImageTexture(NEXT_FRAME_UNIT, _rebuilt_frames[_next_rebuilt_frame], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+	_dispatch.reconstruction = temporal ? RECONSTRUCTION_TEMPORAL : RECONSTRUCTION_SPATIAL;
+	dispatch_raymarch(raymarch_pass::RECONSTRUCT, width, height);
+
+	_next_rebuilt_frame = 1 - _next_rebuilt_frame;
+	_rebuilt_size = size;
+}
+
+void application::antialias(uint32_t width, uint32_t height)
+{
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, _edge_list);
+	glBufferSubData(GL_DISPATCH_INDIRECT_BUFFER, 0, sizeof(EMPTY_EDGE_LIST), EMPTY_EDGE_LIST);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindings::EDGE_LIST, _edge_list);
+
+	/* Every pixel must be complete before it is compared with its neighbours */
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	dispatch_raymarch(raymarch_pass::EDGES, width, height);
+
+	/* Only the edges are traced again, as many groups as the search counted, without the CPU ever reading them */
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	bind_dispatch_block(_dispatch_buffer, _dispatch);
+	glUseProgram(_active_program[raymarch_pass::SUPERSAMPLE]);
+	glDispatchComputeIndirect(0);
+
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+}
+
+int32_t application::antialiasing_samples() const
+{
+	/* The heatmaps show the primary ray of every pixel alone */
+	if (_raymarch.debug != debug_mode::NONE)
+		return 0;
+
+	return glm::clamp(_raymarch.antialiasing_samples, 0, MAX_ANTIALIASING_SAMPLES);
+}
+
+std::vector<uint8_t> application::bake_key() const
+{
+	/* The scene does not read the time if it is baked, so it only depends on the user uniforms, and on the program which clears the key */
+	std::vector<uint8_t> key(_user_uniform_buffer.data.begin(), _user_uniform_buffer.data.end());
+	auto bounds = reinterpret_cast<const uint8_t*>(&_bake);
+	key.insert(key.end(), bounds, bounds + sizeof(bake_t));
+	return key;
+}
+
+bool application::update_bake(uint32_t layers)
+{
+	/* Nothing is baked unless the baked march would read it */
+	if (!_sdf_bake.created() || _raymarch.march != march_mode::BAKED || _scene_reads_time ||
+		glm::any(glm::lessThanEqual(_bake.max, _bake.min)))
+		return false;
+
+	auto key = bake_key();
+	if (key != _bake_key)
+	{
+		_bake_key = std::move(key);
+		_sdf_bake.restart();
+	}
+
+	/* The frames keep going until the number of bricks arrives, so the GUI shows it without waiting for an event */
+	if (_sdf_bake.ready())
+		return !_sdf_bake.collect();
+
+	_sdf_bake.step(layers, _group_size, _raymarch_program, _dispatch_buffer);
+	return true;
+}
+
+march_mode application::march() const
+{
+	/* Until the bake of the current scene is complete the rays march the exact one */
+	if (_raymarch.march == march_mode::BAKED && (!_sdf_bake.ready() || _scene_reads_time || bake_key() != _bake_key))
+		return march_mode::PLAIN;
+
+	return _raymarch.march;
+}
+
+void application::dispatch_raymarch(raymarch_pass pass, uint32_t width, uint32_t height)
+{
+	bind_dispatch_block(_dispatch_buffer, _dispatch);
+	glUseProgram(_active_program[pass]);
+
+	// TODO(Corralx): Find a better way to handle this (Maybe just precompute the values?)
+	uint32_t x = static_cast<uint32_t>(std::ceil(width / static_cast<float>(_group_size.x)));
+	uint32_t y = static_cast<uint32_t>(std::ceil(height / static_cast<float>(_group_size.y)));
+	glDispatchCompute(x, y, 1);
+}
+
+uint32_t application::render_width() const
+{
+	return _resolution.scaled(_config.resolution.width);
+}
+
+uint32_t application::render_height() const
+{
+	return _resolution.scaled(_config.resolution.height);
+}
+
+void application::copy_to_framebuffer()
+{
+	/* The parameters have already been uploaded by the raymarch pass */
+	glUseProgram(_copy_program);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void application::generate_gui()
+{
+	// NOTE(Corralx): The version of ImGui we are using is patched to support a custom sized spacing
+	static float gui_space = 10.f;
+
+	ImGui::Text("Scene info");
+	ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+
+	if (ImGui::Button("Open Scene", ImVec2(120, 25)))
+		open_scene_file();
+	ImGui::Spacing(gui_space);
+
+	generate_gui_for_timings();
+	generate_gui_for_statistics();
+	generate_gui_for_resolution();
 
 	/* Raymarch parameters */
 	if (ImGui::CollapsingHeader("Raymarch settings"))
 	{
 		ImGui::Spacing(gui_space);
+		if (_config.assets.raymarch_program.specialize)
+		{
+			if (_active_program[raymarch_pass::MARCH] != _raymarch_program[raymarch_pass::MARCH])
+				ImGui::Text("Specialized variant of the program");
+			else if (_raymarch_variants.count(raymarch_variant()) == 0)
+				ImGui::Text("Generic program, compiling a variant");
+			else
+				ImGui::Text("Generic program, the variant failed to build");
+		}
 		ImGui::InputFloat("Epsilon", &_raymarch.epsilon, .0f, .0f, 4);
 		ImGui::InputFloat("Z Far", &_raymarch.z_far, .0f, .0f, 2);
 		ImGui::InputFloat("Normal epsilon", &_raymarch.normal_epsilon, .0f, .0f, 4);
 		ImGui::InputFloat("Starting step", &_raymarch.starting_step, .0f, .0f, 3);
 		ImGui::InputInt("Max iterations", &_raymarch.max_iterations);
+
+		// Must follow the order of march_mode
+		int32_t march = static_cast<int32_t>(_raymarch.march);
+		if (ImGui::Combo("March mode", &march, "Plain\0Over-relaxed\0Baked\0\0"))
+			_raymarch.march = static_cast<march_mode>(march);
+
+		if (_raymarch.march == march_mode::BAKED)
+		{
+			if (!_sdf_bake.created())
+				ImGui::Text("There is no bake, the exact scene is marched");
+			else if (_scene_reads_time)
+				ImGui::Text("The scene reads the time, it can not be baked");
+			else if (!_sdf_bake.ready())
+				ImGui::Text("Baking %.0f%%", _sdf_bake.progress() * 100.f);
+			else
+				ImGui::Text("%u cells, %u of %u bricks", _sdf_bake.resolution(), std::min(_sdf_bake.bricks(), _sdf_bake.capacity()),
+							_sdf_bake.capacity());
+
+			ImGui::InputFloat3("Bake min", glm::value_ptr(_bake.min));
+			ImGui::InputFloat3("Bake max", glm::value_ptr(_bake.max));
+		}
+
+		if (_raymarch.march == march_mode::OVER_RELAXED)
+		{
+			ImGui::SliderFloat("Relaxation", &_raymarch.relaxation, 1.f, 1.99f);
+			ImGui::Text("Stops within half a pixel, instead of the epsilon");
+		}
+
+		if (!_cone_levels.empty())
+			ImGui::Checkbox("Cone prepass", &_raymarch.cone_prepass);
+
+		if (_depth_buffer != invalid_handle)
+		{
+			ImGui::Checkbox("Reprojection", &_raymarch.reprojection);
+			if (_raymarch.reprojection)
+				ImGui::SliderFloat("Backoff", &_raymarch.reprojection_backoff, 0.f, .5f);
+		}
+
+		// Must follow the order of interlace_mode
+		int32_t interlacing = static_cast<int32_t>(_raymarch.interlacing);
+		if (ImGui::Combo("Interlacing", &interlacing, "Every pixel\0Half (checkerboard)\0Quarter\0\0"))
+			_raymarch.interlacing = static_cast<interlace_mode>(interlacing);
+
+		ImGui::SliderInt("Antialiasing samples", &_raymarch.antialiasing_samples, 0, MAX_ANTIALIASING_SAMPLES);
+
+		ImGui::Checkbox("Progressive refinement", &_raymarch.progressive);
+		if (_raymarch.progressive)
+		{
+			ImGui::SliderInt("Progressive samples", &_raymarch.progressive_samples, 1, 256);
+			ImGui::Text("%u samples per pixel so far", _accumulated_samples);
+		}
+		ImGui::Checkbox("Pause time", &_time_paused);
+
 		ImGui::Checkbox("Enable shadow", &_raymarch.enable_shadow);
 		ImGui::Checkbox("Soft Shadow", &_raymarch.soft_shadow);
 		ImGui::InputFloat("Shadow quality", &_raymarch.shadow_quality, .0f, .0f, 2);
@@ -386,6 +1676,23 @@ void application::generate_gui()
 		ImGui::Spacing(gui_space);
 	}
 
+	/* Debug visualizations */
+	if (ImGui::CollapsingHeader("Debug view"))
+	{
+		ImGui::Spacing(gui_space);
+
+		// Must follow the order of debug_mode
+		int32_t mode = static_cast<int32_t>(_raymarch.debug);
+		if (ImGui::Combo("Mode", &mode, "Shaded\0Iterations\0Shadow steps\0Scene calls\0Termination\0Normals\0\0"))
+			_raymarch.debug = static_cast<debug_mode>(mode);
+
+		ImGui::InputInt("Heatmap range", &_raymarch.debug_range);
+
+		if (_raymarch.debug == debug_mode::TERMINATION)
+			ImGui::Text("Green: hit, Blue: z far, Red: max iterations");
+		ImGui::Spacing(gui_space);
+	}
+
 	/* Scene parameters */
 	if (ImGui::CollapsingHeader("Scene settings"))
 	{
@@ -415,252 +1722,475 @@ void application::generate_gui()
 	generate_gui_for_user_uniforms();
 }
 
-uint32_t application::recompile_raymarch_program()
+bool application::assemble_raymarch_source(std::string& cs_source) const
 {
 	fs::path full_assets_path = fs::current_path() / _config.assets.folder;
 
-	auto cs_source = get_content_of_file(full_assets_path / _config.assets.raymarch_program.base_file);
+	cs_source = get_content_of_file(full_assets_path / _config.assets.raymarch_program.base_file);
 	cs_source += get_content_of_file(full_assets_path / _config.assets.raymarch_program.library_file);
-	cs_source += get_content_of_file(full_assets_path / _config.assets.raymarch_program.scene_file);
+
+	/* A scene description is compiled to the scene function, an invalid one fails before anything is compiled */
+	fs::path scene_path = full_assets_path / _config.assets.raymarch_program.scene_file;
+	std::string scene_source;
+	if (scene_path.extension() == ".json")
+	{
+		if (!compile_scene_description(scene_path, scene_source))
+			return false;
+	}
+	else
+		scene_source = get_content_of_file(scene_path);
+
+	cs_source += scene_source;
 	cs_source += get_content_of_file(full_assets_path / _config.assets.raymarch_program.main_file);
 
-	uint32_t cs = compile_shader(cs_source, shader_type::COMPUTE);
-	assert(cs != invalid_handle);
+	return true;
+}
+
+bool application::build_raymarch_program(raymarch_build_t& build) const
+{
+	/* Nothing reaches glslang or the driver, so the previous program stays live until the scene is fixed */
+	std::string cs_source;
+	if (!assemble_raymarch_source(cs_source))
+		return false;
+
+	build.key = hash_source(cs_source);
 
-	uint32_t program = link_program({ cs });
+	/* The base declares the time, so only the rest of the program is searched for it, before any define moves it */
+	static const std::regex time_regex("\\btime\\b");
+	size_t base_size = get_content_of_file(fs::current_path() / _config.assets.folder / _config.assets.raymarch_program.base_file).size();
+	build.reads_time = std::regex_search(cs_source.begin() + static_cast<std::ptrdiff_t>(std::min(base_size, cs_source.size())),
+										 cs_source.end(), time_regex);
 
-	glDeleteShader(cs);
+	/* The size is part of the source, so the cache keeps a program for every size */
+	std::ostringstream group_size;
+	group_size << "#define _HL_GROUP_SIZE_X " << _group_size.x << "\n";
+	group_size << "#define _HL_GROUP_SIZE_Y " << _group_size.y << "\n";
+	insert_defines(cs_source, group_size.str());
+	uint64_t key = hash_source(cs_source);
 
-	/* Extract user-declared uniforms from compute source */
-	auto unis = extract_uniform(cs_source);
+	if (!build.variant.empty())
+		return build_raymarch_variant(std::move(cs_source), build);
+
+	// The CPU tracer needs the AST of the scene, so glslang can never be skipped when it exists
+	bool cached_uniforms = !_cpu_renderer && load_cached_uniforms(_program_cache, key, build.uniforms);
+
+	/* Extract user-declared uniforms from compute source, the CPU tracer also needs the bytecode of the scene.
+	 * glslang does not need any GL context, so it parses the source while the driver compiles the passes
+	 */
+	std::future<bool> reflection;
+	if (!cached_uniforms)
+	{
+		scene_program_t* scene_program = _cpu_renderer ? &build.scene_program : nullptr;
+		reflection = std::async(std::launch::async, [&cs_source, &build, scene_program]()
+		{
+			return extract_uniform(cs_source, build.uniforms, scene_program);
+		});
+	}
+
+	bool built = build_raymarch_passes(cs_source, false, build.program);
+	bool reflected = cached_uniforms || reflection.get();
 
 	/* This is _after_ the call to extract_uniform so we can use glslang error messages if something is wrong */
-	if (program == invalid_handle)
+	if (!built)
 	{
 		std::cout << "ERROR: Failed to create a valid OpenGL program!" << std::endl;
-		return program;
+		return false;
 	}
 
-	/* Copy user-defined values from the old uniforms to avoid resetting the value */
-	copy_uniforms_value(_uniforms, unis);
-	
-	/* Look up the uniforms location for the binding in the actual program */
-	get_uniforms_locations(unis, program);
-	_uniforms = std::move(unis);
+	/* The driver might accept what glslang refuses, like uniforms outside HL_PARAMETERS, but the scene could not be driven then */
+	if (!reflected)
+	{
+		release_raymarch_program(build.program);
+		return false;
+	}
 
-	return program;
+	if (!cached_uniforms)
+		store_cached_uniforms(_program_cache, key, build.uniforms);
+
+	return true;
 }
 
-void application::open_scene_file()
+bool application::build_raymarch_variant(std::string cs_source, raymarch_build_t& build) const
 {
-	std::string scene_path = (fs::current_path() / _config.assets.folder /
-							 _config.assets.raymarch_program.scene_file).string();
+	/* Only the defines after the version directive change, so the uniforms and the scene are the ones of the generic program.
+	 * The other passes do not read the settings of a variant, so they are shared with the generic program
+	 */
+	insert_defines(cs_source, build.variant);
 
-#ifdef _WIN32
-	ShellExecute(0, 0, scene_path.c_str(), 0, 0, SW_SHOW);
-#else
-	// https://stackoverflow.com/questions/6143100/how-do-i-open-a-file-in-its-default-program-linux/6143139#6143139
-	auto pid = fork();
-	if (pid == 0)
+	if (!build_raymarch_passes(cs_source, true, build.program))
 	{
-		execl("/usr/bin/xdg-open", "xdg-open", scene_path.c_str(), static_cast<char *> (0));
-		exit(1);
+		std::cout << "WARNING: Failed to build a specialized variant of the raymarch program, the generic one is used instead!" << std::endl;
+		return false;
 	}
-#endif
+
+	return true;
 }
 
-// TODO(Corralx): We should really be using an UBO for all of these instead of doing 25+ glUniform* calls
-void application::bind_default_uniforms()
+bool application::build_raymarch_passes(const std::string& cs_source, bool shading_only, raymarch_program_t& program) const
 {
-	using namespace locations;
-
-	glUniform1f(EPSILON, _raymarch.epsilon);
-	glUniform1f(Z_FAR, _raymarch.z_far);
-	glUniform1f(NORMAL_EPSILON, _raymarch.normal_epsilon);
-	glUniform1f(STARTING_STEP, _raymarch.starting_step);
-	glUniform1i(MAX_ITERATIONS, _raymarch.max_iterations);
-
-	glUniform1ui(ENABLE_SHADOW, _raymarch.enable_shadow);
-	glUniform1ui(SOFT_SHADOW, _raymarch.soft_shadow);
-	glUniform1f(SHADOW_QUALITY, _raymarch.shadow_quality);
-	glUniform1f(SHADOW_EPSILON, _raymarch.shadow_epsilon);
-	glUniform1f(SHADOW_STARTING_STEP, _raymarch.shadow_starting_step);
-	glUniform1f(SHADOW_MAX_STEP, _raymarch.shadow_max_step);
+	for (uint32_t i = 0; i < RAYMARCH_PASS_COUNT; ++i)
+	{
+		auto pass = static_cast<raymarch_pass>(i);
+		if (shading_only && !raymarch_pass_shades(pass))
+			continue;
 
-	glUniform1i(ENABLE_AMBIENT_OCCLUSION, _raymarch.enable_ambient_occlusion);
-	glUniform1f(AMBIENT_OCCLUSION_STEP, _raymarch.ambient_occlusion_step);
-	glUniform1i(AMBIENT_OCCLUSION_ITERATIONS, _raymarch.ambient_occlusion_iterations);
+		std::string pass_source = cs_source;
+		insert_defines(pass_source, raymarch_pass_define(pass));
 
-	glUniform1f(TIME, _time_running.count());
+		uint64_t key = hash_source(pass_source);
+		program[pass] = load_cached_program(_program_cache, key);
+		if (program[pass] != invalid_handle)
+			continue;
 
-	glUniform1f(FLOOR_HEIGHT, _scene.floor_height);
-	glUniform3fv(SKY_COLOR, 1, glm::value_ptr(_scene.sky_color));
+		uint32_t cs = compile_shader(pass_source, shader_type::COMPUTE);
+		if (cs != invalid_handle)
+		{
+			program[pass] = link_program({ cs }, true);
+			glDeleteShader(cs);
+		}
 
-	glUniform3fv(LIGHT_DIRECTION, 1, glm::value_ptr(_light.direction));
-	glUniform3fv(LIGHT_COLOR, 1, glm::value_ptr(_light.color));
+		if (program[pass] == invalid_handle)
+		{
+			release_raymarch_program(program);
+			return false;
+		}
 
-	glUniform3fv(CAMERA_POSITION, 1, glm::value_ptr(_camera.position));
-	glUniform3fv(CAMERA_VIEW, 1, glm::value_ptr(_camera.view));
-	glUniform3fv(CAMERA_UP, 1, glm::value_ptr(_camera.up));
-	glUniform3fv(CAMERA_RIGHT, 1, glm::value_ptr(_camera.right));
-	glUniform1f(FOCAL_LENGTH, _camera.focal_length);
+		store_cached_program(_program_cache, key, program[pass]);
+	}
 
-	glUniform1ui(SCREEN_WIDTH, _config.resolution.width);
-	glUniform1ui(SCREEN_HEIGHT, _config.resolution.height);
+	return true;
 }
 
-void application::bind_user_uniforms()
+void application::publish_raymarch_program(raymarch_build_t build)
 {
-	for (const auto& u : _uniforms)
+	if (_raymarch_program.valid())
 	{
-		if (u.location == invalid_location)
-			continue;
+		glUseProgram(0);
+		release_raymarch_program(_raymarch_program);
+	}
 
-		switch (u.type)
-		{
-			case uniform_type::FLOAT:
-				glUniform1f(u.location, u.vec4.x);
-				break;
+	/* The variants of the old source are built again on demand */
+	release_raymarch_variants();
 
-			case uniform_type::VEC2:
-				glUniform2fv(u.location, 1, glm::value_ptr<float>(u.vec4));
-				break;
+	_raymarch_program = build.program;
+	_raymarch_key = build.key;
+	_active_program = _raymarch_program;
+	_statistics.program_changed();
 
-			case uniform_type::VEC3:
-				glUniform3fv(u.location, 1, glm::value_ptr<float>(u.vec4));
-				break;
+	/* The depth of the old program says nothing about the new one */
+	_scene_reads_time = build.reads_time;
+	_depth_key.clear();
+	_frame_key.clear();
+	_bake_key.clear();
+	_rebuilt_size = glm::uvec2(0);
 
-			case uniform_type::VEC4:
-				glUniform4fv(u.location, 1, glm::value_ptr<float>(u.vec4));
-				break;
+	/* Copy user-defined values from the old uniforms to avoid resetting the value */
+	copy_uniforms_value(_uniforms, build.uniforms);
+	_uniforms = std::move(build.uniforms);
 
-			case uniform_type::DOUBLE:
-				glUniform1d(u.location, static_cast<double>(u.vec4.x));
-				break;
+	if (_cpu_renderer)
+		setup_cpu_scene(std::move(build.scene_program));
+}
 
-			case uniform_type::DVEC2:
-				glUniform2d(u.location, static_cast<double>(u.vec4.x),
-							static_cast<double>(u.vec4.y));
-				break;
+bool application::rebuild_raymarch_program()
+{
+	raymarch_build_t build;
+	if (!build_raymarch_program(build))
+		return false;
 
-			case uniform_type::DVEC3:
-				glUniform3d(u.location, static_cast<double>(u.vec4.x),
-							static_cast<double>(u.vec4.y),
-							static_cast<double>(u.vec4.z));
-				break;
+	publish_raymarch_program(std::move(build));
+	return true;
+}
 
-			case uniform_type::DVEC4:
-				glUniform4d(u.location, static_cast<double>(u.vec4.x),
-							static_cast<double>(u.vec4.y),
-							static_cast<double>(u.vec4.z),
-							static_cast<double>(u.vec4.w));
-				break;
+bool application::setup_cpu_scene(scene_program_t scene_program)
+{
+	if (scene_program.valid())
+	{
+		_cpu_scene = std::make_unique<vm_scene>(std::move(scene_program));
+		return true;
+	}
 
-			case uniform_type::INT:
-				glUniform1i(u.location, static_cast<int32_t>(u.ivec4.x));
-				break;
+	/* The hand-written port is only correct for the default scene, any other one would be silently replaced by it */
+	if (_config.assets.raymarch_program.scene_file == config_t().assets.raymarch_program.scene_file)
+	{
+		std::cout << "WARNING: Using the built-in default scene on the CPU!" << std::endl;
+		_cpu_scene = std::make_unique<default_scene>(_cpu_renderer->kernels());
+		return true;
+	}
 
-			case uniform_type::IVEC2:
-				glUniform2iv(u.location, 1, glm::value_ptr<int32_t>(u.ivec4));
-				break;
+	std::cout << "ERROR: The scene " << _config.assets.raymarch_program.scene_file
+			  << " can not be compiled for the CPU tracer, so it can not be rendered on the CPU!" << std::endl;
+	_cpu_scene.reset();
+	return false;
+}
 
-			case uniform_type::IVEC3:
-				glUniform3iv(u.location, 1, glm::value_ptr<int32_t>(u.ivec4));
-				break;
+void application::open_scene_file()
+{
+	std::string scene_path = (fs::current_path() / _config.assets.folder /
+							 _config.assets.raymarch_program.scene_file).string();
 
-			case uniform_type::IVEC4:
-				glUniform4iv(u.location, 1, glm::value_ptr<int32_t>(u.ivec4));
-				break;
+#ifdef _WIN32
+	ShellExecute(0, 0, scene_path.c_str(), 0, 0, SW_SHOW);
+#else
+	// https://stackoverflow.com/questions/6143100/how-do-i-open-a-file-in-its-default-program-linux/6143139#6143139
+	auto pid = fork();
+	if (pid == 0)
+	{
+		execl("/usr/bin/xdg-open", "xdg-open", scene_path.c_str(), static_cast<char *> (0));
+		exit(1);
+	}
+#endif
+}
 
-			case uniform_type::UINT:
-				glUniform1ui(u.location, static_cast<uint32_t>(u.ivec4.x));
-				break;
+void application::update_default_uniforms()
+{
+	/* Every source struct is written to its own section of the block, so only the modified ones are uploaded */
+	raymarch_block_t raymarch = {};
+	raymarch.epsilon = _raymarch.epsilon;
+	raymarch.z_far = _raymarch.z_far;
+	raymarch.normal_epsilon = _raymarch.normal_epsilon;
+	raymarch.starting_step = _raymarch.starting_step;
+	raymarch.max_iterations = _raymarch.max_iterations;
+	raymarch.enable_shadow = _raymarch.enable_shadow;
+	raymarch.soft_shadow = _raymarch.soft_shadow;
+	raymarch.shadow_quality = _raymarch.shadow_quality;
+	raymarch.shadow_epsilon = _raymarch.shadow_epsilon;
+	raymarch.shadow_starting_step = _raymarch.shadow_starting_step;
+	raymarch.shadow_max_step = _raymarch.shadow_max_step;
+	raymarch.enable_ambient_occlusion = _raymarch.enable_ambient_occlusion;
+	raymarch.ambient_occlusion_step = _raymarch.ambient_occlusion_step;
+	raymarch.ambient_occlusion_iterations = _raymarch.ambient_occlusion_iterations;
+	raymarch.debug_mode = static_cast<uint32_t>(_raymarch.debug);
+	raymarch.debug_range = std::max(_raymarch.debug_range, 1);
+	raymarch.march_mode = static_cast<uint32_t>(march());
+	raymarch.relaxation = glm::clamp(_raymarch.relaxation, 1.f, 1.99f);
+	raymarch.reprojection_backoff = glm::clamp(_raymarch.reprojection_backoff, 0.f, .5f);
+	raymarch.antialiasing_samples = antialiasing_samples();
+
+	camera_block_t camera = {};
+	camera.position = _camera.position;
+	camera.focal_length = _camera.focal_length;
+	camera.view = _camera.view;
+	camera.up = _camera.up;
+	camera.right = _camera.right;
+
+	light_block_t light = {};
+	light.direction = _light.direction;
+	light.color = _light.color;
+
+	scene_block_t scene = {};
+	scene.sky_color = _scene.sky_color;
+	scene.floor_height = _scene.floor_height;
+
+	camera_block_t previous_camera = {};
+	previous_camera.position = _previous_camera.position;
+	previous_camera.focal_length = _previous_camera.focal_length;
+	previous_camera.view = _previous_camera.view;
+	previous_camera.up = _previous_camera.up;
+	previous_camera.right = _previous_camera.right;
+
+	bake_block_t bake = {};
+	bake.min = _bake.min;
+	bake.resolution = _sdf_bake.resolution();
+	bake.max = _bake.max;
+	bake.atlas_bricks = _sdf_bake.atlas_bricks();
+
+	frame_block_t frame = {};
+	frame.time = _time_running.count();
+	frame.screen_width = render_width();
+	frame.screen_height = render_height();
+
+	postprocess_block_t postprocess = {};
+	postprocess.screen_width = _config.resolution.width;
+	postprocess.screen_height = _config.resolution.height;
+	postprocess.vignette_radius = _postprocess.vignette_radius;
+	postprocess.vignette_smoothness = _postprocess.vignette_smoothness;
+	postprocess.render_width = render_width();
+	postprocess.render_height = render_height();
+
+	/* The vignette would darken the borders of the heatmaps */
+	if (_raymarch.debug != debug_mode::NONE)
+	{
+		postprocess.vignette_radius = 2.f;
+		postprocess.vignette_smoothness = 1.f;
+	}
 
-			case uniform_type::UVEC2:
-				glUniform2ui(u.location, static_cast<uint32_t>(u.ivec4.x),
-							 static_cast<uint32_t>(u.ivec4.y));
-				break;
+	using namespace bindings;
+	update_uniform_block(_uniform_buffer, RAYMARCH_PARAMETERS, static_cast<uint32_t>(offsetof(raymarch_parameters_block_t, raymarch)), raymarch);
+	update_uniform_block(_uniform_buffer, RAYMARCH_PARAMETERS, static_cast<uint32_t>(offsetof(raymarch_parameters_block_t, camera)), camera);
+	update_uniform_block(_uniform_buffer, RAYMARCH_PARAMETERS, static_cast<uint32_t>(offsetof(raymarch_parameters_block_t, light)), light);
+	update_uniform_block(_uniform_buffer, RAYMARCH_PARAMETERS, static_cast<uint32_t>(offsetof(raymarch_parameters_block_t, scene)), scene);
+	update_uniform_block(_uniform_buffer, RAYMARCH_PARAMETERS, static_cast<uint32_t>(offsetof(raymarch_parameters_block_t, frame)), frame);
+	update_uniform_block(_uniform_buffer, RAYMARCH_PARAMETERS, static_cast<uint32_t>(offsetof(raymarch_parameters_block_t, previous_camera)), previous_camera);
+	update_uniform_block(_uniform_buffer, RAYMARCH_PARAMETERS, static_cast<uint32_t>(offsetof(raymarch_parameters_block_t, bake)), bake);
+	update_uniform_block(_uniform_buffer, POSTPROCESS_PARAMETERS, 0, postprocess);
+
+	bind_uniform_buffer(_uniform_buffer);
+}
 
-			case uniform_type::UVEC3:
-				glUniform3ui(u.location, static_cast<uint32_t>(u.ivec4.x),
-							 static_cast<uint32_t>(u.ivec4.y),
-							 static_cast<uint32_t>(u.ivec4.z));
-				break;
+void application::generate_gui_for_timings()
+{
+	if (!ImGui::CollapsingHeader("Timings"))
+		return;
 
-			case uniform_type::UVEC4:
-				glUniform4ui(u.location, static_cast<uint32_t>(u.ivec4.x),
-							 static_cast<uint32_t>(u.ivec4.y),
-							 static_cast<uint32_t>(u.ivec4.z),
-							 static_cast<uint32_t>(u.ivec4.w));
-                break;
+	auto show_statistics = [](const char* name, const pass_statistics_t& s)
+	{
+		ImGui::Text("%-10s %7.3f %7.3f %7.3f %7.3f", name, s.last, s.p50, s.p95, s.p99);
+	};
 
-			case uniform_type::BOOL:
-				glUniform1ui(u.location, static_cast<uint32_t>(u.boolean));
-				break;
+	ImGui::Text("%-10s %7s %7s %7s %7s", "ms", "last", "p50", "p95", "p99");
+	for (uint32_t p = 0; p < GPU_PASS_COUNT; ++p)
+		show_statistics(gpu_profiler::pass_name(static_cast<gpu_pass>(p)), _profiler.statistics(static_cast<gpu_pass>(p)));
+	show_statistics("gpu", _profiler.gpu_statistics());
+	show_statistics("cpu", _profiler.cpu_statistics());
 
-			default:
-				assert(false && "Unsupported uniform type requested!");
-				break;
-		}
+	/* Frame time graph, over the whole history */
+	auto history = _profiler.history();
+	std::vector<float> gpu, cpu;
+	for (const auto& timings : history)
+	{
+		gpu.push_back(timings.gpu);
+		cpu.push_back(timings.cpu);
 	}
+
+	if (!history.empty())
+	{
+		float scale = *std::max_element(cpu.begin(), cpu.end());
+		ImGui::PlotLines("GPU", gpu.data(), static_cast<int32_t>(gpu.size()), 0, nullptr, 0.f, scale, ImVec2(0, 60));
+		ImGui::PlotLines("CPU", cpu.data(), static_cast<int32_t>(cpu.size()), 0, nullptr, 0.f, scale, ImVec2(0, 60));
+	}
+
+	if (ImGui::Button("Dump CSV", ImVec2(120, 25)))
+		_profiler.dump("timings.csv");
+	ImGui::SameLine();
+	if (ImGui::Button("Dump JSON", ImVec2(120, 25)))
+		_profiler.dump("timings.json");
 }
 
-void application::generate_gui_for_user_uniforms()
+void application::generate_gui_for_statistics()
 {
-	if (_uniforms.empty() || !ImGui::CollapsingHeader("Custom parameters", nullptr, true, true))
+	if (!ImGui::CollapsingHeader("Statistics"))
 		return;
 
-	for (auto& u : _uniforms)
+	const auto& last = _statistics.last();
+	ImGui::Text("%-24s %12s %9s", "last frame", "total", "per ray");
+	for (uint32_t c = 0; c < RAYMARCH_COUNTER_COUNT; ++c)
 	{
-		switch (u.type)
-		{
-			case uniform_type::FLOAT:
-			case uniform_type::DOUBLE:
-				ImGui::InputFloat(u.readable_name.c_str(), glm::value_ptr<float>(u.vec4));
-				break;
+		auto counter = static_cast<raymarch_counter>(c);
+		ImGui::Text("%-24s %12u %9.3f", raymarch_statistics::counter_name(counter), last[counter], last.per_ray(counter));
+	}
 
-			case uniform_type::VEC2:
-			case uniform_type::DVEC2:
-				ImGui::InputFloat2(u.readable_name.c_str(), glm::value_ptr<float>(u.vec4));
-				break;
+	/* Scene calls per ray over the whole history, the cost of a scene does not depend on the resolution */
+	auto history = _statistics.history();
+	std::vector<float> scene_calls;
+	for (const auto& statistics : history)
+		scene_calls.push_back(statistics.per_ray(raymarch_counter::SCENE_CALLS));
 
-			case uniform_type::VEC3:
-			case uniform_type::DVEC3:
-				ImGui::InputFloat3(u.readable_name.c_str(), glm::value_ptr<float>(u.vec4));
-				break;
+	if (!history.empty())
+		ImGui::PlotLines("Scene calls", scene_calls.data(), static_cast<int32_t>(scene_calls.size()), 0, nullptr, 0.f, std::numeric_limits<float>::max(), ImVec2(0, 60));
 
-			case uniform_type::VEC4:
-			case uniform_type::DVEC4:
-				ImGui::InputFloat4(u.readable_name.c_str(), glm::value_ptr<float>(u.vec4));
-				break;
+	if (ImGui::Button("Dump CSV##statistics", ImVec2(120, 25)))
+		_statistics.dump("statistics.csv");
+	ImGui::SameLine();
+	if (ImGui::Button("Dump JSON##statistics", ImVec2(120, 25)))
+		_statistics.dump("statistics.json");
+}
 
-			case uniform_type::INT:
-			case uniform_type::UINT:
-				ImGui::InputInt(u.readable_name.c_str(), glm::value_ptr<int32_t>(u.ivec4));
-				break;
+void application::generate_gui_for_resolution()
+{
+	if (!ImGui::CollapsingHeader("Resolution"))
+		return;
 
-			case uniform_type::IVEC2:
-			case uniform_type::UVEC2:
-				ImGui::InputInt2(u.readable_name.c_str(), glm::value_ptr<int32_t>(u.ivec4));
-				break;
+	ImGui::Text("Rendering at %ux%u (%.0f%%)", render_width(), render_height(), _resolution.scale() * 100.f);
+	ImGui::Checkbox("Dynamic resolution", &_dynamic_resolution.enabled);
+	ImGui::SliderFloat("Target (ms)", &_dynamic_resolution.target_ms, 4.f, 50.f);
+	ImGui::SliderFloat("Min scale", &_dynamic_resolution.min_scale, .1f, 1.f);
+	ImGui::SliderFloat("Max scale", &_dynamic_resolution.max_scale, .1f, 1.f);
+}
 
-			case uniform_type::IVEC3:
-			case uniform_type::UVEC3:
-				ImGui::InputInt3(u.readable_name.c_str(), glm::value_ptr<int32_t>(u.ivec4));
-				break;
+void application::update_user_uniforms()
+{
+	/* The block of the user parameters changes with the scene, so its buffer is created again when its size does */
+	uint32_t block_size = _uniforms.block_size();
+	if (_user_uniform_buffer.buffer != invalid_handle && _user_uniform_buffer.block_sizes[0] != block_size)
+		destroy_uniform_buffer(_user_uniform_buffer);
 
-			case uniform_type::IVEC4:
-			case uniform_type::UVEC4:
-				ImGui::InputInt4(u.readable_name.c_str(), glm::value_ptr<int32_t>(u.ivec4));
-				break;
+	if (block_size == 0)
+		return;
 
-			case uniform_type::BOOL:
-				ImGui::Checkbox(u.readable_name.c_str(), &u.boolean);
-				break;
+	if (_user_uniform_buffer.buffer == invalid_handle &&
+		!create_uniform_buffer(_user_uniform_buffer, { block_size }, bindings::USER_PARAMETERS))
+	{
+		std::cout << "ERROR: Could not create the buffer of the user parameters!" << std::endl;
+		return;
+	}
 
-			default:
-				assert(false);
-				break;
+	_uniforms.update(_user_uniform_buffer, 0);
+	bind_uniform_buffer(_user_uniform_buffer);
+}
+
+void application::generate_gui_for_user_uniforms()
+{
+	if (_uniforms.empty() || !ImGui::CollapsingHeader("Custom parameters", nullptr, true, true))
+		return;
+
+	for (auto& u : _uniforms.uniforms())
+	{
+		uniform_layout_t layout = get_uniform_layout(u.type);
+		ImGui::PushID(u.name.c_str());
+
+		// Every column of a matrix and every element of an array gets its own row
+		for (uint32_t i = 0; i < u.values.size(); ++i)
+		{
+			std::string label = u.readable_name;
+			if (u.array_size > 1)
+				label += "[" + std::to_string(i / layout.columns) + "]";
+			if (layout.columns > 1)
+				label += "[" + std::to_string(i % layout.columns) + "]";
+
+			uniform_value_t& value = u.values[i];
+			ImGui::PushID(static_cast<int32_t>(i));
+
+			switch (u.type)
+			{
+				case uniform_type::BOOL:
+					ImGui::Checkbox(label.c_str(), &value.boolean);
+					break;
+
+				case uniform_type::INT:
+				case uniform_type::UINT:
+					ImGui::InputInt(label.c_str(), glm::value_ptr<int32_t>(value.ivec4));
+					break;
+
+				case uniform_type::IVEC2:
+				case uniform_type::UVEC2:
+					ImGui::InputInt2(label.c_str(), glm::value_ptr<int32_t>(value.ivec4));
+					break;
+
+				case uniform_type::IVEC3:
+				case uniform_type::UVEC3:
+					ImGui::InputInt3(label.c_str(), glm::value_ptr<int32_t>(value.ivec4));
+					break;
+
+				case uniform_type::IVEC4:
+				case uniform_type::UVEC4:
+					ImGui::InputInt4(label.c_str(), glm::value_ptr<int32_t>(value.ivec4));
+					break;
+
+				default:
+					switch (layout.components)
+					{
+						case 1: ImGui::InputFloat(label.c_str(), glm::value_ptr<float>(value.vec4)); break;
+						case 2: ImGui::InputFloat2(label.c_str(), glm::value_ptr<float>(value.vec4)); break;
+						case 3: ImGui::InputFloat3(label.c_str(), glm::value_ptr<float>(value.vec4)); break;
+						default: ImGui::InputFloat4(label.c_str(), glm::value_ptr<float>(value.vec4)); break;
+					}
+					break;
+			}
+
+			ImGui::PopID();
 		}
+
+		ImGui::PopID();
 	}
 }
@@ -2,11 +2,29 @@
 
 #include "configuration.hpp"
 #include "file_watcher.hpp"
+#include "headless_context.hpp"
+#include "cpu_renderer.hpp"
+#include "cpu_scene.hpp"
 #include "uniform_utils.hpp"
+#include "uniform_buffer.hpp"
+#include "uniform_blocks.hpp"
+#include "program_cache.hpp"
+#include "raymarch_program.hpp"
+#include "rebuild_queue.hpp"
+#include "gpu_profiler.hpp"
+#include "raymarch_statistics.hpp"
+#include "camera_path.hpp"
+#include "resolution_controller.hpp"
+#include "sdf_bake.hpp"
+#include "scene_description.hpp"
 #include "common.hpp"
 
+#include <array>
 #include <cstdint>
 #include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
 using millis_interval = std::chrono::duration<float>;
 
 class application
@@ -20,7 +38,7 @@ public:
 	application& operator=(const application&) = delete;
 	application& operator=(const application&&) = delete;
 
-	bool init();
+	bool init(const config_t& config);
 	void run();
 	void cleanup();
 
@@ -31,44 +49,148 @@ private:
 	SDL_GLContext _render_context;
 	SDL_GLContext _compiler_context;
 
+	headless_context_t _headless;
+	uint32_t _headless_framebuffer;
+	uint32_t _headless_color_buffer;
+	std::vector<uint32_t> _readback_buffers;
+
+	std::unique_ptr<cpu_renderer> _cpu_renderer;
+	std::unique_ptr<cpu_scene> _cpu_scene;
+
 	uint32_t _fullscreen_quad;
 	uint32_t _offscreen_buffer;
-
-	uint32_t _raymarch_program;
+	/* Distances of the cone prepass, from the coarsest level to the finest */
+	std::vector<uint32_t> _cone_levels;
+	/* Distance reached by the rays of the last frame, and the same distances moved onto the current camera */
+	uint32_t _depth_buffer;
+	uint32_t _reprojected_depth;
+	uint32_t _reprojection_framebuffer;
+	/* Frames rebuilt when interlacing, the one of the last frame is read while the other one is written */
+	std::array<uint32_t, 2> _rebuilt_frames;
+	uint32_t _next_rebuilt_frame;
+	/* Surface of every pixel, and the list of the pixels on an edge which is also the argument of the indirect dispatch */
+	uint32_t _geometry_buffer;
+	uint32_t _edge_list;
+
+	raymarch_program_t _raymarch_program;
+	/* Hash of the source of the program, and its variants specialized on the settings by their defines */
+	uint64_t _raymarch_key;
+	std::unordered_map<std::string, raymarch_program_t> _raymarch_variants;
+	/* The last variant asked to the rebuild queue, and the passes the frame is marched with */
+	std::string _requested_variant;
+	raymarch_program_t _active_program;
+	/* Size of the work groups the program is compiled with, and dispatched by */
+	glm::uvec2 _group_size;
 	uint32_t _copy_program; 
-	std::vector<uniform_t> _uniforms;
+	uniform_buffer_t _uniform_buffer;
+	uniform_buffer_t _user_uniform_buffer;
+	/* The state of the next dispatch, uploaded by every one of them */
+	dispatch_buffer_t _dispatch_buffer;
+	dispatch_block_t _dispatch;
+	program_cache_t _program_cache;
+	gpu_profiler _profiler;
+	raymarch_statistics _statistics;
+	resolution_controller _resolution;
+	sdf_bake _sdf_bake;
+	uniform_registry _uniforms;
 
 	bool _should_run;
 	bool _initialized;
 	bool _render_gui;
+	/* Event pushed by the rebuild queue to wake up the loop waiting for events, and the idle frames still presented after one */
+	uint32_t _wake_event;
+	uint32_t _gui_frames;
 	
 	file_watcher _raymarch_watcher;
-	uint32_t _temp_program;
-	bool _swap_program;
+	rebuild_queue _rebuild_queue;
 
 	raymarch_t _raymarch;
 	camera_t _camera;
 	light_t _light;
 	scene_t _scene;
 	postprocess_t _postprocess;
+	dynamic_resolution_t _dynamic_resolution;
+	bake_t _bake;
 
 	millis_interval _time_running;
 
+	/* State the depth buffer was written with, it is only reprojected if nothing but the camera changed since */
+	camera_t _previous_camera;
+	std::vector<uint8_t> _depth_key;
+	bool _scene_reads_time;
+
+	/* Frames traced with interlacing so far, and the resolution of the last rebuilt one, zero if the next one can not use it */
+	uint32_t _interlaced_frames;
+	glm::uvec2 _rebuilt_size;
+
+	/* Everything the last frame was rendered with, a frame is only rendered again when it changes */
+	std::vector<uint8_t> _frame_key;
+	/* Frames still to render before the image stops changing, and the samples of every pixel in it since */
+	uint32_t _settling_frames;
+	uint32_t _accumulated_samples;
+	bool _time_paused;
+
+	/* Scene and bounds the bake was started with, it is only marched once complete and while they did not change */
+	std::vector<uint8_t> _bake_key;
+
+	void setup_scene();
+
 	bool open_window();
 	bool initialize_opengl();
 	bool create_opengl_resources();
-
-	void process_messages();
+	bool create_headless_resources();
+	void make_compiler_context_current();
+
+	void run_headless();
+	void run_benchmark();
+	void autotune_group_size();
+	float time_group_size(const camera_path_t& camera_path);
+	bool valid_group_size(const glm::uvec2& group_size) const;
+	bool write_benchmark_report(const fs::path& path) const;
+	void read_back_frame(uint32_t frame);
+	void save_frame(uint32_t frame);
+	void write_frame(uint32_t frame, const uint8_t* pixels);
+	void render_cpu_frame(uint32_t frame, std::vector<uint8_t>& rgba);
+	void compare_with_cpu_frame(uint32_t frame, const uint8_t* pixels);
+
+	/* True if any event arrived since the last call */
+	bool process_messages();
 	void swap_raymarch_program();
+	std::string raymarch_variant() const;
+	void select_raymarch_program(bool wait);
+	void release_raymarch_variants();
 	void raymarch();
+	void dispatch_raymarch(raymarch_pass pass, uint32_t width, uint32_t height);
+	uint32_t render_width() const;
+	uint32_t render_height() const;
+	int32_t begin_reprojection();
+	std::vector<uint8_t> scene_key() const;
+	bool frame_changed();
+	void accumulate();
+	void raymarch_interlaced(uint32_t width, uint32_t height);
+	void antialias(uint32_t width, uint32_t height);
+	int32_t antialiasing_samples() const;
+	std::vector<uint8_t> bake_key() const;
+	bool update_bake(uint32_t layers);
+	march_mode march() const;
 	void copy_to_framebuffer();
 	void generate_gui();
-
-	uint32_t recompile_raymarch_program();
+	void generate_gui_for_timings();
+	void generate_gui_for_statistics();
+	void generate_gui_for_resolution();
+
+	bool assemble_raymarch_source(std::string& cs_source) const;
+	bool build_raymarch_program(raymarch_build_t& build) const;
+	bool build_raymarch_variant(std::string cs_source, raymarch_build_t& build) const;
+	/* Only the passes which shade if shading_only, everything is released if any of them fails */
+	bool build_raymarch_passes(const std::string& cs_source, bool shading_only, raymarch_program_t& program) const;
+	void publish_raymarch_program(raymarch_build_t build);
+	bool rebuild_raymarch_program();
+	bool setup_cpu_scene(scene_program_t scene_program);
 
 	void open_scene_file();
 
-	void bind_default_uniforms();
-	void bind_user_uniforms();
+	void update_default_uniforms();
+	void update_user_uniforms();
 	void generate_gui_for_user_uniforms();
 };
@@ -0,0 +1,21 @@
+#include "application.hpp"
+
+/* Same as helios --benchmark: renders offscreen along a scripted camera path with a fixed time step,
+ * then reports the CPU and GPU frame time percentiles on the standard output and as JSON.
+ */
+int main(int argc, char* argv[])
+{
+	config_t config = load_config();
+	config.benchmark.enabled = true;
+	if (!apply_command_line(argc, argv, config))
+		return -1;
+
+	application app;
+	if (!app.init(config))
+		return -1;
+
+	app.run();
+
+	app.cleanup();
+	return 0;
+}
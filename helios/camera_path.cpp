@@ -0,0 +1,142 @@
+#include "camera_path.hpp"
+#include "glm/gtc/constants.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+static constexpr const char* KEYFRAMES_KEY = "keyframes";
+static constexpr const char* TIME_KEY = "time";
+static constexpr const char* POSITION_KEY = "position";
+static constexpr const char* TARGET_KEY = "target";
+
+/* Number of keyframes the orbit is made of, the spline is close enough to a circle with these */
+static constexpr uint32_t ORBIT_KEYFRAMES = 16;
+static constexpr float ORBIT_RADIUS = 5.f;
+static constexpr float ORBIT_HEIGHT = 2.f;
+
+static glm::vec3 catmull_rom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+{
+	float t2 = t * t;
+	float t3 = t2 * t;
+
+	return .5f * ((2.f * p1) + (p2 - p0) * t + (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t2 + (3.f * p1 - p0 - 3.f * p2 + p3) * t3);
+}
+
+static bool read_vec3(const rapidjson::Value& value, glm::vec3& v)
+{
+	if (!value.IsArray() || value.Size() != 3)
+		return false;
+
+	for (rapidjson::SizeType i = 0; i < 3; ++i)
+	{
+		if (!value[i].IsNumber())
+			return false;
+		v[static_cast<int32_t>(i)] = static_cast<float>(value[i].GetDouble());
+	}
+
+	return true;
+}
+
+camera_path_t create_orbit_camera_path(float duration)
+{
+	camera_path_t camera_path;
+
+	for (uint32_t i = 0; i <= ORBIT_KEYFRAMES; ++i)
+	{
+		float t = static_cast<float>(i) / static_cast<float>(ORBIT_KEYFRAMES);
+		float angle = t * 2.f * glm::pi<float>();
+
+		camera_keyframe_t keyframe;
+		keyframe.time = t * duration;
+		keyframe.position = { ORBIT_RADIUS * std::sin(angle), ORBIT_HEIGHT, ORBIT_RADIUS * std::cos(angle) };
+		keyframe.target = { .0f, .0f, .0f };
+		camera_path.keyframes.push_back(keyframe);
+	}
+
+	return camera_path;
+}
+
+bool load_camera_path(const fs::path& path, camera_path_t& camera_path)
+{
+	if (!fs::exists(path))
+	{
+		std::cout << "ERROR: The camera path " << path << " does not exist!" << std::endl;
+		return false;
+	}
+
+	rapidjson::Document doc;
+	std::string content = get_content_of_file(path);
+	doc.Parse(content.c_str());
+
+	if (doc.HasParseError() || !doc.IsObject() || !doc.HasMember(KEYFRAMES_KEY) || !doc[KEYFRAMES_KEY].IsArray())
+	{
+		std::cout << "ERROR: The camera path " << path << " is not valid!" << std::endl;
+		return false;
+	}
+
+	camera_path.keyframes.clear();
+	for (const auto& value : doc[KEYFRAMES_KEY].GetArray())
+	{
+		camera_keyframe_t keyframe;
+		if (!value.IsObject() || !value.HasMember(TIME_KEY) || !value[TIME_KEY].IsNumber() ||
+			!value.HasMember(POSITION_KEY) || !read_vec3(value[POSITION_KEY], keyframe.position) ||
+			!value.HasMember(TARGET_KEY) || !read_vec3(value[TARGET_KEY], keyframe.target))
+		{
+			std::cout << "ERROR: A keyframe of the camera path " << path << " is not valid!" << std::endl;
+			return false;
+		}
+
+		keyframe.time = static_cast<float>(value[TIME_KEY].GetDouble());
+		camera_path.keyframes.push_back(keyframe);
+	}
+
+	if (camera_path.keyframes.empty())
+	{
+		std::cout << "ERROR: The camera path " << path << " has no keyframes!" << std::endl;
+		return false;
+	}
+
+	std::stable_sort(camera_path.keyframes.begin(), camera_path.keyframes.end(),
+					 [](const camera_keyframe_t& a, const camera_keyframe_t& b) { return a.time < b.time; });
+
+	return true;
+}
+
+void evaluate_camera_path(const camera_path_t& camera_path, float time, camera_t& camera)
+{
+	const auto& keyframes = camera_path.keyframes;
+	if (keyframes.empty())
+		return;
+
+	/* The first keyframe after time, the segment goes from the one before it */
+	auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+								 [](float t, const camera_keyframe_t& keyframe) { return t < keyframe.time; });
+
+	glm::vec3 position, target;
+	if (next == keyframes.begin() || next == keyframes.end())
+	{
+		const auto& keyframe = next == keyframes.begin() ? keyframes.front() : keyframes.back();
+		position = keyframe.position;
+		target = keyframe.target;
+	}
+	else
+	{
+		size_t i2 = static_cast<size_t>(next - keyframes.begin());
+		size_t i1 = i2 - 1;
+		size_t i0 = i1 > 0 ? i1 - 1 : i1;
+		size_t i3 = std::min(i2 + 1, keyframes.size() - 1);
+
+		float length = keyframes[i2].time - keyframes[i1].time;
+		float t = length > 0.f ? (time - keyframes[i1].time) / length : 1.f;
+
+		position = catmull_rom(keyframes[i0].position, keyframes[i1].position, keyframes[i2].position, keyframes[i3].position, t);
+		target = catmull_rom(keyframes[i0].target, keyframes[i1].target, keyframes[i2].target, keyframes[i3].target, t);
+	}
+
+	/* Same conventions of the default camera, with the world up along y */
+	camera.position = position;
+	camera.view = glm::normalize(target - position);
+	camera.right = glm::normalize(glm::cross(camera.view, glm::vec3(.0f, 1.f, .0f)));
+	camera.up = glm::cross(camera.right, camera.view);
+}
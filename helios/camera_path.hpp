@@ -0,0 +1,31 @@
+#pragma once
+
+#include "common.hpp"
+#include "uniform_utils.hpp"
+
+#include <vector>
+
+/* A point the camera passes through, looking at target, time is in seconds */
+struct camera_keyframe_t
+{
+	float time;
+	glm::vec3 position;
+	glm::vec3 target;
+};
+
+/* The keyframes are interpolated with a Catmull-Rom spline, so the camera passes through every one of them smoothly.
+ * Before the first and after the last keyframe the camera stays still.
+ */
+struct camera_path_t
+{
+	std::vector<camera_keyframe_t> keyframes;
+};
+
+/* A full orbit around the origin, from the default point of view, in the given number of seconds */
+camera_path_t create_orbit_camera_path(float duration);
+
+/* Reads { "keyframes": [ { "time": 0, "position": [x, y, z], "target": [x, y, z] }, ... ] } sorted by time */
+bool load_camera_path(const fs::path& path, camera_path_t& camera_path);
+
+/* Only position, view, up and right are written, the focal length is left untouched */
+void evaluate_camera_path(const camera_path_t& camera_path, float time, camera_t& camera);
@@ -16,6 +16,31 @@ std::string get_content_of_file(const fs::path& path)
 	return content;
 }
 
+bool save_image_ppm(const fs::path& path, uint32_t width, uint32_t height, const uint8_t* pixels)
+{
+	std::ofstream stream(path, std::ios::binary);
+	if (!stream.is_open() || !stream.good())
+		return false;
+
+	stream << "P6\n" << width << " " << height << "\n255\n";
+
+	std::vector<char> row(width * 3);
+	for (uint32_t y = height; y-- > 0;)
+	{
+		const uint8_t* src = pixels + static_cast<size_t>(y) * width * 4;
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			row[x * 3 + 0] = static_cast<char>(src[x * 4 + 0]);
+			row[x * 3 + 1] = static_cast<char>(src[x * 4 + 1]);
+			row[x * 3 + 2] = static_cast<char>(src[x * 4 + 2]);
+		}
+
+		stream.write(row.data(), static_cast<std::streamsize>(row.size()));
+	}
+
+	return stream.good();
+}
+
 uint32_t compile_shader(const std::string& source, shader_type type)
 {
 	uint32_t shader = glCreateShader(static_cast<uint32_t>(type));
@@ -35,10 +60,13 @@ uint32_t compile_shader(const std::string& source, shader_type type)
 	return shader;
 }
 
-uint32_t link_program(std::vector<uint32_t> shaders)
+uint32_t link_program(std::vector<uint32_t> shaders, bool retrievable)
 {
 	uint32_t program = glCreateProgram();
-	
+
+	if (retrievable)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 	for (auto shader : shaders)
 		glAttachShader(program, shader);
 
@@ -43,6 +43,9 @@ namespace fs { using namespace std::experimental::filesystem::v1; }
 
 std::string get_content_of_file(const fs::path& path);
 
+// Pixels are tightly packed RGBA8 rows starting from the bottom one, as returned by glReadPixels
+bool save_image_ppm(const fs::path& path, uint32_t width, uint32_t height, const uint8_t* pixels);
+
 enum class shader_type : uint32_t
 {
 	VERTEX = GL_VERTEX_SHADER,
@@ -56,7 +59,8 @@ static constexpr int32_t invalid_location = std::numeric_limits<int32_t>::max();
 
 // NOTE(Corralx): An active GL context is required on the calling thread for these to work
 uint32_t compile_shader(const std::string& source, shader_type type);
-uint32_t link_program(std::vector<uint32_t> shaders);
+/* A retrievable program can be saved with glGetProgramBinary */
+uint32_t link_program(std::vector<uint32_t> shaders, bool retrievable = false);
 
 #ifdef _DEBUG
 void gl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, void* user_param);
@@ -3,6 +3,10 @@
 
 #include <iostream>
 
+#pragma warning(push, 0)
+#include "tclap/CmdLine.h"
+#pragma warning(pop)
+
 // Hardcoded configuration path
 static constexpr const char* CONFIG_PATH = "resources/config.json";
 
@@ -10,9 +14,43 @@ static constexpr const char* RESOLUTION_KEY = "resolution";
 static constexpr const char* WIDTH_KEY = "width";
 static constexpr const char* HEIGHT_KEY = "height";
 static constexpr const char* FULLSCREEN_KEY = "fullscreen";
+static constexpr const char* DYNAMIC_RESOLUTION_KEY = "dynamic_resolution";
+static constexpr const char* TARGET_MS_KEY = "target_ms";
+static constexpr const char* MIN_SCALE_KEY = "min_scale";
+static constexpr const char* MAX_SCALE_KEY = "max_scale";
+static constexpr const char* HEADLESS_KEY = "headless";
+static constexpr const char* ENABLED_KEY = "enabled";
+static constexpr const char* FRAMES_KEY = "frames";
+static constexpr const char* OUTPUT_FOLDER_KEY = "output_folder";
+static constexpr const char* CPU_KEY = "cpu";
+static constexpr const char* COMPARE_KEY = "compare";
+static constexpr const char* CPU_THREADS_KEY = "cpu_threads";
+static constexpr const char* CPU_ISA_KEY = "cpu_isa";
+static constexpr const char* TIMINGS_FILE_KEY = "timings_file";
+static constexpr const char* STATISTICS_FILE_KEY = "statistics_file";
+static constexpr const char* BENCHMARK_KEY = "benchmark";
+static constexpr const char* WARMUP_FRAMES_KEY = "warmup_frames";
+static constexpr const char* CAMERA_PATH_KEY = "camera_path";
+static constexpr const char* ORBIT_DURATION_KEY = "orbit_duration";
+static constexpr const char* REPORT_FILE_KEY = "report_file";
 static constexpr const char* GROUP_SIZE_KEY = "group_size";
 static constexpr const char* X_KEY = "x";
 static constexpr const char* Y_KEY = "y";
+static constexpr const char* AUTOTUNE_KEY = "autotune";
+static constexpr const char* CONE_PREPASS_KEY = "cone_prepass";
+static constexpr const char* LEVELS_KEY = "levels";
+static constexpr const char* REPROJECTION_KEY = "reprojection";
+static constexpr const char* INTERLACING_KEY = "interlacing";
+static constexpr const char* MODE_KEY = "mode";
+static constexpr const char* ANTIALIASING_KEY = "antialiasing";
+static constexpr const char* SAMPLES_KEY = "samples";
+static constexpr const char* PROGRESSIVE_KEY = "progressive";
+static constexpr const char* BAKE_KEY = "bake";
+static constexpr const char* MIN_KEY = "min";
+static constexpr const char* MAX_KEY = "max";
+static constexpr const char* MAX_BRICKS_KEY = "max_bricks";
+static constexpr const char* LAYERS_PER_FRAME_KEY = "layers_per_frame";
+static constexpr const char* PROGRAM_CACHE_KEY = "program_cache";
 static constexpr const char* ASSETS_KEY = "assets";
 static constexpr const char* FOLDER_KEY = "folder";
 static constexpr const char* COPY_PROGRAM_KEY = "copy_program";
@@ -24,6 +62,8 @@ static constexpr const char* LIBRARY_FILE_KEY = "library_file";
 static constexpr const char* SCENE_FILE_KEY = "scene_file";
 static constexpr const char* MAIN_FILE_KEY = "main_file";
 static constexpr const char* SCENE_RELOAD_INTERVAL = "scene_reload_interval";
+static constexpr const char* SCENE_RELOAD_DEBOUNCE = "scene_reload_debounce";
+static constexpr const char* SPECIALIZE_KEY = "specialize";
 
 #define LOAD_BOOL_IF(member, doc, key) \
 if (doc.HasMember(key)) \
@@ -33,15 +73,32 @@ if (doc.HasMember(key)) \
 if (doc.HasMember(key)) \
 	member = doc[key].GetUint()
 
+#define LOAD_STRING_IF(member, doc, key) \
+if (doc.HasMember(key)) \
+	member = doc[key].GetString()
+
 #define LOAD_PATH_IF(member, doc, key) \
 if (doc.HasMember(key)) \
 	member = fs::path(doc[key].GetString())
 
+#define LOAD_FLOAT_IF(member, doc, key) \
+if (doc.HasMember(key)) \
+	member = doc[key].GetFloat()
+
+#define LOAD_VEC3_IF(member, doc, key) \
+if (doc.HasMember(key) && doc[key].IsArray() && doc[key].Size() == 3) \
+	member = glm::vec3(doc[key][0].GetFloat(), doc[key][1].GetFloat(), doc[key][2].GetFloat())
+
+fs::path get_config_path()
+{
+	return fs::current_path() / CONFIG_PATH;
+}
+
 config_t load_config()
 {
 	config_t config{};
 
-	fs::path config_path = fs::current_path() / CONFIG_PATH;
+	fs::path config_path = get_config_path();
 	if (!fs::exists(config_path))
 	{
 		std::cout << "WARNING: The configuration could not be found!" << std::endl;
@@ -68,12 +125,104 @@ config_t load_config()
 
 	LOAD_BOOL_IF(config.fullscreen, doc, FULLSCREEN_KEY);
 
+	if (doc.HasMember(DYNAMIC_RESOLUTION_KEY))
+	{
+		auto& dynamic_resolution = doc[DYNAMIC_RESOLUTION_KEY];
+
+		LOAD_BOOL_IF(config.dynamic_resolution.enabled, dynamic_resolution, ENABLED_KEY);
+		LOAD_FLOAT_IF(config.dynamic_resolution.target_ms, dynamic_resolution, TARGET_MS_KEY);
+		LOAD_FLOAT_IF(config.dynamic_resolution.min_scale, dynamic_resolution, MIN_SCALE_KEY);
+		LOAD_FLOAT_IF(config.dynamic_resolution.max_scale, dynamic_resolution, MAX_SCALE_KEY);
+	}
+
+	if (doc.HasMember(HEADLESS_KEY))
+	{
+		auto& headless = doc[HEADLESS_KEY];
+
+		LOAD_BOOL_IF(config.headless.enabled, headless, ENABLED_KEY);
+		LOAD_UINT_IF(config.headless.frames, headless, FRAMES_KEY);
+		LOAD_PATH_IF(config.headless.output_folder, headless, OUTPUT_FOLDER_KEY);
+		LOAD_BOOL_IF(config.headless.cpu, headless, CPU_KEY);
+		LOAD_BOOL_IF(config.headless.compare, headless, COMPARE_KEY);
+		LOAD_UINT_IF(config.headless.cpu_threads, headless, CPU_THREADS_KEY);
+		LOAD_STRING_IF(config.headless.cpu_isa, headless, CPU_ISA_KEY);
+		LOAD_PATH_IF(config.headless.timings_file, headless, TIMINGS_FILE_KEY);
+		LOAD_PATH_IF(config.headless.statistics_file, headless, STATISTICS_FILE_KEY);
+	}
+
+	if (doc.HasMember(BENCHMARK_KEY))
+	{
+		auto& benchmark = doc[BENCHMARK_KEY];
+
+		LOAD_UINT_IF(config.benchmark.warmup_frames, benchmark, WARMUP_FRAMES_KEY);
+		LOAD_UINT_IF(config.benchmark.frames, benchmark, FRAMES_KEY);
+		LOAD_PATH_IF(config.benchmark.camera_path, benchmark, CAMERA_PATH_KEY);
+		LOAD_FLOAT_IF(config.benchmark.orbit_duration, benchmark, ORBIT_DURATION_KEY);
+		LOAD_PATH_IF(config.benchmark.report_file, benchmark, REPORT_FILE_KEY);
+	}
+
 	if (doc.HasMember(GROUP_SIZE_KEY))
 	{
 		auto& group_size = doc[GROUP_SIZE_KEY];
 
 		LOAD_UINT_IF(config.group_size.x, group_size, X_KEY);
 		LOAD_UINT_IF(config.group_size.y, group_size, Y_KEY);
+		LOAD_BOOL_IF(config.group_size.autotune, group_size, AUTOTUNE_KEY);
+	}
+
+	if (doc.HasMember(CONE_PREPASS_KEY))
+	{
+		auto& cone_prepass = doc[CONE_PREPASS_KEY];
+
+		LOAD_UINT_IF(config.cone_prepass.levels, cone_prepass, LEVELS_KEY);
+	}
+
+	if (doc.HasMember(REPROJECTION_KEY))
+	{
+		auto& reprojection = doc[REPROJECTION_KEY];
+
+		LOAD_BOOL_IF(config.reprojection.enabled, reprojection, ENABLED_KEY);
+	}
+
+	if (doc.HasMember(INTERLACING_KEY))
+	{
+		auto& interlacing = doc[INTERLACING_KEY];
+
+		LOAD_STRING_IF(config.interlacing.mode, interlacing, MODE_KEY);
+	}
+
+	if (doc.HasMember(ANTIALIASING_KEY))
+	{
+		auto& antialiasing = doc[ANTIALIASING_KEY];
+
+		LOAD_UINT_IF(config.antialiasing.samples, antialiasing, SAMPLES_KEY);
+	}
+
+	if (doc.HasMember(PROGRESSIVE_KEY))
+	{
+		auto& progressive = doc[PROGRESSIVE_KEY];
+
+		LOAD_BOOL_IF(config.progressive.enabled, progressive, ENABLED_KEY);
+		LOAD_UINT_IF(config.progressive.samples, progressive, SAMPLES_KEY);
+	}
+
+	if (doc.HasMember(BAKE_KEY))
+	{
+		auto& bake = doc[BAKE_KEY];
+
+		LOAD_UINT_IF(config.bake.resolution, bake, RESOLUTION_KEY);
+		LOAD_VEC3_IF(config.bake.min, bake, MIN_KEY);
+		LOAD_VEC3_IF(config.bake.max, bake, MAX_KEY);
+		LOAD_UINT_IF(config.bake.max_bricks, bake, MAX_BRICKS_KEY);
+		LOAD_UINT_IF(config.bake.layers_per_frame, bake, LAYERS_PER_FRAME_KEY);
+	}
+
+	if (doc.HasMember(PROGRAM_CACHE_KEY))
+	{
+		auto& program_cache = doc[PROGRAM_CACHE_KEY];
+
+		LOAD_BOOL_IF(config.program_cache.enabled, program_cache, ENABLED_KEY);
+		LOAD_PATH_IF(config.program_cache.folder, program_cache, FOLDER_KEY);
 	}
 
 	if (doc.HasMember(ASSETS_KEY))
@@ -112,12 +261,109 @@ config_t load_config()
 			auto& interval = config.assets.raymarch_program.scene_reload_interval;
 			if (raymarch_program.HasMember(SCENE_RELOAD_INTERVAL))
 				interval = std::chrono::milliseconds(raymarch_program[SCENE_RELOAD_INTERVAL].GetUint());
+
+			auto& debounce = config.assets.raymarch_program.scene_reload_debounce;
+			if (raymarch_program.HasMember(SCENE_RELOAD_DEBOUNCE))
+				debounce = std::chrono::milliseconds(raymarch_program[SCENE_RELOAD_DEBOUNCE].GetUint());
+
+			LOAD_BOOL_IF(config.assets.raymarch_program.specialize, raymarch_program, SPECIALIZE_KEY);
 		}
 	}
 
 	return config;
 }
 
+bool apply_command_line(int argc, char* argv[], config_t& config)
+{
+	try
+	{
+		TCLAP::CmdLine cmd("Helios implicit surface renderer");
+
+		TCLAP::SwitchArg headless_arg("", "headless", "Render offscreen without any window and write the frames to disk", cmd);
+		TCLAP::ValueArg<uint32_t> frames_arg("n", "frames", "Number of frames to render in headless mode", false,
+											 config.headless.frames, "count", cmd);
+		TCLAP::ValueArg<std::string> output_arg("o", "output", "Folder where the headless frames are written", false,
+												config.headless.output_folder.string(), "path", cmd);
+		TCLAP::SwitchArg cpu_arg("", "cpu", "Render the headless frames on the CPU reference tracer", cmd);
+		TCLAP::SwitchArg compare_arg("", "compare", "Compare every headless GPU frame against the CPU reference", cmd);
+		TCLAP::ValueArg<uint32_t> threads_arg("", "threads", "Number of CPU workers, 0 uses every hardware thread", false,
+											  config.headless.cpu_threads, "count", cmd);
+		TCLAP::ValueArg<std::string> isa_arg("", "isa", "Instruction set of the CPU packet marcher (auto, reference, scalar, sse4, avx2, avx512)",
+											 false, config.headless.cpu_isa, "name", cmd);
+		TCLAP::ValueArg<std::string> timings_arg("", "timings", "File where the GPU timings of the headless frames are written (.csv or .json)",
+												 false, config.headless.timings_file.string(), "path", cmd);
+		TCLAP::ValueArg<std::string> statistics_arg("", "statistics", "File where the raymarch statistics of the headless frames are written (.csv or .json)",
+													false, config.headless.statistics_file.string(), "path", cmd);
+		TCLAP::SwitchArg benchmark_arg("", "benchmark", "Measure the frame times along a scripted camera path, without writing any frame", cmd);
+		TCLAP::ValueArg<uint32_t> warmup_arg("", "warmup", "Number of frames rendered before the benchmark starts measuring", false,
+											 config.benchmark.warmup_frames, "count", cmd);
+		TCLAP::ValueArg<uint32_t> measure_arg("", "measure", "Number of frames measured by the benchmark", false,
+											  config.benchmark.frames, "count", cmd);
+		TCLAP::ValueArg<std::string> camera_path_arg("", "camera-path", "JSON file with the keyframes of the benchmark camera", false,
+													 config.benchmark.camera_path.string(), "path", cmd);
+		TCLAP::ValueArg<std::string> report_arg("", "report", "File where the benchmark report is written as JSON", false,
+												config.benchmark.report_file.string(), "path", cmd);
+		TCLAP::ValueArg<std::string> scene_arg("", "scene", "Scene file, relative to the assets folder", false,
+											   config.assets.raymarch_program.scene_file.string(), "path", cmd);
+		TCLAP::ValueArg<uint32_t> cone_levels_arg("", "cone-levels", "Number of coarse levels of the cone prepass, 0 disables it", false,
+												  config.cone_prepass.levels, "count", cmd);
+		TCLAP::SwitchArg no_reprojection_arg("", "no-reprojection", "March every ray from the start, without the depth of the previous frame", cmd);
+		TCLAP::ValueArg<std::string> interlacing_arg("", "interlacing", "Pixels traced every frame, the others are rebuilt (none, half, quarter)",
+													 false, config.interlacing.mode, "mode", cmd);
+		TCLAP::ValueArg<uint32_t> aa_samples_arg("", "aa-samples", "Extra samples traced for the pixels on an edge, up to 8, 0 disables them", false,
+												 config.antialiasing.samples, "count", cmd);
+		TCLAP::ValueArg<uint32_t> bake_resolution_arg("", "bake-resolution", "Cells along every axis of the bake of the scene, 0 disables it", false,
+													  config.bake.resolution, "count", cmd);
+		TCLAP::SwitchArg no_cache_arg("", "no-cache", "Always compile the raymarch program, without using the program cache", cmd);
+		TCLAP::SwitchArg no_variants_arg("", "no-variants", "Read every setting from the uniforms, without specialized variants of the program", cmd);
+		TCLAP::SwitchArg autotune_arg("", "autotune", "Time the shapes of the work groups on the scene and use the fastest one", cmd);
+		TCLAP::ValueArg<uint32_t> width_arg("", "width", "Horizontal resolution", false,
+											config.resolution.width, "pixels", cmd);
+		TCLAP::ValueArg<uint32_t> height_arg("", "height", "Vertical resolution", false,
+											 config.resolution.height, "pixels", cmd);
+
+		cmd.parse(argc, argv);
+
+		config.headless.enabled |= headless_arg.getValue();
+		config.headless.frames = frames_arg.getValue();
+		config.headless.output_folder = output_arg.getValue();
+		config.headless.cpu |= cpu_arg.getValue();
+		config.headless.compare |= compare_arg.getValue();
+		config.headless.cpu_threads = threads_arg.getValue();
+		config.headless.cpu_isa = isa_arg.getValue();
+		config.headless.timings_file = timings_arg.getValue();
+		config.headless.statistics_file = statistics_arg.getValue();
+		config.benchmark.enabled |= benchmark_arg.getValue();
+		config.benchmark.warmup_frames = warmup_arg.getValue();
+		config.benchmark.frames = measure_arg.getValue();
+		config.benchmark.camera_path = camera_path_arg.getValue();
+		config.benchmark.report_file = report_arg.getValue();
+		config.assets.raymarch_program.scene_file = scene_arg.getValue();
+		config.cone_prepass.levels = cone_levels_arg.getValue();
+		config.reprojection.enabled &= !no_reprojection_arg.getValue();
+		config.interlacing.mode = interlacing_arg.getValue();
+		config.antialiasing.samples = aa_samples_arg.getValue();
+		config.bake.resolution = bake_resolution_arg.getValue();
+		config.program_cache.enabled &= !no_cache_arg.getValue();
+		config.assets.raymarch_program.specialize &= !no_variants_arg.getValue();
+		config.group_size.autotune |= autotune_arg.getValue();
+
+		/* The benchmark always runs offscreen */
+		config.headless.enabled |= config.benchmark.enabled;
+		config.resolution.width = width_arg.getValue();
+		config.resolution.height = height_arg.getValue();
+	}
+	catch (const TCLAP::ArgException& e)
+	{
+		std::cout << "ERROR: " << e.error() << " for argument " << e.argId() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
 #undef LOAD_BOOL_IF
 #undef LOAD_UINT_IF
 #undef LOAD_PATH_IF
+#undef LOAD_FLOAT_IF
+#undef LOAD_VEC3_IF
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
 #include "common.hpp"
 
 // NOTE(Corralx): Default values are used if no config file is found or the key is not defined
@@ -14,12 +15,111 @@ struct config_t
 
 	bool fullscreen = false;
 
+	struct
+	{
+		/* Scales the resolution the raymarch is dispatched at to hold the GPU time of a frame, only when running with a window */
+		bool enabled = true;
+		float target_ms = 16.6f;
+		/* Bounds of the scale of both dimensions of the resolution */
+		float min_scale = .5f;
+		float max_scale = 1.f;
+	} dynamic_resolution;
+
+	struct
+	{
+		bool enabled = false;
+		uint32_t frames = 60;
+		fs::path output_folder = "frames";
+
+		/* Renders on the CPU reference tracer instead of the GPU, without any OpenGL context */
+		bool cpu = false;
+		/* Renders every GPU frame on the CPU too and reports the difference between the two */
+		bool compare = false;
+		/* Number of CPU workers, 0 uses every hardware thread */
+		uint32_t cpu_threads = 0;
+		/* Instruction set of the CPU packet marcher: auto, reference, scalar, sse4, avx2 or avx512 */
+		std::string cpu_isa = "auto";
+		/* If not empty, the GPU timings of the last frames are written there as CSV or JSON */
+		fs::path timings_file = "";
+		/* If not empty, the raymarch statistics of the last frames are written there as CSV or JSON */
+		fs::path statistics_file = "";
+	} headless;
+
+	/* Headless run with a scripted camera and a fixed time step, which reports the frame time percentiles */
+	struct
+	{
+		bool enabled = false;
+		/* Rendered before the measure starts, to let the driver and the caches settle */
+		uint32_t warmup_frames = 60;
+		uint32_t frames = 600;
+		/* Keyframes of the camera, an orbit around the origin if empty */
+		fs::path camera_path = "";
+		/* Duration in seconds of the orbit used when there is no camera path */
+		float orbit_duration = 10.f;
+		/* Where the report is written as JSON, in addition to the standard output */
+		fs::path report_file = "bench.json";
+	} benchmark;
+
 	struct
 	{
 		uint32_t x = 32;
 		uint32_t y = 32;
+		/* Time a few shapes of the work groups on the scene at startup and keep the fastest, remembered by the program cache */
+		bool autotune = false;
 	} group_size;
 
+	struct
+	{
+		/* Number of coarse levels marched before the full resolution, 0 disables the prepass.
+		 * The finest level covers 4x4 pixels with every texel, and each coarser one twice as many along both axes.
+		 */
+		uint32_t levels = 2;
+	} cone_prepass;
+
+	struct
+	{
+		/* Keeps the depth of every frame, so the rays of the next one start from it when only the camera moved */
+		bool enabled = true;
+	} reprojection;
+
+	struct
+	{
+		/* Pixels traced every frame, the others are rebuilt from their neighbours and the previous frame: none, half or quarter */
+		std::string mode = "none";
+	} interlacing;
+
+	struct
+	{
+		/* Extra samples traced for the pixels on the edges of the surfaces only, up to 8, 0 disables the antialiasing */
+		uint32_t samples = 4;
+	} antialiasing;
+
+	struct
+	{
+		/* A still view is not rendered again, but refined with a jittered sample of every pixel per frame up to this many */
+		bool enabled = true;
+		uint32_t samples = 64;
+	} progressive;
+
+	struct
+	{
+		/* Cells along every axis of the box the scene is baked in, for the baked march, 0 disables the bake */
+		uint32_t resolution = 32;
+		glm::vec3 min = glm::vec3(-4.f);
+		glm::vec3 max = glm::vec3(4.f);
+		/* Bricks of samples for the cells near a surface, the others which need one are marched on the exact scene */
+		uint32_t max_bricks = 4096;
+		/* Layers of cells baked every frame, so baking a new scene never stalls the window */
+		uint32_t layers_per_frame = 4;
+	} bake;
+
+	struct
+	{
+		/* Linked programs and their reflection are reused across launches when the sources did not change */
+		bool enabled = true;
+		fs::path folder = "cache";
+	} program_cache;
+
 	struct
 	{
 		fs::path folder = "resources";
@@ -36,10 +136,19 @@ struct config_t
 			fs::path library_file = "raymarch_library.comp";
 			fs::path scene_file = "raymarch_scene.comp";
 			fs::path main_file = "raymarch_main.comp";
+			/* Only used when file system events are not available and the files are polled */
 			std::chrono::milliseconds scene_reload_interval = 500ms;
+			/* Changes closer than this are reported together */
+			std::chrono::milliseconds scene_reload_debounce = 50ms;
+			/* Compile a variant of the program with the shading features in use as constants */
+			bool specialize = true;
 		} raymarch_program;
 	} assets;
 
 };
 
+fs::path get_config_path();
 config_t load_config();
+
+// Command line arguments override the values loaded from the configuration file
+bool apply_command_line(int argc, char* argv[], config_t& config);
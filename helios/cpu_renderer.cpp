@@ -0,0 +1,314 @@
+#include "cpu_renderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/* Side of the square tiles, small enough to balance the load but large enough to amortize the scheduling */
+static constexpr uint32_t TILE_SIZE = 16;
+
+namespace
+{
+
+/* Everything a ray needs to be traced, mirrors the uniforms of raymarch_base.comp */
+struct context_t
+{
+	const cpu_scene& scene;
+	const raymarch_t& raymarch;
+	const light_t& light;
+	const scene_t& scene_settings;
+	/* Half the angle covered by a pixel, only used by the over-relaxed march */
+	float pixel_radius;
+};
+
+glm::vec3 saturate(const glm::vec3& v)
+{
+	return glm::clamp(v, glm::vec3(0.f), glm::vec3(1.f));
+}
+
+float saturate(float v)
+{
+	return glm::clamp(v, 0.f, 1.f);
+}
+
+glm::vec3 approximate_normal(const context_t& ctx, const glm::vec3& point)
+{
+	const glm::vec3 v = glm::vec3(ctx.raymarch.normal_epsilon, 0.f, 0.f);
+	const glm::vec3 v_yxz = glm::vec3(v.y, v.x, v.z);
+	const glm::vec3 v_zyx = glm::vec3(v.z, v.y, v.x);
+	const cpu_scene& s = ctx.scene;
+
+	return glm::normalize(glm::vec3(
+		s.distance(point + v) - s.distance(point - v),
+		s.distance(point + v_yxz) - s.distance(point - v_yxz),
+		s.distance(point + v_zyx) - s.distance(point - v_zyx)));
+}
+
+float shadow(const context_t& ctx, const glm::vec3& origin, const glm::vec3& light_vector, float k)
+{
+	const raymarch_t& r = ctx.raymarch;
+	float res = 1.f;
+
+	for (float t = r.shadow_starting_step; t < r.shadow_max_step; )
+	{
+		float h = ctx.scene.distance(origin + light_vector * t);
+
+		if (h < r.shadow_epsilon)
+			return 0.f;
+
+		if (r.soft_shadow)
+			res = std::min(res, k * h / t);
+
+		t += h;
+	}
+
+	return saturate(res);
+}
+
+float ambient_occlusion(const context_t& ctx, const glm::vec3& point, const glm::vec3& normal)
+{
+	float step_size = ctx.raymarch.ambient_occlusion_step;
+	float t = step_size;
+	float oc = 0.f;
+
+	for (int32_t i = 0; i < ctx.raymarch.ambient_occlusion_iterations; ++i)
+	{
+		float d = ctx.scene.distance(point + normal * t);
+		oc += t - d;
+		t += step_size;
+	}
+
+	return saturate(oc);
+}
+
+glm::vec3 shade(const context_t& ctx, const glm::vec3& p, const glm::vec3& n, const glm::vec3& color)
+{
+	glm::vec3 light_vector = glm::normalize(-ctx.light.direction);
+	float l_dot_n = std::max(glm::dot(light_vector, n), 0.f);
+
+	glm::vec3 color_out = ctx.light.color * l_dot_n * color;
+
+	if (ctx.raymarch.enable_shadow)
+		color_out *= shadow(ctx, p, light_vector, ctx.raymarch.shadow_quality) + .2f;
+
+	if (ctx.raymarch.enable_ambient_occlusion)
+		color_out *= 1.f - ambient_occlusion(ctx, p, n);
+
+	return saturate(color_out);
+}
+
+glm::vec3 floor_color(const glm::vec3& point)
+{
+	glm::vec2 m = glm::mod(glm::vec2(point.x, point.z), 2.f) - glm::vec2(1.f);
+	return m.x * m.y > 0.f ? glm::vec3(.4f) : glm::vec3(1.f);
+}
+
+void march_plain(const context_t& ctx, const glm::vec3& ro, const glm::vec3& rd, int32_t& it, float& dist)
+{
+	const raymarch_t& r = ctx.raymarch;
+	dist = r.starting_step;
+
+	for (it = 0; it < r.max_iterations; ++it)
+	{
+		float d = ctx.scene.distance(ro + rd * dist);
+
+		if (d < r.epsilon * dist || dist > r.z_far)
+			break;
+
+		dist += d;
+	}
+}
+
+void march_over_relaxed(const context_t& ctx, const glm::vec3& ro, const glm::vec3& rd, int32_t& it, float& dist)
+{
+	const raymarch_t& r = ctx.raymarch;
+	float omega = glm::clamp(r.relaxation, 1.f, 1.99f);
+	float previous_radius = 0.f;
+	float step_length = 0.f;
+	dist = r.starting_step;
+
+	for (it = 0; it < r.max_iterations; ++it)
+	{
+		float signed_radius = ctx.scene.distance(ro + rd * dist);
+		float radius = std::abs(signed_radius);
+
+		/* Back to where a plain step would have ended, if the spheres of the last two points do not overlap */
+		if (omega > 1.f && radius + previous_radius < step_length)
+		{
+			step_length = step_length / omega - step_length;
+			omega = 1.f;
+		}
+		else
+		{
+			if (radius < ctx.pixel_radius * dist || dist > r.z_far)
+				break;
+
+			step_length = signed_radius * omega;
+		}
+
+		previous_radius = radius;
+		dist += step_length;
+	}
+}
+
+void raymarch(const context_t& ctx, const glm::vec3& ro, const glm::vec3& rd, int32_t& it, float& dist)
+{
+	if (ctx.raymarch.march == march_mode::OVER_RELAXED)
+		march_over_relaxed(ctx, ro, rd, it, dist);
+	else
+		march_plain(ctx, ro, rd, it, dist);
+
+	dist = glm::clamp(dist, 0.f, ctx.raymarch.z_far);
+}
+
+glm::vec3 surface_color(const context_t& ctx, const glm::vec3& ro, const glm::vec3& rd, float t, int32_t iterations)
+{
+	glm::vec3 point;
+	glm::vec3 normal;
+	glm::vec3 base_color;
+
+	float floor_dist = (ctx.scene_settings.floor_height - ro.y) / rd.y;
+
+	if (floor_dist < t && floor_dist < ctx.raymarch.z_far && floor_dist > 0.f)
+	{
+		// Floor surface
+		t = floor_dist;
+		point = ro + rd * t;
+		normal = glm::vec3(0.f, 1.f, 0.f);
+		base_color = floor_color(point);
+	}
+	else if (iterations < ctx.raymarch.max_iterations && t < ctx.raymarch.z_far)
+	{
+		// Primitive surface
+		point = ro + rd * t;
+		normal = approximate_normal(ctx, point);
+		base_color = glm::vec3(.9f);
+	}
+	else
+	{
+		// Sky
+		return ctx.scene_settings.sky_color;
+	}
+
+	return shade(ctx, point, normal, base_color);
+}
+
+glm::vec3 compute_color(const context_t& ctx, const glm::vec3& ro, const glm::vec3& rd)
+{
+	float t;
+	int32_t iterations;
+
+	raymarch(ctx, ro, rd, iterations, t);
+	return surface_color(ctx, ro, rd, t, iterations);
+}
+
+void evaluate_scene(const void* user_data, const float* x, const float* y, const float* z, float* distance, uint32_t count)
+{
+	static_cast<const cpu_scene*>(user_data)->distances(x, y, z, distance, count);
+}
+
+}
+
+cpu_renderer::cpu_renderer(uint32_t num_threads, const packet_kernels_t* kernels) :
+	_scheduler(num_threads), _kernels(kernels)
+{
+}
+
+void cpu_renderer::render(const cpu_scene& scene, const raymarch_t& raymarch, const camera_t& camera, const light_t& light,
+						  const scene_t& scene_settings, uint32_t width, uint32_t height, std::vector<glm::vec3>& pixels)
+{
+	pixels.resize(static_cast<size_t>(width) * height);
+
+	float pixel_radius = 1.f / (static_cast<float>(height) * camera.focal_length * glm::length(camera.view));
+	const context_t ctx{ scene, raymarch, light, scene_settings, pixel_radius };
+
+	/* The packet kernels only implement the plain march, the over-relaxed one goes through the reference tracer.
+	 * There is no bake on the CPU, the baked march is the plain one on the exact scene.
+	 */
+	const packet_kernels_t* kernels = raymarch.march != march_mode::OVER_RELAXED ? _kernels : nullptr;
+
+	uint32_t tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+	uint32_t tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+	glm::vec2 resolution = glm::vec2(width, height);
+	float aspect_ratio = resolution.x / resolution.y;
+
+	const packet_march_params_t march_params = { raymarch.epsilon, raymarch.z_far, raymarch.starting_step, raymarch.max_iterations };
+
+	_scheduler.parallel_for(tiles_x * tiles_y, [&](uint32_t tile)
+	{
+		uint32_t x0 = (tile % tiles_x) * TILE_SIZE;
+		uint32_t y0 = (tile / tiles_x) * TILE_SIZE;
+		uint32_t x1 = std::min(x0 + TILE_SIZE, width);
+		uint32_t y1 = std::min(y0 + TILE_SIZE, height);
+
+		/* Primary rays of the tile, the origin is shared but the packet marcher expects one for every ray */
+		float origin[3][TILE_SIZE * TILE_SIZE];
+		float direction[3][TILE_SIZE * TILE_SIZE];
+		float distance[TILE_SIZE * TILE_SIZE];
+		int32_t iterations[TILE_SIZE * TILE_SIZE];
+		uint32_t count = 0;
+
+		for (uint32_t y = y0; y < y1; ++y)
+		{
+			for (uint32_t x = x0; x < x1; ++x, ++count)
+			{
+				float u = x * 2.f / resolution.x - 1.f;
+				float v = y * 2.f / resolution.y - 1.f;
+
+				glm::vec3 ray_dir = glm::normalize(camera.view * camera.focal_length +
+												   camera.right * u * aspect_ratio + camera.up * v);
+
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					origin[c][count] = camera.position[c];
+					direction[c][count] = ray_dir[c];
+				}
+			}
+		}
+
+		if (kernels)
+		{
+			const packet_rays_t rays = { { origin[0], origin[1], origin[2] }, { direction[0], direction[1], direction[2] }, count };
+			kernels->march(&evaluate_scene, &scene, march_params, rays, { distance, iterations });
+		}
+
+		/* Shadows, ambient occlusion and normals are not coherent enough to benefit from packets */
+		uint32_t index = 0;
+		for (uint32_t y = y0; y < y1; ++y)
+		{
+			for (uint32_t x = x0; x < x1; ++x, ++index)
+			{
+				glm::vec3 ray_dir = glm::vec3(direction[0][index], direction[1][index], direction[2][index]);
+
+				pixels[static_cast<size_t>(y) * width + x] = kernels ?
+					surface_color(ctx, camera.position, ray_dir, distance[index], iterations[index]) :
+					compute_color(ctx, camera.position, ray_dir);
+			}
+		}
+	});
+}
+
+void resolve_cpu_frame(const std::vector<glm::vec3>& pixels, const postprocess_t& postprocess,
+					   uint32_t width, uint32_t height, std::vector<uint8_t>& rgba)
+{
+	rgba.resize(static_cast<size_t>(width) * height * 4);
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			size_t index = static_cast<size_t>(y) * width + x;
+
+			/* Vignette, sampled at the pixel center as gl_FragCoord does */
+			glm::vec2 tex_coord = (glm::vec2(x, y) + .5f) / glm::vec2(width, height);
+			float dist = glm::distance(tex_coord, glm::vec2(.5f));
+			float edge = glm::clamp((dist - postprocess.vignette_radius) /
+									(postprocess.vignette_smoothness - postprocess.vignette_radius), 0.f, 1.f);
+			glm::vec3 color = pixels[index] * (edge * edge * (3.f - 2.f * edge));
+
+			for (uint32_t c = 0; c < 3; ++c)
+				rgba[index * 4 + c] = static_cast<uint8_t>(std::lround(glm::clamp(color[c], 0.f, 1.f) * 255.f));
+			rgba[index * 4 + 3] = 255;
+		}
+	}
+}
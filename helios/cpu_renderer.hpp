@@ -0,0 +1,38 @@
+#pragma once
+
+#include "cpu_scene.hpp"
+#include "packet_marcher.hpp"
+#include "task_scheduler.hpp"
+#include "uniform_utils.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/* Native reference of the sphere tracer in raymarch_main.comp.
+ * Every _hl_* function of the compute shader has its counterpart here, driven by the same
+ * parameter structs, so the two images can be compared pixel by pixel.
+ * The frame is split in square tiles which are spread over all the cores.
+ * The primary rays of every tile are marched in packets with the given kernels,
+ * while with nullptr kernels every ray is marched on its own like the compute shader does.
+ */
+class cpu_renderer
+{
+public:
+	// A value of 0 uses one worker for every hardware thread
+	explicit cpu_renderer(uint32_t num_threads = 0, const packet_kernels_t* kernels = best_packet_kernels());
+
+	/* Pixels are stored starting from the bottom row, the same layout of the compute shader output image */
+	void render(const cpu_scene& scene, const raymarch_t& raymarch, const camera_t& camera, const light_t& light,
+				const scene_t& scene_settings, uint32_t width, uint32_t height, std::vector<glm::vec3>& pixels);
+
+	uint32_t num_threads() const { return _scheduler.num_workers(); }
+	const packet_kernels_t* kernels() const { return _kernels; }
+
+private:
+	task_scheduler _scheduler;
+	const packet_kernels_t* _kernels;
+};
+
+/* Applies the same postprocessing of copy.frag and quantizes the result to RGBA8 */
+void resolve_cpu_frame(const std::vector<glm::vec3>& pixels, const postprocess_t& postprocess,
+					   uint32_t width, uint32_t height, std::vector<uint8_t>& rgba);
@@ -0,0 +1,114 @@
+#include "cpu_scene.hpp"
+#include "sdf_library.hpp"
+
+#include <algorithm>
+
+void cpu_scene::distances(const float* x, const float* y, const float* z, float* distance, uint32_t count) const
+{
+	for (uint32_t i = 0; i < count; ++i)
+		distance[i] = this->distance(glm::vec3(x[i], y[i], z[i]));
+}
+
+default_scene::default_scene(const packet_kernels_t* kernels) : _kernels(kernels), _params()
+{
+}
+
+void default_scene::update(float time, const uniform_registry& uniforms)
+{
+	_params.time = time;
+
+	const uniform_t* sphere_radius = uniforms.find("sphere_radius");
+	if (sphere_radius && sphere_radius->type == uniform_type::FLOAT)
+		_params.sphere_radius = sphere_radius->values[0].vec4.x;
+
+	const uniform_t* thorus_radius = uniforms.find("thorusRadius");
+	if (thorus_radius && thorus_radius->type == uniform_type::VEC2)
+	{
+		_params.thorus_radius[0] = thorus_radius->values[0].vec4.x;
+		_params.thorus_radius[1] = thorus_radius->values[0].vec4.y;
+	}
+}
+
+float default_scene::distance(const glm::vec3& point) const
+{
+	using namespace sdf;
+
+	float time = _params.time;
+	vec2 thorus_radius = vec2(_params.thorus_radius[0], _params.thorus_radius[1]);
+
+	float obj = sd_box(point, vec3(1.f, 1.f, 1.f + .5f * glm::sin(time)));
+	obj = op_union(obj, sd_torus(rotate_x(point, time) + vec3(2.f, .5f, .0f), thorus_radius));
+	return op_union(obj, sd_sphere(point - vec3(1.5f, 1.5f, .0f), _params.sphere_radius));
+}
+
+void default_scene::distances(const float* x, const float* y, const float* z, float* distance, uint32_t count) const
+{
+	if (_kernels)
+		_kernels->default_scene(_params, x, y, z, distance, count);
+	else
+		cpu_scene::distances(x, y, z, distance, count);
+}
+
+vm_scene::vm_scene(scene_program_t program) : _program(std::move(program)), _uniform_values(_program.uniforms.size() * 4, 0.f)
+{
+}
+
+void vm_scene::update(float time, const uniform_registry& uniforms)
+{
+	std::fill(_uniform_values.begin(), _uniform_values.end(), 0.f);
+
+	for (size_t i = 0; i < _program.uniforms.size(); ++i)
+	{
+		const std::string& name = _program.uniforms[i].name;
+		float* value = _uniform_values.data() + i * 4;
+
+		if (name == "time")
+		{
+			value[0] = time;
+			continue;
+		}
+
+		// The compiler rejects any scene reading a matrix or an array, so only the first value is ever needed
+		const uniform_t* u = uniforms.find(name);
+		if (!u)
+			continue;
+
+		const uniform_value_t& v = u->values[0];
+
+		/* Every type is stored as floats by the bytecode */
+		switch (u->type)
+		{
+			case uniform_type::FLOAT:
+			case uniform_type::VEC2:
+			case uniform_type::VEC3:
+			case uniform_type::VEC4:
+			case uniform_type::DOUBLE:
+			case uniform_type::DVEC2:
+			case uniform_type::DVEC3:
+			case uniform_type::DVEC4:
+				std::copy(glm::value_ptr(v.vec4), glm::value_ptr(v.vec4) + 4, value);
+				break;
+
+			case uniform_type::BOOL:
+				value[0] = v.boolean ? 1.f : 0.f;
+				break;
+
+			default:
+				for (int32_t c = 0; c < 4; ++c)
+					value[c] = static_cast<float>(v.ivec4[c]);
+				break;
+		}
+	}
+}
+
+float vm_scene::distance(const glm::vec3& point) const
+{
+	float d;
+	execute_scene_program(_program, _uniform_values.data(), &point.x, &point.y, &point.z, &d, 1);
+	return d;
+}
+
+void vm_scene::distances(const float* x, const float* y, const float* z, float* distance, uint32_t count) const
+{
+	execute_scene_program(_program, _uniform_values.data(), x, y, z, distance, count);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "packet_marcher.hpp"
+#include "uniform_utils.hpp"
+
+#include <vector>
+
+/* Distance field evaluated by the CPU renderer, the native counterpart of the scene() GLSL function */
+class cpu_scene
+{
+public:
+	virtual ~cpu_scene() = default;
+
+	/* Called once per frame, before any evaluation, with the same values bound to the compute shader */
+	virtual void update(float time, const uniform_registry& uniforms) = 0;
+
+	// Must be thread safe, it is called concurrently from every worker
+	virtual float distance(const glm::vec3& point) const = 0;
+
+	/* Evaluates count points at once, stored as separate x/y/z arrays, used by the packet marcher.
+	 * The default implementation simply calls distance() for every point.
+	 */
+	virtual void distances(const float* x, const float* y, const float* z, float* distance, uint32_t count) const;
+};
+
+/* Hand-written port of the default raymarch_scene.comp */
+class default_scene : public cpu_scene
+{
+public:
+	// With nullptr kernels distances() falls back to the scalar glm version
+	explicit default_scene(const packet_kernels_t* kernels = best_packet_kernels());
+
+	void update(float time, const uniform_registry& uniforms) override;
+	float distance(const glm::vec3& point) const override;
+	void distances(const float* x, const float* y, const float* z, float* distance, uint32_t count) const override;
+
+private:
+	const packet_kernels_t* _kernels;
+	default_scene_params_t _params;
+};
+
+/* Any scene() evaluated through the bytecode compiled from the shader AST */
+class vm_scene : public cpu_scene
+{
+public:
+	explicit vm_scene(scene_program_t program);
+
+	void update(float time, const uniform_registry& uniforms) override;
+	float distance(const glm::vec3& point) const override;
+	void distances(const float* x, const float* y, const float* z, float* distance, uint32_t count) const override;
+
+private:
+	scene_program_t _program;
+	/* 4 floats for every uniform of the program */
+	std::vector<float> _uniform_values;
+};
@@ -1,35 +1,155 @@
 #include "file_watcher.hpp"
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 
-file_watcher::file_watcher(fs::path _path, interval_t _interval, callback_t _callback) :
-	path(_path), interval(_interval), callback(_callback),
-	_should_continue(false), _last_write_time(), _started(false)
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+file_watcher::file_watcher(std::vector<fs::path> _paths, interval_t _interval, callback_t _callback) :
+	paths(std::move(_paths)), interval(_interval), callback(_callback),
+	_mutex(), _condition(), _should_continue(false), _wake_pipe{ -1, -1 }, _watcher(), _started(false)
+{
+}
+
+file_watcher::~file_watcher()
+{
+	stop();
+}
+
+bool file_watcher::_wait(interval_t time)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	return !_condition.wait_for(lock, time, [this]() { return !_should_continue; });
+}
+
+#ifdef __linux__
+bool file_watcher::_watch_events()
+{
+	int32_t fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	/* Files are watched through their folder, which keeps reporting them after they have been replaced */
+	struct watch_t
+	{
+		int32_t descriptor;
+		fs::path folder;
+		fs::path name;
+	};
+
+	std::vector<watch_t> watches;
+	const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+	for (const auto& path : paths)
+	{
+		bool folder = fs::is_directory(path);
+		fs::path watched = folder ? path : path.parent_path();
+
+		int32_t descriptor = inotify_add_watch(fd, watched.string().c_str(), mask);
+		if (descriptor < 0)
+		{
+			close(fd);
+			return false;
+		}
+
+		watches.push_back({ descriptor, watched, folder ? fs::path() : path.filename() });
+	}
+
+	std::vector<fs::path> changed;
+	alignas(inotify_event) char buffer[4096];
+
+	while (true)
+	{
+		pollfd fds[2] = { { fd, POLLIN, 0 }, { _wake_pipe[0], POLLIN, 0 } };
+
+		/* Sleep until something happens, then only for the debounce interval to collect the rest of the burst */
+		int32_t timeout = changed.empty() ? -1 : static_cast<int32_t>(debounce.count());
+		int32_t ready = poll(fds, 2, timeout);
+
+		if (fds[1].revents & POLLIN)
+			break;
+
+		if (ready == 0)
+		{
+			callback(changed);
+			changed.clear();
+			continue;
+		}
+
+		ssize_t length;
+		while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* ptr = buffer; ptr < buffer + length;)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+				ptr += sizeof(inotify_event) + event->len;
+
+				if (event->len == 0)
+					continue;
+
+				fs::path name = event->name;
+				for (const auto& watch : watches)
+				{
+					if (watch.descriptor != event->wd || (!watch.name.empty() && watch.name != name))
+						continue;
+
+					fs::path path = watch.folder / name;
+					if (std::find(changed.begin(), changed.end(), path) == changed.end())
+						changed.push_back(path);
+				}
+			}
+		}
+	}
+
+	close(fd);
+	return true;
+}
+#else
+bool file_watcher::_watch_events()
 {
+	return false;
 }
+#endif
 
-void file_watcher::_check()
+void file_watcher::_poll()
 {
-	using hr_clock = std::chrono::high_resolution_clock;
+	auto last_write_time = [](const fs::path& path)
+	{
+		// The file might be missing for a moment while an editor replaces it
+		std::error_code error;
+		auto time = fs::last_write_time(path, error);
+		return error ? fs::file_time_type::min() : time;
+	};
 
-	_last_write_time = fs::last_write_time(path);
+	std::vector<fs::file_time_type> write_times;
+	for (const auto& path : paths)
+		write_times.push_back(last_write_time(path));
 
-	while (_should_continue)
+	std::vector<fs::path> changed;
+	while (_wait(changed.empty() ? interval : debounce))
 	{
-		auto current_write_time = fs::last_write_time(path);
-		if (_last_write_time < current_write_time)
+		bool modified = false;
+		for (size_t i = 0; i < paths.size(); ++i)
 		{
-			callback();
-			_last_write_time = current_write_time;
+			auto current_write_time = last_write_time(paths[i]);
+			if (write_times[i] < current_write_time)
+			{
+				write_times[i] = current_write_time;
+				modified = true;
+
+				if (std::find(changed.begin(), changed.end(), paths[i]) == changed.end())
+					changed.push_back(paths[i]);
+			}
 		}
 
-		// This is to avoid blocking the main thread during the stop() call because of the join()
-		auto sleep_starting_time = hr_clock::now();
-		while ((hr_clock::now() - sleep_starting_time) < interval)
+		if (!modified && !changed.empty())
 		{
-			if (!_should_continue)
-				return;
-			std::this_thread::sleep_for(5ms);
+			callback(changed);
+			changed.clear();
 		}
 	}
 }
@@ -39,20 +159,35 @@ void file_watcher::start()
 	if (_started)
 		return;
 
-	if (path.empty())
+	if (paths.empty())
 	{
 		std::cout << "No file set to watch for!" << std::endl;
 		return;
 	}
 
-	if (!fs::exists(path))
+	for (const auto& path : paths)
 	{
-		std::cout << "File " << path << " does not exists!" << std::endl;
-		return;
+		if (!fs::exists(path))
+		{
+			std::cout << "File " << path << " does not exists!" << std::endl;
+			return;
+		}
 	}
 
+#ifdef __linux__
+	if (pipe(_wake_pipe) != 0)
+		_wake_pipe[0] = _wake_pipe[1] = -1;
+#endif
+
 	_should_continue = true;
-	_watcher = std::thread(&file_watcher::_check, this);
+	_watcher = std::thread([this]()
+	{
+		if (_wake_pipe[0] >= 0 && _watch_events())
+			return;
+
+		std::cout << "WARNING: File system events are not available, polling for changes!" << std::endl;
+		_poll();
+	});
 	_started = true;
 }
 
@@ -61,7 +196,31 @@ void file_watcher::stop()
 	if (!_started)
 		return;
 
-	_should_continue = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_should_continue = false;
+	}
+	_condition.notify_all();
+
+#ifdef __linux__
+	if (_wake_pipe[1] >= 0)
+	{
+		char wake = 0;
+		ssize_t written = write(_wake_pipe[1], &wake, 1);
+		(void)written;
+	}
+#endif
+
 	_watcher.join();
+
+#ifdef __linux__
+	for (int32_t& fd : _wake_pipe)
+	{
+		if (fd >= 0)
+			close(fd);
+		fd = -1;
+	}
+#endif
+
 	_started = false;
 }
@@ -1,41 +1,59 @@
 #pragma once
 
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
+#include <mutex>
 #include <thread>
+#include <vector>
 #include "common.hpp"
 
+/* On Linux the parent folders are watched through inotify, so the thread sleeps until something changes
+ * and files replaced through a rename (like most editors do on save) are detected too.
+ * Elsewhere, or if inotify is not available, the modification time of every path is polled instead.
+ * In both cases a burst of changes is reported with a single call, once nothing changed for the debounce interval.
+ */
 class file_watcher
 {
 public:
-	using callback_t = std::function<void()>;
+	using callback_t = std::function<void(const std::vector<fs::path>&)>;
 	using interval_t = std::chrono::milliseconds;
 
-	explicit file_watcher(fs::path path = "", interval_t interval = interval_t::max(), callback_t callback = callback_t());
+	explicit file_watcher(std::vector<fs::path> paths = {}, interval_t interval = interval_t::max(), callback_t callback = callback_t());
 	file_watcher(const file_watcher&) = delete;
-	file_watcher(file_watcher&&) = default;
-	~file_watcher() = default;
+	~file_watcher();
 
 	file_watcher& operator=(const file_watcher&) = delete;
-	file_watcher& operator=(file_watcher&&) = default;
 
 	void start();
 	void stop();
 
-	/* The path of the file to look for changes */
-	fs::path path;
+	/* The files or folders to look for changes */
+	std::vector<fs::path> paths;
 
-	/* The interval between checks in milliseconds */
+	/* The interval between checks when polling */
 	interval_t interval;
 
-	/* The callback to call when a change is detected */
+	/* How long to wait for more changes before calling the callback */
+	interval_t debounce = 50ms;
+
+	/* The callback to call with every path which changed */
 	callback_t callback;
 
 private:
-	void _check();
+	bool _watch_events();
+	void _poll();
+
+	/* Returns false if the watcher has been stopped in the meantime */
+	bool _wait(interval_t time);
 
+	std::mutex _mutex;
+	std::condition_variable _condition;
 	bool _should_continue;
-	fs::file_time_type _last_write_time;
+
+	/* Written on stop() to wake up the inotify thread */
+	int32_t _wake_pipe[2];
+
 	std::thread _watcher;
 	bool _started;
 };
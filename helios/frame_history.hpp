@@ -0,0 +1,139 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* A column of a dumped history, written for every frame after its index */
+template <typename T>
+struct history_column_t
+{
+	const char* name;
+	std::function<void(std::ostream&, const T&)> write;
+};
+
+/* Results read back from the GPU a few frames after they were recorded, kept in a ring of the last frames.
+ * T must have a uint64_t frame member. The frames recorded before the last reset might still arrive afterwards,
+ * so they are recognized by their index and thrown away.
+ */
+template <typename T>
+class frame_history
+{
+public:
+	explicit frame_history(uint32_t size) : _frames(), _size(std::max(size, 1u)), _next(0), _first_frame(0) {}
+
+	/* Forgets every frame, the ones older than first_frame are ignored from now on */
+	void reset(uint32_t size, uint64_t first_frame)
+	{
+		_size = std::max(size, 1u);
+		_frames.clear();
+		_frames.reserve(_size);
+		_next = 0;
+		_first_frame = first_frame;
+	}
+
+	/* False if the frame was recorded before the last reset */
+	bool accepts(uint64_t frame) const { return frame >= _first_frame; }
+
+	void push(const T& frame)
+	{
+		if (_frames.size() < _size)
+			_frames.push_back(frame);
+		else
+			_frames[_next] = frame;
+		_next = (_next + 1) % _size;
+	}
+
+	bool empty() const { return _frames.empty(); }
+	uint32_t capacity() const { return _size; }
+
+	/* The newest frame, or a default one if there is none */
+	const T& last() const
+	{
+		static const T none;
+		if (_frames.empty())
+			return none;
+
+		return _frames[(_next + _frames.size() - 1) % _frames.size()];
+	}
+
+	/* In no particular order, enough for anything which does not depend on it */
+	const std::vector<T>& frames() const { return _frames; }
+
+	/* From the oldest to the newest */
+	std::vector<T> ordered() const
+	{
+		if (_frames.size() < _size)
+			return _frames;
+
+		std::vector<T> ordered(_frames.begin() + _next, _frames.end());
+		ordered.insert(ordered.end(), _frames.begin(), _frames.begin() + _next);
+		return ordered;
+	}
+
+	/* The format is chosen from the extension, .json or anything else for CSV. The JSON header goes before the frames,
+	 * as members of the root object ending with a comma.
+	 */
+	bool dump(const fs::path& path, const char* description, const std::vector<history_column_t<T>>& columns,
+			  const std::string& json_header = std::string()) const
+	{
+		std::ofstream stream(path);
+		if (!stream.is_open() || !stream.good())
+		{
+			std::cout << "ERROR: Could not write the " << description << " to " << path << "!" << std::endl;
+			return false;
+		}
+
+		auto frames = ordered();
+
+		if (path.extension() == ".json")
+		{
+			stream << "{\n" << json_header << "\t\"frames\":\n\t[\n";
+
+			for (size_t i = 0; i < frames.size(); ++i)
+			{
+				stream << "\t\t{ \"frame\": " << frames[i].frame;
+				for (const auto& column : columns)
+				{
+					stream << ", \"" << column.name << "\": ";
+					column.write(stream, frames[i]);
+				}
+				stream << " }" << (i + 1 < frames.size() ? ",\n" : "\n");
+			}
+
+			stream << "\t]\n}\n";
+		}
+		else
+		{
+			stream << "frame";
+			for (const auto& column : columns)
+				stream << "," << column.name;
+			stream << "\n";
+
+			for (const auto& frame : frames)
+			{
+				stream << frame.frame;
+				for (const auto& column : columns)
+				{
+					stream << ",";
+					column.write(stream, frame);
+				}
+				stream << "\n";
+			}
+		}
+
+		return stream.good();
+	}
+
+private:
+	std::vector<T> _frames;
+	uint32_t _size;
+	uint32_t _next;
+	uint64_t _first_frame;
+};
@@ -0,0 +1,253 @@
+#include "gpu_profiler.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+/* Index of the GPU and CPU totals after the passes, used to extract a single series from the history */
+static constexpr size_t GPU_TOTAL = GPU_PASS_COUNT;
+static constexpr size_t CPU_TOTAL = GPU_PASS_COUNT + 1;
+
+static float series_value(const frame_timings_t& timings, size_t member)
+{
+	if (member == GPU_TOTAL)
+		return timings.gpu;
+	if (member == CPU_TOTAL)
+		return timings.cpu;
+	return timings.passes[member];
+}
+
+static float percentile(std::vector<float>& values, float p)
+{
+	size_t index = std::min(values.size() - 1, static_cast<size_t>(p * static_cast<float>(values.size())));
+	std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+	return values[index];
+}
+
+gpu_profiler::gpu_profiler() :
+	_sets(), _current(0), _frame(0), _last_frame(), _history(GPU_PROFILER_HISTORY), _created(false)
+{
+}
+
+bool gpu_profiler::create()
+{
+	if (_created)
+		return true;
+
+	for (auto& set : _sets)
+	{
+		glGenQueries(static_cast<int32_t>(set.queries.size()), set.queries.data());
+		set.issued.fill(false);
+		set.pending = false;
+	}
+
+	_current = 0;
+	_frame = 0;
+	_last_frame = std::chrono::high_resolution_clock::now();
+	reset(_history.capacity());
+
+	if (glGetError() != GL_NO_ERROR)
+	{
+		std::cout << "ERROR: Failed to create the timer queries!" << std::endl;
+		destroy();
+		return false;
+	}
+
+	_created = true;
+	return true;
+}
+
+void gpu_profiler::destroy()
+{
+	for (auto& set : _sets)
+	{
+		glDeleteQueries(static_cast<int32_t>(set.queries.size()), set.queries.data());
+		set.queries.fill(0);
+	}
+
+	_created = false;
+}
+
+void gpu_profiler::begin(gpu_pass pass)
+{
+	if (!_created)
+		return;
+
+	auto index = static_cast<uint32_t>(pass);
+	glQueryCounter(_sets[_current].queries[index * 2], GL_TIMESTAMP);
+}
+
+void gpu_profiler::end(gpu_pass pass)
+{
+	if (!_created)
+		return;
+
+	auto index = static_cast<uint32_t>(pass);
+	auto& set = _sets[_current];
+	glQueryCounter(set.queries[index * 2 + 1], GL_TIMESTAMP);
+	set.issued[index] = true;
+}
+
+void gpu_profiler::begin_frame()
+{
+	_last_frame = std::chrono::high_resolution_clock::now();
+}
+
+void gpu_profiler::end_frame()
+{
+	if (!_created)
+		return;
+
+	auto now = std::chrono::high_resolution_clock::now();
+	auto& set = _sets[_current];
+	/* A frame which only presented the last image again says nothing about the cost of rendering one, so it is not collected */
+	set.pending = set.issued[static_cast<uint32_t>(gpu_pass::RAYMARCH)];
+	set.frame = _frame++;
+	set.cpu = std::chrono::duration<float, std::milli>(now - _last_frame).count();
+	_last_frame = now;
+
+	/* Read every set whose results arrived from the oldest, the next one is dropped if the GPU is still behind it */
+	_current = (_current + 1) % GPU_PROFILER_LATENCY;
+	for (uint32_t i = 0; i < GPU_PROFILER_LATENCY; ++i)
+	{
+		auto& older = _sets[(_current + i) % GPU_PROFILER_LATENCY];
+		if (older.pending)
+			_collect(older);
+	}
+
+	auto& next = _sets[_current];
+	next.pending = false;
+	next.issued.fill(false);
+}
+
+void gpu_profiler::reset(uint32_t history_size)
+{
+	_history.reset(history_size, _frame);
+}
+
+void gpu_profiler::_collect(query_set_t& set)
+{
+	if (!_history.accepts(set.frame))
+	{
+		set.pending = false;
+		return;
+	}
+
+	/* Timestamps complete in order, so the last one issued is enough to know the whole set is available */
+	uint32_t last = invalid_handle;
+	for (uint32_t p = 0; p < GPU_PASS_COUNT; ++p)
+		if (set.issued[p])
+			last = p;
+
+	int32_t available = GL_FALSE;
+	glGetQueryObjectiv(set.queries[last * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return;
+
+	frame_timings_t timings;
+	timings.frame = set.frame;
+	timings.cpu = set.cpu;
+
+	uint64_t first_begin = std::numeric_limits<uint64_t>::max();
+	uint64_t last_end = 0;
+
+	for (uint32_t p = 0; p < GPU_PASS_COUNT; ++p)
+	{
+		if (!set.issued[p])
+			continue;
+
+		uint64_t begin = 0, end = 0;
+		glGetQueryObjectui64v(set.queries[p * 2], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(set.queries[p * 2 + 1], GL_QUERY_RESULT, &end);
+
+		timings.passes[p] = static_cast<float>(end - begin) / 1e6f;
+		first_begin = std::min(first_begin, begin);
+		last_end = std::max(last_end, end);
+	}
+
+	timings.gpu = static_cast<float>(last_end - first_begin) / 1e6f;
+	set.pending = false;
+
+	_history.push(timings);
+}
+
+pass_statistics_t gpu_profiler::_statistics(size_t member) const
+{
+	pass_statistics_t statistics;
+	if (_history.empty())
+		return statistics;
+
+	std::vector<float> values;
+	values.reserve(_history.frames().size());
+	for (const auto& timings : _history.frames())
+		values.push_back(series_value(timings, member));
+
+	statistics.last = series_value(last(), member);
+	statistics.p50 = percentile(values, .50f);
+	statistics.p95 = percentile(values, .95f);
+	statistics.p99 = percentile(values, .99f);
+
+	return statistics;
+}
+
+const frame_timings_t& gpu_profiler::last() const
+{
+	return _history.last();
+}
+
+pass_statistics_t gpu_profiler::statistics(gpu_pass pass) const
+{
+	return _statistics(static_cast<size_t>(pass));
+}
+
+pass_statistics_t gpu_profiler::gpu_statistics() const
+{
+	return _statistics(GPU_TOTAL);
+}
+
+pass_statistics_t gpu_profiler::cpu_statistics() const
+{
+	return _statistics(CPU_TOTAL);
+}
+
+std::vector<frame_timings_t> gpu_profiler::history() const
+{
+	return _history.ordered();
+}
+
+bool gpu_profiler::dump(const fs::path& path) const
+{
+	std::vector<history_column_t<frame_timings_t>> columns;
+	for (uint32_t p = 0; p < GPU_PASS_COUNT; ++p)
+		columns.push_back({ pass_name(static_cast<gpu_pass>(p)), [p](std::ostream& s, const frame_timings_t& f) { s << f.passes[p]; } });
+	columns.push_back({ "gpu", [](std::ostream& s, const frame_timings_t& f) { s << f.gpu; } });
+	columns.push_back({ "cpu", [](std::ostream& s, const frame_timings_t& f) { s << f.cpu; } });
+
+	/* The JSON starts with the percentiles of every series */
+	std::ostringstream header;
+	auto write_statistics = [&header](const char* name, const pass_statistics_t& s, bool last)
+	{
+		header << "\t\t\"" << name << "\": { \"p50\": " << s.p50 << ", \"p95\": " << s.p95
+			   << ", \"p99\": " << s.p99 << " }" << (last ? "\n" : ",\n");
+	};
+
+	header << "\t\"statistics\":\n\t{\n";
+	for (uint32_t p = 0; p < GPU_PASS_COUNT; ++p)
+		write_statistics(pass_name(static_cast<gpu_pass>(p)), statistics(static_cast<gpu_pass>(p)), false);
+	write_statistics("gpu", gpu_statistics(), false);
+	write_statistics("cpu", cpu_statistics(), true);
+	header << "\t},\n";
+
+	return _history.dump(path, "timings", columns, header.str());
+}
+
+const char* gpu_profiler::pass_name(gpu_pass pass)
+{
+	switch (pass)
+	{
+		case gpu_pass::RAYMARCH:	return "raymarch";
+		case gpu_pass::COPY:		return "copy";
+		case gpu_pass::GUI:			return "gui";
+		default:					return "unknown";
+	}
+}
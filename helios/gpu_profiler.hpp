@@ -0,0 +1,115 @@
+#pragma once
+
+#include "common.hpp"
+#include "frame_history.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Number of frames whose queries can be in flight before their results are needed */
+static constexpr uint32_t GPU_PROFILER_LATENCY = 4;
+/* Number of frames used for the percentiles and the graph, unless reset() asks for more */
+static constexpr uint32_t GPU_PROFILER_HISTORY = 256;
+
+enum class gpu_pass : uint8_t
+{
+	RAYMARCH = 0,
+	COPY,
+	GUI,
+
+	COUNT
+};
+
+static constexpr uint32_t GPU_PASS_COUNT = static_cast<uint32_t>(gpu_pass::COUNT);
+
+struct pass_statistics_t
+{
+	float last = 0.f;
+	float p50 = 0.f;
+	float p95 = 0.f;
+	float p99 = 0.f;
+};
+
+/* Timings of a single frame in milliseconds, passes which did not run are 0 */
+struct frame_timings_t
+{
+	uint64_t frame = 0;
+	std::array<float, GPU_PASS_COUNT> passes = {};
+	/* From the first to the last timestamp of the frame on the GPU */
+	float gpu = 0.f;
+	/* On the CPU from the last call to begin_frame or end_frame, whichever came later, to end_frame */
+	float cpu = 0.f;
+};
+
+/* Every pass is wrapped in a pair of GL_TIMESTAMP queries, with a set of queries for every frame in flight.
+ * The results of a frame are only read once the GPU made them available, GPU_PROFILER_LATENCY frames later,
+ * so the CPU never waits on the GPU: if they are still not available when the set is needed again they are dropped.
+ * Only the frames which ran the raymarch pass are collected, the idle ones presenting the last image again are left out.
+ */
+class gpu_profiler
+{
+public:
+	gpu_profiler();
+	gpu_profiler(const gpu_profiler&) = delete;
+	~gpu_profiler() = default;
+
+	gpu_profiler& operator=(const gpu_profiler&) = delete;
+
+	// Both require a current GL context
+	bool create();
+	void destroy();
+
+	void begin(gpu_pass pass);
+	void end(gpu_pass pass);
+
+	/* Optional, restarts the CPU time of the frame so the time spent waiting for events before it is left out */
+	void begin_frame();
+
+	/* Must be called once per frame, after the last pass */
+	void end_frame();
+
+	/* Forgets every frame collected so far or still in flight, and keeps the last history_size frames from now on */
+	void reset(uint32_t history_size = GPU_PROFILER_HISTORY);
+
+	/* Index of the frame being recorded, the next one end_frame() closes */
+	uint64_t frame() const { return _frame; }
+
+	/* The newest collected frame, or a frame of zeros if there is none */
+	const frame_timings_t& last() const;
+
+	pass_statistics_t statistics(gpu_pass pass) const;
+	pass_statistics_t gpu_statistics() const;
+	pass_statistics_t cpu_statistics() const;
+
+	/* The collected frames, from the oldest to the newest */
+	std::vector<frame_timings_t> history() const;
+
+	/* The format is chosen from the extension, .json or anything else for CSV */
+	bool dump(const fs::path& path) const;
+
+	static const char* pass_name(gpu_pass pass);
+
+private:
+	struct query_set_t
+	{
+		/* A begin and an end timestamp for every pass */
+		std::array<uint32_t, GPU_PASS_COUNT * 2> queries = {};
+		std::array<bool, GPU_PASS_COUNT> issued = {};
+		bool pending = false;
+		uint64_t frame = 0;
+		float cpu = 0.f;
+	};
+
+	void _collect(query_set_t& set);
+	pass_statistics_t _statistics(size_t member) const;
+
+	std::array<query_set_t, GPU_PROFILER_LATENCY> _sets;
+	uint32_t _current;
+	uint64_t _frame;
+	std::chrono::high_resolution_clock::time_point _last_frame;
+
+	frame_history<frame_timings_t> _history;
+	bool _created;
+};
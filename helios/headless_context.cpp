@@ -0,0 +1,169 @@
+#include "headless_context.hpp"
+
+#include <iostream>
+#include <cstring>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static bool has_extension(const char* extensions, const char* name)
+{
+	if (!extensions)
+		return false;
+
+	size_t length = std::strlen(name);
+	for (const char* it = std::strstr(extensions, name); it; it = std::strstr(it + length, name))
+		if ((it == extensions || it[-1] == ' ') && (it[length] == ' ' || it[length] == '\0'))
+			return true;
+
+	return false;
+}
+
+static EGLDisplay open_display()
+{
+	/* Prefer the Mesa surfaceless platform, which does not need any display server */
+	const char* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (has_extension(client_extensions, "EGL_MESA_platform_surfaceless") &&
+		has_extension(client_extensions, "EGL_EXT_platform_base"))
+	{
+		auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+			eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+		if (get_platform_display)
+		{
+			EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+			if (display != EGL_NO_DISPLAY)
+				return display;
+		}
+	}
+
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool create_headless_context(headless_context_t& context, uint32_t major, uint32_t minor)
+{
+	EGLDisplay display = open_display();
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+	{
+		std::cout << "ERROR: Failed to initialize an EGL display!" << std::endl;
+		return false;
+	}
+	context.display = display;
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "ERROR: The EGL implementation does not support desktop OpenGL!" << std::endl;
+		return false;
+	}
+
+	const EGLint config_attributes[] =
+	{
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_NONE
+	};
+
+	EGLConfig config = nullptr;
+	EGLint num_configs = 0;
+	if (!eglChooseConfig(display, config_attributes, &config, 1, &num_configs) || num_configs == 0)
+	{
+		std::cout << "ERROR: Could not find a suitable EGL configuration!" << std::endl;
+		return false;
+	}
+	context.config = config;
+
+	const EGLint context_attributes[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION, static_cast<EGLint>(major),
+		EGL_CONTEXT_MINOR_VERSION, static_cast<EGLint>(minor),
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+#ifdef _DEBUG
+		EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+#endif
+		EGL_NONE
+	};
+
+	context.render_context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+	if (context.render_context == EGL_NO_CONTEXT)
+	{
+		std::cout << "ERROR: Could not create an OpenGL " << major << "." << minor << " EGL context!" << std::endl;
+		return false;
+	}
+
+	context.compiler_context = eglCreateContext(display, config, context.render_context, context_attributes);
+	if (context.compiler_context == EGL_NO_CONTEXT)
+	{
+		std::cout << "ERROR: Could not create the EGL compiler context!" << std::endl;
+		return false;
+	}
+
+	/* Without surfaceless support we fall back to a dummy pbuffer, we never render to it anyway */
+	if (!has_extension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+	{
+		const EGLint pbuffer_attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		context.surface = eglCreatePbufferSurface(display, config, pbuffer_attributes);
+		if (context.surface == EGL_NO_SURFACE)
+		{
+			std::cout << "ERROR: Could not create an EGL pbuffer surface!" << std::endl;
+			return false;
+		}
+	}
+
+	return make_headless_context_current(context, false);
+}
+
+void destroy_headless_context(headless_context_t& context)
+{
+	if (!context.display)
+		return;
+
+	eglMakeCurrent(context.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	if (context.compiler_context)
+		eglDestroyContext(context.display, context.compiler_context);
+	if (context.render_context)
+		eglDestroyContext(context.display, context.render_context);
+	if (context.surface)
+		eglDestroySurface(context.display, context.surface);
+
+	eglTerminate(context.display);
+	context = headless_context_t{};
+}
+
+bool make_headless_context_current(const headless_context_t& context, bool compiler)
+{
+	EGLSurface surface = context.surface ? context.surface : EGL_NO_SURFACE;
+	EGLContext egl_context = compiler ? context.compiler_context : context.render_context;
+
+	if (!eglMakeCurrent(context.display, surface, surface, egl_context))
+	{
+		std::cout << "ERROR: Could not make the EGL context current!" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+#else
+
+bool create_headless_context(headless_context_t&, uint32_t, uint32_t)
+{
+	std::cout << "ERROR: Headless rendering is only supported on Linux!" << std::endl;
+	return false;
+}
+
+void destroy_headless_context(headless_context_t&)
+{
+}
+
+bool make_headless_context_current(const headless_context_t&, bool)
+{
+	return false;
+}
+
+#endif
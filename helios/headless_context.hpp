@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+/* Offscreen OpenGL contexts without any window or display server.
+ * On Linux this is built on top of EGL, either through the Mesa surfaceless platform
+ * or through a tiny pbuffer when surfaceless contexts are not supported by the driver.
+ * The two contexts share their objects, exactly as the SDL ones do.
+ */
+struct headless_context_t
+{
+	void* display = nullptr;
+	void* config = nullptr;
+	void* surface = nullptr;
+	void* render_context = nullptr;
+	void* compiler_context = nullptr;
+};
+
+bool create_headless_context(headless_context_t& context, uint32_t major, uint32_t minor);
+void destroy_headless_context(headless_context_t& context);
+
+// Pass true to make the compiler context current instead of the render one
+bool make_headless_context_current(const headless_context_t& context, bool compiler);
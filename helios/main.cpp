@@ -4,14 +4,19 @@
 #include <wincon.h> 
 #endif
 
-int main(int, char*[])
+int main(int argc, char* argv[])
 {
+	config_t config = load_config();
+	if (!apply_command_line(argc, argv, config))
+		return -1;
+
 #if defined WIN32 && defined NDEBUG
-	ShowWindow(GetConsoleWindow(), SW_HIDE);
+	if (!config.headless.enabled)
+		ShowWindow(GetConsoleWindow(), SW_HIDE);
 #endif
 
 	application app;
-	if (!app.init())
+	if (!app.init(config))
 		return -1;
 
 	app.run();
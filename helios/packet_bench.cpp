@@ -0,0 +1,101 @@
+#include "packet_marcher.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+/* Microbenchmark of the packet marcher, reports the rays/s of every primitive for every instruction set */
+
+using hr_clock = std::chrono::high_resolution_clock;
+
+static constexpr uint32_t IMAGE_SIZE = 256;
+static constexpr float FOCAL_LENGTH = 1.67f;
+static constexpr std::chrono::milliseconds MIN_DURATION = std::chrono::milliseconds(250);
+
+int main(int, char*[])
+{
+	const uint32_t count = IMAGE_SIZE * IMAGE_SIZE;
+
+	/* A simple pinhole camera looking at the primitive placed in the origin */
+	std::vector<float> origin[3];
+	std::vector<float> direction[3];
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		origin[c].resize(count);
+		direction[c].resize(count);
+	}
+
+	for (uint32_t y = 0; y < IMAGE_SIZE; ++y)
+	{
+		for (uint32_t x = 0; x < IMAGE_SIZE; ++x)
+		{
+			uint32_t i = y * IMAGE_SIZE + x;
+			float u = x * 2.f / IMAGE_SIZE - 1.f;
+			float v = y * 2.f / IMAGE_SIZE - 1.f;
+			float length = std::sqrt(u * u + v * v + FOCAL_LENGTH * FOCAL_LENGTH);
+
+			origin[0][i] = .0f;
+			origin[1][i] = .5f;
+			origin[2][i] = 4.f;
+			direction[0][i] = u / length;
+			direction[1][i] = v / length;
+			direction[2][i] = -FOCAL_LENGTH / length;
+		}
+	}
+
+	std::vector<float> distance(count);
+	std::vector<int32_t> iterations(count);
+
+	packet_rays_t rays = { { origin[0].data(), origin[1].data(), origin[2].data() },
+						   { direction[0].data(), direction[1].data(), direction[2].data() }, count };
+	packet_hits_t hits = { distance.data(), iterations.data() };
+	packet_march_params_t params = { .001f, 30.f, 1.f, 100 };
+	default_scene_params_t scene_params = { .5f, .5f, { 1.f, .3f } };
+
+	auto kernels = supported_packet_kernels();
+
+	std::cout << std::left << std::setw(22) << "primitive" << std::setw(10) << "isa" << std::right
+			  << std::setw(14) << "Mrays/s" << std::setw(14) << "speedup" << std::setw(14) << "avg steps" << std::endl;
+
+	for (uint8_t p = 0; p < static_cast<uint8_t>(packet_primitive::COUNT); ++p)
+	{
+		auto primitive = static_cast<packet_primitive>(p);
+		double scalar_rate = 1.0;
+
+		for (auto k : kernels)
+		{
+			/* Warm up the caches once, then repeat until the measurement is long enough to be meaningful */
+			k->march_primitive(primitive, scene_params, params, rays, hits);
+
+			uint64_t marched = 0;
+			auto start = hr_clock::now();
+			auto elapsed = hr_clock::duration::zero();
+			while (elapsed < MIN_DURATION)
+			{
+				k->march_primitive(primitive, scene_params, params, rays, hits);
+				marched += count;
+				elapsed = hr_clock::now() - start;
+			}
+
+			double seconds = std::chrono::duration<double>(elapsed).count();
+			double rate = marched / seconds;
+			/* The scalar kernels are always the first ones, every speedup is relative to them */
+			if (k == kernels.front())
+				scalar_rate = rate;
+
+			uint64_t steps = 0;
+			for (auto it : iterations)
+				steps += static_cast<uint64_t>(it);
+
+			std::cout << std::left << std::setw(22) << packet_primitive_name(primitive) << std::setw(10) << k->name
+					  << std::right << std::fixed << std::setprecision(2)
+					  << std::setw(14) << rate / 1e6
+					  << std::setw(13) << rate / scalar_rate << "x"
+					  << std::setw(14) << static_cast<double>(steps) / count << std::endl;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,166 @@
+/* Implementation of the packet kernels, shared by every instruction set.
+ * It is included by the packet_kernels_*.cpp files after defining lane_t, each one compiled with its own ISA flags.
+ * Do not use the standard library in here (not even std::min), its inline functions are shared
+ * between translation units and could end up compiled with instructions the running CPU does not support.
+ */
+namespace
+{
+
+using namespace packet;
+using namespace simd;
+
+using traits_t = simd::traits<lane_t>;
+using mask_t = traits_t::mask_t;
+using vec3_l = vec3_t<lane_t>;
+
+constexpr uint32_t WIDTH = traits_t::width;
+
+/* Loads up to WIDTH consecutive values, the missing lanes replicate the last valid one */
+inline lane_t load_lanes(const float* values, uint32_t first, uint32_t lanes)
+{
+	float buffer[WIDTH];
+	for (uint32_t l = 0; l < WIDTH; ++l)
+		buffer[l] = values[first + (l < lanes ? l : lanes - 1)];
+	return traits_t::load(buffer);
+}
+
+template <typename Scene>
+void march_rays(const Scene& scene, const packet_march_params_t& params, const packet_rays_t& rays, const packet_hits_t& hits)
+{
+	const lane_t epsilon = params.epsilon;
+	const lane_t z_far = params.z_far;
+	const lane_t one = 1.f;
+
+	for (uint32_t first = 0; first < rays.count; first += WIDTH)
+	{
+		uint32_t lanes = rays.count - first < WIDTH ? rays.count - first : WIDTH;
+
+		vec3_l ro = { load_lanes(rays.origin[0], first, lanes),
+					  load_lanes(rays.origin[1], first, lanes),
+					  load_lanes(rays.origin[2], first, lanes) };
+		vec3_l rd = { load_lanes(rays.direction[0], first, lanes),
+					  load_lanes(rays.direction[1], first, lanes),
+					  load_lanes(rays.direction[2], first, lanes) };
+
+		lane_t dist = params.starting_step;
+		lane_t iterations = 0.f;
+
+		/* Lanes still marching, the ones which hit or escaped are masked out but keep being evaluated */
+		mask_t active = lane_t(0.f) < one;
+
+		for (int32_t it = 0; it < params.max_iterations; ++it)
+		{
+			lane_t d = scene(ro + rd * dist);
+
+			active = and_not(active, (d < epsilon * dist) | (dist > z_far));
+			if (!any(active))
+				break;
+
+			dist = select(active, dist + d, dist);
+			iterations = select(active, iterations + one, iterations);
+		}
+
+		dist = simd::clamp<lane_t>(dist, lane_t(0.f), z_far);
+
+		float dist_out[WIDTH];
+		float iterations_out[WIDTH];
+		traits_t::store(dist_out, dist);
+		traits_t::store(iterations_out, iterations);
+
+		for (uint32_t l = 0; l < lanes; ++l)
+		{
+			hits.distance[first + l] = dist_out[l];
+			hits.iterations[first + l] = static_cast<int32_t>(iterations_out[l]);
+		}
+	}
+}
+
+/* Same code of default_scene::distance() */
+inline lane_t default_scene_distance(const default_scene_params_t& s, const vec3_l& point)
+{
+	lane_t obj = sd_box(point, broadcast<lane_t>(1.f, 1.f, 1.f + .5f * ::sinf(s.time)));
+	obj = op_union(obj, sd_torus(rotate_x(point, s.time) + broadcast<lane_t>(2.f, .5f, .0f), s.thorus_radius[0], s.thorus_radius[1]));
+	return op_union(obj, sd_sphere(point - broadcast<lane_t>(1.5f, 1.5f, .0f), s.sphere_radius));
+}
+
+void march(packet_scene_fn scene, const void* user_data, const packet_march_params_t& params,
+		   const packet_rays_t& rays, const packet_hits_t& hits)
+{
+	/* Arbitrary scenes are evaluated through the callback, one whole packet at a time */
+	march_rays([scene, user_data](const vec3_l& p)
+	{
+		float x[WIDTH], y[WIDTH], z[WIDTH], d[WIDTH];
+		traits_t::store(x, p.x);
+		traits_t::store(y, p.y);
+		traits_t::store(z, p.z);
+
+		scene(user_data, x, y, z, d, WIDTH);
+		return traits_t::load(d);
+	}, params, rays, hits);
+}
+
+void march_primitive(packet_primitive primitive, const default_scene_params_t& scene_params,
+					 const packet_march_params_t& params, const packet_rays_t& rays, const packet_hits_t& hits)
+{
+	switch (primitive)
+	{
+		case packet_primitive::SPHERE:
+			march_rays([](const vec3_l& p) { return sd_sphere(p, 1.f); }, params, rays, hits);
+			break;
+
+		case packet_primitive::BOX:
+			march_rays([](const vec3_l& p) { return sd_box(p, broadcast<lane_t>(1.f, 1.f, 1.f)); }, params, rays, hits);
+			break;
+
+		case packet_primitive::TORUS:
+			march_rays([](const vec3_l& p) { return sd_torus(p, 1.f, .3f); }, params, rays, hits);
+			break;
+
+		case packet_primitive::CAPSULE:
+			march_rays([](const vec3_l& p)
+			{
+				return sd_capsule(p, broadcast<lane_t>(-1.f, .0f, .0f), broadcast<lane_t>(1.f, .0f, .0f), .5f);
+			}, params, rays, hits);
+			break;
+
+		case packet_primitive::CAPPED_CYLINDER:
+			march_rays([](const vec3_l& p) { return sd_capped_cylinder(p, 1.f, .5f); }, params, rays, hits);
+			break;
+
+		case packet_primitive::BLEND:
+			march_rays([](const vec3_l& p)
+			{
+				return op_blend(sd_box(p, broadcast<lane_t>(.8f, .8f, .8f)),
+								sd_sphere(p - broadcast<lane_t>(.8f, .8f, .0f), .6f), .3f);
+			}, params, rays, hits);
+			break;
+
+		case packet_primitive::REPEAT:
+			march_rays([](const vec3_l& p) { return sd_sphere(op_repeate(p, 2.f, 2.f, 2.f), .4f); }, params, rays, hits);
+			break;
+
+		case packet_primitive::DEFAULT_SCENE:
+		default:
+			march_rays([&scene_params](const vec3_l& p) { return default_scene_distance(scene_params, p); }, params, rays, hits);
+			break;
+	}
+}
+
+void evaluate_default_scene(const default_scene_params_t& scene_params, const float* x, const float* y, const float* z,
+							float* distance, uint32_t count)
+{
+	for (uint32_t first = 0; first < count; first += WIDTH)
+	{
+		uint32_t lanes = count - first < WIDTH ? count - first : WIDTH;
+
+		vec3_l p = { load_lanes(x, first, lanes), load_lanes(y, first, lanes), load_lanes(z, first, lanes) };
+
+		float d[WIDTH];
+		traits_t::store(d, default_scene_distance(scene_params, p));
+
+		for (uint32_t l = 0; l < lanes; ++l)
+			distance[first + l] = d[l];
+	}
+}
+
+}
@@ -0,0 +1,19 @@
+#include "packet_marcher.hpp"
+#include "sdf_packet.hpp"
+
+/* This file is compiled with the AVX2 flags, it must only be called after checking the CPU supports them */
+#if defined(__AVX2__)
+using lane_t = simd::f32x8;
+#include "packet_kernels.inl"
+
+const packet_kernels_t* avx2_packet_kernels()
+{
+	static const packet_kernels_t kernels = { "avx2", "AVX2", WIDTH, &march, &march_primitive, &evaluate_default_scene };
+	return &kernels;
+}
+#else
+const packet_kernels_t* avx2_packet_kernels()
+{
+	return nullptr;
+}
+#endif
@@ -0,0 +1,24 @@
+/* GCC reports the _mm512_undefined_ps() used internally by its own AVX-512 intrinsics as maybe-uninitialized */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#include "packet_marcher.hpp"
+#include "sdf_packet.hpp"
+
+/* This file is compiled with the AVX-512 flags, it must only be called after checking the CPU supports them */
+#if defined(__AVX512F__)
+using lane_t = simd::f32x16;
+#include "packet_kernels.inl"
+
+const packet_kernels_t* avx512_packet_kernels()
+{
+	static const packet_kernels_t kernels = { "avx512", "AVX-512", WIDTH, &march, &march_primitive, &evaluate_default_scene };
+	return &kernels;
+}
+#else
+const packet_kernels_t* avx512_packet_kernels()
+{
+	return nullptr;
+}
+#endif
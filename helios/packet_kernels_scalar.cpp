@@ -0,0 +1,12 @@
+#include "packet_marcher.hpp"
+#include "sdf_packet.hpp"
+
+/* Scalar version of the packet kernels, one ray at a time, used as a baseline and on CPUs without any SIMD support */
+using lane_t = float;
+#include "packet_kernels.inl"
+
+const packet_kernels_t* scalar_packet_kernels()
+{
+	static const packet_kernels_t kernels = { "scalar", "Scalar", WIDTH, &march, &march_primitive, &evaluate_default_scene };
+	return &kernels;
+}
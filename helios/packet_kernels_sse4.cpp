@@ -0,0 +1,19 @@
+#include "packet_marcher.hpp"
+#include "sdf_packet.hpp"
+
+/* This file is compiled with the SSE4.1 flags, it must only be called after checking the CPU supports them */
+#if defined(HELIOS_SIMD_SSE4)
+using lane_t = simd::f32x4;
+#include "packet_kernels.inl"
+
+const packet_kernels_t* sse4_packet_kernels()
+{
+	static const packet_kernels_t kernels = { "sse4", "SSE4.1", WIDTH, &march, &march_primitive, &evaluate_default_scene };
+	return &kernels;
+}
+#else
+const packet_kernels_t* sse4_packet_kernels()
+{
+	return nullptr;
+}
+#endif
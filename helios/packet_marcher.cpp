@@ -0,0 +1,121 @@
+#include "packet_marcher.hpp"
+
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+
+struct cpu_features_t
+{
+	bool sse4 = false;
+	bool avx2 = false;
+	bool avx512 = false;
+};
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#if defined(_MSC_VER)
+cpu_features_t detect_cpu_features()
+{
+	cpu_features_t features;
+
+	int32_t info[4];
+	__cpuid(info, 0);
+	int32_t max_leaf = info[0];
+
+	__cpuid(info, 1);
+	bool fma = (info[2] & (1 << 12)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	features.sse4 = (info[2] & (1 << 19)) != 0;
+
+	/* The OS must save the AVX (and AVX-512) registers on context switches too */
+	uint64_t xcr0 = osxsave ? _xgetbv(0) : 0;
+	bool os_avx = (xcr0 & 0x6) == 0x6;
+	bool os_avx512 = (xcr0 & 0xe6) == 0xe6;
+
+	if (max_leaf >= 7)
+	{
+		__cpuidex(info, 7, 0);
+		features.avx2 = os_avx && fma && (info[1] & (1 << 5)) != 0;
+		features.avx512 = os_avx512 && features.avx2 && (info[1] & (1 << 16)) != 0;
+	}
+
+	return features;
+}
+#else
+cpu_features_t detect_cpu_features()
+{
+	cpu_features_t features;
+
+	/* These already check the OS support for the extended registers */
+	__builtin_cpu_init();
+	features.sse4 = __builtin_cpu_supports("sse4.1");
+	features.avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	features.avx512 = features.avx2 && __builtin_cpu_supports("avx512f");
+
+	return features;
+}
+#endif
+#else
+cpu_features_t detect_cpu_features()
+{
+	return cpu_features_t{};
+}
+#endif
+
+}
+
+const char* packet_primitive_name(packet_primitive primitive)
+{
+	switch (primitive)
+	{
+		case packet_primitive::SPHERE:			return "sd_sphere";
+		case packet_primitive::BOX:				return "sd_box";
+		case packet_primitive::TORUS:			return "sd_torus";
+		case packet_primitive::CAPSULE:			return "sd_capsule";
+		case packet_primitive::CAPPED_CYLINDER:	return "sd_capped_cylinder";
+		case packet_primitive::BLEND:			return "op_blend";
+		case packet_primitive::REPEAT:			return "op_repeate";
+		case packet_primitive::DEFAULT_SCENE:	return "default scene";
+		default:								return "unknown";
+	}
+}
+
+std::vector<const packet_kernels_t*> supported_packet_kernels()
+{
+	static const cpu_features_t features = detect_cpu_features();
+
+	std::vector<const packet_kernels_t*> kernels = { scalar_packet_kernels() };
+
+	/* Only call into a translation unit compiled for an instruction set once we know the CPU supports it */
+	const packet_kernels_t* candidates[] =
+	{
+		features.sse4 ? sse4_packet_kernels() : nullptr,
+		features.avx2 ? avx2_packet_kernels() : nullptr,
+		features.avx512 ? avx512_packet_kernels() : nullptr
+	};
+
+	for (auto candidate : candidates)
+		if (candidate)
+			kernels.push_back(candidate);
+
+	return kernels;
+}
+
+const packet_kernels_t* best_packet_kernels()
+{
+	static const packet_kernels_t* best = supported_packet_kernels().back();
+	return best;
+}
+
+const packet_kernels_t* find_packet_kernels(const char* id)
+{
+	for (auto kernels : supported_packet_kernels())
+		if (std::strcmp(kernels->id, id) == 0)
+			return kernels;
+
+	return nullptr;
+}
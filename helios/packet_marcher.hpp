@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/* Packet ray marching on the CPU.
+ * Coherent rays are marched 4/8/16 at a time (SSE4.1, AVX2 and AVX-512) with a lane mask
+ * for the rays which already hit something or escaped, so the whole vector width of the core is used.
+ * Every instruction set is compiled in its own translation unit and the best one supported
+ * by the running CPU is selected at runtime.
+ * This header is kept free of any other dependency so the microbenchmark can use it standalone.
+ */
+
+struct packet_march_params_t
+{
+	float epsilon;
+	float z_far;
+	float starting_step;
+	int32_t max_iterations;
+};
+
+/* Rays are stored as separate arrays for every component, count does not need to be a multiple of the width */
+struct packet_rays_t
+{
+	const float* origin[3];
+	const float* direction[3];
+	uint32_t count;
+};
+
+/* Same outputs of _hl_raymarch: the clamped distance and the number of iterations of every ray */
+struct packet_hits_t
+{
+	float* distance;
+	int32_t* iterations;
+};
+
+/* Evaluates the distance field at count points, stored as separate x/y/z arrays */
+using packet_scene_fn = void(*)(const void* user_data, const float* x, const float* y, const float* z,
+								float* distance, uint32_t count);
+
+/* Parameters of the hand-written port of the default raymarch_scene.comp */
+struct default_scene_params_t
+{
+	float time;
+	float sphere_radius;
+	float thorus_radius[2];
+};
+
+/* Single primitives (and simple compositions) of raymarch_library.comp marched by the microbenchmark */
+enum class packet_primitive : uint8_t
+{
+	SPHERE = 0,
+	BOX,
+	TORUS,
+	CAPSULE,
+	CAPPED_CYLINDER,
+	BLEND,
+	REPEAT,
+	DEFAULT_SCENE,
+
+	COUNT
+};
+
+const char* packet_primitive_name(packet_primitive primitive);
+
+struct packet_kernels_t
+{
+	/* Short identifier used in the configuration and on the command line */
+	const char* id;
+	const char* name;
+	uint32_t width;
+
+	/* Marches the rays against an arbitrary distance field, evaluated through the callback one packet at a time */
+	void (*march)(packet_scene_fn scene, const void* user_data, const packet_march_params_t& params,
+				  const packet_rays_t& rays, const packet_hits_t& hits);
+
+	/* Marches the rays against a single primitive, which is inlined in the marching loop */
+	void (*march_primitive)(packet_primitive primitive, const default_scene_params_t& scene_params,
+							const packet_march_params_t& params, const packet_rays_t& rays, const packet_hits_t& hits);
+
+	/* Evaluates the default scene at count points */
+	void (*default_scene)(const default_scene_params_t& scene_params, const float* x, const float* y, const float* z,
+						  float* distance, uint32_t count);
+};
+
+/* Every kernel set supported by the running CPU, from the scalar one to the widest */
+std::vector<const packet_kernels_t*> supported_packet_kernels();
+
+/* The widest kernel set supported by the running CPU */
+const packet_kernels_t* best_packet_kernels();
+
+/* The kernel set with the given id, nullptr if unknown or not supported by the running CPU */
+const packet_kernels_t* find_packet_kernels(const char* id);
+
+/* Per instruction set entry points, they return nullptr when the binary was built without support for it */
+const packet_kernels_t* scalar_packet_kernels();
+const packet_kernels_t* sse4_packet_kernels();
+const packet_kernels_t* avx2_packet_kernels();
+const packet_kernels_t* avx512_packet_kernels();
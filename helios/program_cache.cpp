@@ -0,0 +1,278 @@
+#include "program_cache.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#pragma warning(push, 0)
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/writer.h"
+#pragma warning(pop)
+
+static constexpr uint32_t CACHE_MAGIC = 0x50434C48; // "HLCP"
+/* Must be bumped whenever the layout of the entries or of the reflected uniforms changes */
+static constexpr uint32_t CACHE_VERSION = 1;
+
+static constexpr const char* BLOCK_SIZE_KEY = "block_size";
+static constexpr const char* UNIFORMS_KEY = "uniforms";
+static constexpr const char* NAME_KEY = "name";
+static constexpr const char* TYPE_KEY = "type";
+static constexpr const char* ARRAY_SIZE_KEY = "array_size";
+static constexpr const char* OFFSET_KEY = "offset";
+static constexpr const char* GROUP_SIZE_KEY = "group_size";
+
+struct cache_header_t
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t key;
+	uint32_t format;
+	uint32_t length;
+};
+
+static fs::path entry_path(const program_cache_t& cache, uint64_t key, const char* extension)
+{
+	std::stringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << key << extension;
+	return cache.folder / name.str();
+}
+
+/* Entries are written next to their final path and then renamed, so a reader never sees a partial file */
+static bool write_entry(const fs::path& path, const void* data, size_t size)
+{
+	std::error_code error;
+	fs::create_directories(path.parent_path(), error);
+
+	fs::path temp_path = path;
+	temp_path += ".tmp";
+
+	{
+		std::ofstream stream(temp_path, std::ios::binary);
+		if (!stream.is_open() || !stream.good())
+			return false;
+
+		stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		if (!stream.good())
+			return false;
+	}
+
+	fs::rename(temp_path, path, error);
+	return !error;
+}
+
+uint64_t hash_source(const std::string& source)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : source)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+bool create_program_cache(program_cache_t& cache, const fs::path& folder)
+{
+	cache.folder.clear();
+
+	int32_t formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats <= 0)
+	{
+		std::cout << "WARNING: The driver does not support program binaries, the program cache is disabled!" << std::endl;
+		return false;
+	}
+
+	auto gl_string = [](GLenum name)
+	{
+		const GLubyte* value = glGetString(name);
+		return value ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+	};
+
+	std::string driver = gl_string(GL_VENDOR) + "\n" + gl_string(GL_RENDERER) + "\n" + gl_string(GL_VERSION);
+
+	std::stringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << hash_source(driver);
+	cache.folder = folder / name.str();
+
+	return true;
+}
+
+uint32_t load_cached_program(const program_cache_t& cache, uint64_t key)
+{
+	if (cache.folder.empty())
+		return invalid_handle;
+
+	std::ifstream stream(entry_path(cache, key, ".bin"), std::ios::binary);
+	if (!stream.is_open() || !stream.good())
+		return invalid_handle;
+
+	cache_header_t header = {};
+	stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!stream.good() || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.key != key)
+		return invalid_handle;
+
+	std::vector<char> binary(header.length);
+	stream.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+	if (!stream.good())
+		return invalid_handle;
+
+	uint32_t program = glCreateProgram();
+	glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+	// The driver is free to reject any binary, for example after an update which did not change its version string
+	int32_t success = false;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glDeleteProgram(program);
+		return invalid_handle;
+	}
+
+	return program;
+}
+
+void store_cached_program(const program_cache_t& cache, uint64_t key, uint32_t program)
+{
+	if (cache.folder.empty() || program == invalid_handle)
+		return;
+
+	int32_t length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> data(sizeof(cache_header_t) + static_cast<size_t>(length));
+
+	cache_header_t header = { CACHE_MAGIC, CACHE_VERSION, key, 0, 0 };
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &header.format, data.data() + sizeof(header));
+	if (written <= 0)
+		return;
+
+	header.length = static_cast<uint32_t>(written);
+	std::memcpy(data.data(), &header, sizeof(header));
+
+	if (!write_entry(entry_path(cache, key, ".bin"), data.data(), sizeof(header) + header.length))
+		std::cout << "WARNING: Could not write the program binary to the cache!" << std::endl;
+}
+
+bool load_cached_uniforms(const program_cache_t& cache, uint64_t key, uniform_registry& uniforms)
+{
+	if (cache.folder.empty())
+		return false;
+
+	fs::path path = entry_path(cache, key, ".json");
+	if (!fs::exists(path))
+		return false;
+
+	rapidjson::Document doc;
+	std::string content = get_content_of_file(path);
+	doc.Parse(content.c_str());
+
+	if (doc.HasParseError() || !doc.IsObject() || !doc.HasMember(BLOCK_SIZE_KEY) || !doc.HasMember(UNIFORMS_KEY) ||
+		!doc[BLOCK_SIZE_KEY].IsUint() || !doc[UNIFORMS_KEY].IsArray())
+		return false;
+
+	std::vector<uniform_t> list;
+	for (const auto& u : doc[UNIFORMS_KEY].GetArray())
+	{
+		if (!u.IsObject() || !u.HasMember(NAME_KEY) || !u.HasMember(TYPE_KEY) || !u.HasMember(ARRAY_SIZE_KEY) || !u.HasMember(OFFSET_KEY))
+			return false;
+
+		if (!u[NAME_KEY].IsString() || !u[TYPE_KEY].IsUint() || !u[ARRAY_SIZE_KEY].IsUint() || !u[OFFSET_KEY].IsUint())
+			return false;
+
+		uint32_t type = u[TYPE_KEY].GetUint();
+		if (type > static_cast<uint32_t>(uniform_type::MAT4))
+			return false;
+
+		list.emplace_back(u[NAME_KEY].GetString(), static_cast<uniform_type>(type),
+						  u[ARRAY_SIZE_KEY].GetUint(), u[OFFSET_KEY].GetUint());
+	}
+
+	uniforms = uniform_registry(std::move(list), doc[BLOCK_SIZE_KEY].GetUint());
+	return true;
+}
+
+void store_cached_uniforms(const program_cache_t& cache, uint64_t key, const uniform_registry& uniforms)
+{
+	if (cache.folder.empty())
+		return;
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+	writer.StartObject();
+	writer.Key(BLOCK_SIZE_KEY);
+	writer.Uint(uniforms.block_size());
+
+	writer.Key(UNIFORMS_KEY);
+	writer.StartArray();
+	for (const auto& u : uniforms.uniforms())
+	{
+		writer.StartObject();
+		writer.Key(NAME_KEY);
+		writer.String(u.name.c_str());
+		writer.Key(TYPE_KEY);
+		writer.Uint(static_cast<uint32_t>(u.type));
+		writer.Key(ARRAY_SIZE_KEY);
+		writer.Uint(u.array_size);
+		writer.Key(OFFSET_KEY);
+		writer.Uint(u.offset);
+		writer.EndObject();
+	}
+	writer.EndArray();
+	writer.EndObject();
+
+	if (!write_entry(entry_path(cache, key, ".json"), buffer.GetString(), buffer.GetSize()))
+		std::cout << "WARNING: Could not write the reflection of the program to the cache!" << std::endl;
+}
+
+bool load_cached_group_size(const program_cache_t& cache, uint64_t key, glm::uvec2& group_size)
+{
+	if (cache.folder.empty())
+		return false;
+
+	fs::path path = entry_path(cache, key, ".group.json");
+	if (!fs::exists(path))
+		return false;
+
+	rapidjson::Document doc;
+	std::string content = get_content_of_file(path);
+	doc.Parse(content.c_str());
+
+	if (doc.HasParseError() || !doc.IsObject() || !doc.HasMember(GROUP_SIZE_KEY) || !doc[GROUP_SIZE_KEY].IsArray())
+		return false;
+
+	const auto& size = doc[GROUP_SIZE_KEY];
+	if (size.Size() != 2 || !size[0].IsUint() || !size[1].IsUint())
+		return false;
+
+	group_size = glm::uvec2(size[0].GetUint(), size[1].GetUint());
+	return true;
+}
+
+void store_cached_group_size(const program_cache_t& cache, uint64_t key, const glm::uvec2& group_size)
+{
+	if (cache.folder.empty())
+		return;
+
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+	writer.StartObject();
+	writer.Key(GROUP_SIZE_KEY);
+	writer.StartArray();
+	writer.Uint(group_size.x);
+	writer.Uint(group_size.y);
+	writer.EndArray();
+	writer.EndObject();
+
+	if (!write_entry(entry_path(cache, key, ".group.json"), buffer.GetString(), buffer.GetSize()))
+		std::cout << "WARNING: Could not write the size of the work groups to the cache!" << std::endl;
+}
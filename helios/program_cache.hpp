@@ -0,0 +1,35 @@
+#pragma once
+
+#include "common.hpp"
+#include "uniform_utils.hpp"
+
+#include <cstdint>
+#include <string>
+
+/* Persistent cache of linked programs and of the reflection of their sources.
+ * Binaries are only valid for the driver which produced them, so every vendor/renderer/version
+ * gets its own folder, and inside it every entry is named after the hash of the assembled source.
+ * A hit skips both the driver compile and glslang, a stale or rejected entry is simply compiled again.
+ */
+struct program_cache_t
+{
+	/* Empty if the cache is disabled or the driver does not support program binaries */
+	fs::path folder;
+};
+
+/* 64 bit FNV-1a of the whole source */
+uint64_t hash_source(const std::string& source);
+
+// Requires a current GL context, the folder is created on the first store
+bool create_program_cache(program_cache_t& cache, const fs::path& folder);
+
+/* Returns invalid_handle on a miss or if the driver rejects the stored binary */
+uint32_t load_cached_program(const program_cache_t& cache, uint64_t key);
+void store_cached_program(const program_cache_t& cache, uint64_t key, uint32_t program);
+
+bool load_cached_uniforms(const program_cache_t& cache, uint64_t key, uniform_registry& uniforms);
+void store_cached_uniforms(const program_cache_t& cache, uint64_t key, const uniform_registry& uniforms);
+
+/* Fastest shape of the work groups found for the scene, the key is the one of the source without the size */
+bool load_cached_group_size(const program_cache_t& cache, uint64_t key, glm::uvec2& group_size);
+void store_cached_group_size(const program_cache_t& cache, uint64_t key, const glm::uvec2& group_size);
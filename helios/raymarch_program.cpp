@@ -0,0 +1,31 @@
+#include "raymarch_program.hpp"
+
+bool raymarch_pass_shades(raymarch_pass pass)
+{
+	return pass == raymarch_pass::MARCH || pass == raymarch_pass::SUPERSAMPLE;
+}
+
+raymarch_program_t specialize_raymarch_program(const raymarch_program_t& program, const raymarch_program_t& variant)
+{
+	raymarch_program_t specialized = program;
+	for (uint32_t i = 0; i < RAYMARCH_PASS_COUNT; ++i)
+		if (variant.passes[i] != invalid_handle)
+			specialized.passes[i] = variant.passes[i];
+
+	return specialized;
+}
+
+std::string raymarch_pass_define(raymarch_pass pass)
+{
+	return "#define _HL_PASS " + std::to_string(static_cast<uint32_t>(pass)) + "\n";
+}
+
+void release_raymarch_program(raymarch_program_t& program)
+{
+	for (auto& pass : program.passes)
+	{
+		if (pass != invalid_handle)
+			glDeleteProgram(pass);
+		pass = invalid_handle;
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/* Every dispatch of a frame runs a program of its own, built from the same source with _HL_PASS defined to its pass,
+ * so each one only contains its own path. Mirrored by the _HL_PASS_* defines in raymarch_base.comp
+ */
+enum class raymarch_pass : uint8_t
+{
+	MARCH = 0,
+	CONE,
+	REPROJECT,
+	RECONSTRUCT,
+	EDGES,
+	SUPERSAMPLE,
+	BAKE_CLASSIFY,
+	BAKE_FILL,
+
+	COUNT
+};
+
+static constexpr uint32_t RAYMARCH_PASS_COUNT = static_cast<uint32_t>(raymarch_pass::COUNT);
+
+/* The program of every pass, a specialized variant only has the ones of the passes which shade */
+struct raymarch_program_t
+{
+	std::array<uint32_t, RAYMARCH_PASS_COUNT> passes;
+
+	raymarch_program_t() { passes.fill(invalid_handle); }
+
+	uint32_t& operator[](raymarch_pass pass) { return passes[static_cast<uint32_t>(pass)]; }
+	uint32_t operator[](raymarch_pass pass) const { return passes[static_cast<uint32_t>(pass)]; }
+
+	/* The passes are built all together, so one is enough to tell */
+	bool valid() const { return (*this)[raymarch_pass::MARCH] != invalid_handle; }
+};
+
+/* The only passes the shading settings of a specialized variant make a difference for */
+bool raymarch_pass_shades(raymarch_pass pass);
+
+/* The passes of the variant replace those of the program, the others are shared with it */
+raymarch_program_t specialize_raymarch_program(const raymarch_program_t& program, const raymarch_program_t& variant);
+
+/* The define selecting the pass, to be inserted right after the version directive */
+std::string raymarch_pass_define(raymarch_pass pass);
+
+/* Requires a current GL context */
+void release_raymarch_program(raymarch_program_t& program);
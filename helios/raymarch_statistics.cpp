@@ -0,0 +1,207 @@
+#include "raymarch_statistics.hpp"
+#include "uniform_blocks.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+/* A flush never waits for a single frame longer than this */
+static constexpr uint64_t FENCE_TIMEOUT = 1000000000;
+
+/* A new program which needs this many more scene calls per ray than the previous one is reported as a regression */
+static constexpr float REGRESSION_THRESHOLD = 1.1f;
+
+static constexpr GLsizeiptr COUNTERS_SIZE = sizeof(uint32_t) * RAYMARCH_COUNTER_COUNT;
+
+float frame_statistics_t::per_ray(raymarch_counter counter) const
+{
+	uint32_t rays = (*this)[raymarch_counter::RAYS];
+	return rays == 0 ? 0.f : static_cast<float>((*this)[counter]) / static_cast<float>(rays);
+}
+
+raymarch_statistics::raymarch_statistics() :
+	_sets(), _current(0), _frame(0), _program(0), _history(RAYMARCH_STATISTICS_HISTORY), _last_program(0), _created(false)
+{
+}
+
+bool raymarch_statistics::create()
+{
+	if (_created)
+		return true;
+
+	for (auto& set : _sets)
+	{
+		glGenBuffers(1, &set.buffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, set.buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, COUNTERS_SIZE, nullptr, GL_DYNAMIC_READ);
+		set.fence = nullptr;
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	_current = 0;
+	_frame = 0;
+	reset(_history.capacity());
+
+	if (glGetError() != GL_NO_ERROR)
+	{
+		std::cout << "ERROR: Failed to create the raymarch statistics buffers!" << std::endl;
+		destroy();
+		return false;
+	}
+
+	_created = true;
+	return true;
+}
+
+void raymarch_statistics::destroy()
+{
+	for (auto& set : _sets)
+	{
+		if (set.fence)
+			glDeleteSync(set.fence);
+		if (set.buffer != invalid_handle)
+			glDeleteBuffers(1, &set.buffer);
+
+		set.fence = nullptr;
+		set.buffer = invalid_handle;
+	}
+
+	_created = false;
+}
+
+void raymarch_statistics::begin()
+{
+	if (!_created)
+		return;
+
+	auto& set = _sets[_current];
+
+	/* The GPU is more than RAYMARCH_STATISTICS_LATENCY frames behind, so this frame is dropped instead of waiting for it */
+	if (set.fence)
+	{
+		glDeleteSync(set.fence);
+		set.fence = nullptr;
+	}
+
+	set.frame = _frame;
+	set.program = _program;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, set.buffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindings::RAYMARCH_STATISTICS, set.buffer);
+}
+
+void raymarch_statistics::end()
+{
+	if (!_created)
+		return;
+
+	/* The atomics must be visible to glGetBufferSubData once the fence signals */
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	_sets[_current].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	++_frame;
+	_current = (_current + 1) % RAYMARCH_STATISTICS_LATENCY;
+
+	/* Fences signal in order, so the sets are read from the oldest until the first one still in flight */
+	for (uint32_t i = 0; i < RAYMARCH_STATISTICS_LATENCY; ++i)
+	{
+		auto& set = _sets[(_current + i) % RAYMARCH_STATISTICS_LATENCY];
+		if (set.fence && !_collect(set, 0))
+			break;
+	}
+}
+
+void raymarch_statistics::flush()
+{
+	if (!_created)
+		return;
+
+	for (uint32_t i = 0; i < RAYMARCH_STATISTICS_LATENCY; ++i)
+	{
+		auto& set = _sets[(_current + i) % RAYMARCH_STATISTICS_LATENCY];
+		if (set.fence)
+			_collect(set, FENCE_TIMEOUT);
+	}
+}
+
+void raymarch_statistics::reset(uint32_t history_size)
+{
+	_history.reset(history_size, _frame);
+}
+
+void raymarch_statistics::program_changed()
+{
+	++_program;
+}
+
+bool raymarch_statistics::_collect(counter_set_t& set, uint64_t timeout)
+{
+	GLenum status = glClientWaitSync(set.fence, timeout > 0 ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return false;
+
+	glDeleteSync(set.fence);
+	set.fence = nullptr;
+
+	if (!_history.accepts(set.frame))
+		return true;
+
+	frame_statistics_t statistics;
+	statistics.frame = set.frame;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, set.buffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, COUNTERS_SIZE, statistics.counters.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	if (!_history.empty() && set.program != _last_program)
+		_compare_programs(last(), statistics);
+	_last_program = set.program;
+
+	_history.push(statistics);
+
+	return true;
+}
+
+void raymarch_statistics::_compare_programs(const frame_statistics_t& previous, const frame_statistics_t& current) const
+{
+	float before = previous.per_ray(raymarch_counter::SCENE_CALLS);
+	float after = current.per_ray(raymarch_counter::SCENE_CALLS);
+	if (before <= 0.f)
+		return;
+
+	float ratio = after / before;
+	bool regression = ratio > REGRESSION_THRESHOLD;
+
+	std::ostringstream message;
+	message << std::fixed << std::setprecision(2) << "Scene calls per ray went from " << before << " to " << after
+			<< " with the new program (" << std::showpos << (ratio - 1.f) * 100.f << "%)";
+
+	std::cout << (regression ? "WARNING: " : "") << message.str() << (regression ? "!" : "") << std::endl;
+}
+
+bool raymarch_statistics::dump(const fs::path& path) const
+{
+	std::vector<history_column_t<frame_statistics_t>> columns;
+	for (uint32_t c = 0; c < RAYMARCH_COUNTER_COUNT; ++c)
+		columns.push_back({ counter_name(static_cast<raymarch_counter>(c)),
+							[c](std::ostream& s, const frame_statistics_t& f) { s << f.counters[c]; } });
+
+	return _history.dump(path, "raymarch statistics", columns);
+}
+
+const char* raymarch_statistics::counter_name(raymarch_counter counter)
+{
+	switch (counter)
+	{
+		case raymarch_counter::RAYS:						return "rays";
+		case raymarch_counter::SCENE_CALLS:					return "scene_calls";
+		case raymarch_counter::ITERATIONS:					return "iterations";
+		case raymarch_counter::SHADOW_STEPS:				return "shadow_steps";
+		case raymarch_counter::AMBIENT_OCCLUSION_STEPS:		return "ambient_occlusion_steps";
+		case raymarch_counter::MAX_ITERATIONS:				return "max_iterations";
+		case raymarch_counter::SKY:							return "sky";
+		default:											return "unknown";
+	}
+}
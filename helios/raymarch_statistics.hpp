@@ -0,0 +1,102 @@
+#pragma once
+
+#include "common.hpp"
+#include "frame_history.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/* Number of frames whose counters can be in flight before they are needed */
+static constexpr uint32_t RAYMARCH_STATISTICS_LATENCY = 4;
+/* Number of frames kept for the graph and the dump, unless reset() asks for more */
+static constexpr uint32_t RAYMARCH_STATISTICS_HISTORY = 256;
+
+// Mirrored by the _HL_COUNTER_* constants in raymarch_main.comp
+enum class raymarch_counter : uint8_t
+{
+	RAYS = 0,
+	SCENE_CALLS,
+	ITERATIONS,
+	SHADOW_STEPS,
+	AMBIENT_OCCLUSION_STEPS,
+	MAX_ITERATIONS,
+	SKY,
+
+	COUNT
+};
+
+static constexpr uint32_t RAYMARCH_COUNTER_COUNT = static_cast<uint32_t>(raymarch_counter::COUNT);
+
+/* Totals of a single frame, as accumulated by the raymarch program */
+struct frame_statistics_t
+{
+	uint64_t frame = 0;
+	std::array<uint32_t, RAYMARCH_COUNTER_COUNT> counters = {};
+
+	uint32_t operator[](raymarch_counter counter) const { return counters[static_cast<uint32_t>(counter)]; }
+
+	/* The counter divided by the number of rays traced in the frame */
+	float per_ray(raymarch_counter counter) const;
+};
+
+/* The raymarch program adds its counters to a storage buffer with atomics. Every frame in flight has its own
+ * buffer and fence, and a buffer whose fence did not signal by the time it comes around again is reused, losing that frame.
+ * The first frame after program_changed() is compared with the one before, to report a change in the cost of the scene.
+ */
+class raymarch_statistics
+{
+public:
+	raymarch_statistics();
+	raymarch_statistics(const raymarch_statistics&) = delete;
+	~raymarch_statistics() = default;
+
+	raymarch_statistics& operator=(const raymarch_statistics&) = delete;
+
+	// Every function requires a current GL context
+	bool create();
+	void destroy();
+
+	/* Clears and binds the counters of this frame, before the dispatch */
+	void begin();
+	/* After the dispatch, collects every older frame whose counters arrived */
+	void end();
+	/* Waits for every frame still in flight, only meant before the results are dumped */
+	void flush();
+
+	/* Drops the counters read so far and those of the frames already dispatched */
+	void reset(uint32_t history_size = RAYMARCH_STATISTICS_HISTORY);
+
+	/* The frames rendered from now on use a different program, which is compared with the previous one */
+	void program_changed();
+
+	bool empty() const { return _history.empty(); }
+	const frame_statistics_t& last() const { return _history.last(); }
+	std::vector<frame_statistics_t> history() const { return _history.ordered(); }
+
+	/* A row of counters for every frame, as JSON or CSV */
+	bool dump(const fs::path& path) const;
+
+	static const char* counter_name(raymarch_counter counter);
+
+private:
+	struct counter_set_t
+	{
+		uint32_t buffer = invalid_handle;
+		GLsync fence = nullptr;
+		uint64_t frame = 0;
+		uint32_t program = 0;
+	};
+
+	bool _collect(counter_set_t& set, uint64_t timeout);
+	void _compare_programs(const frame_statistics_t& previous, const frame_statistics_t& current) const;
+
+	std::array<counter_set_t, RAYMARCH_STATISTICS_LATENCY> _sets;
+	uint32_t _current;
+	uint64_t _frame;
+	uint32_t _program;
+
+	frame_history<frame_statistics_t> _history;
+	uint32_t _last_program;
+	bool _created;
+};
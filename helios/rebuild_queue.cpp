@@ -0,0 +1,232 @@
+#include "rebuild_queue.hpp"
+
+#include <cstring>
+#include <iostream>
+
+/* From KHR_parallel_shader_compile, which is not exposed by the loader */
+static constexpr GLenum COMPLETION_STATUS_KHR = 0x91B1;
+
+static bool is_extension_supported(const char* name)
+{
+	int32_t count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+	for (int32_t i = 0; i < count; ++i)
+	{
+		const GLubyte* extension = glGetStringi(GL_EXTENSIONS, static_cast<uint32_t>(i));
+		if (extension && std::strcmp(reinterpret_cast<const char*>(extension), name) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static void release_build(raymarch_build_t& build)
+{
+	if (build.fence)
+		glDeleteSync(build.fence);
+	release_raymarch_program(build.program);
+
+	build.fence = nullptr;
+}
+
+rebuild_queue::rebuild_queue() :
+	_setup(), _build(), _notify(), _worker(), _mutex(), _condition(), _should_continue(false), _parallel_compile(false),
+	_requested(0), _built(0), _variant(), _ready(), _ready_variant()
+{
+}
+
+rebuild_queue::~rebuild_queue()
+{
+	stop();
+}
+
+void rebuild_queue::start(setup_t setup, build_t build, notify_t notify)
+{
+	if (_worker.joinable())
+		return;
+
+	_setup = std::move(setup);
+	_build = std::move(build);
+	_notify = std::move(notify);
+	_parallel_compile = is_extension_supported("GL_KHR_parallel_shader_compile") ||
+						is_extension_supported("GL_ARB_parallel_shader_compile");
+
+	_should_continue = true;
+	_worker = std::thread(&rebuild_queue::_run, this);
+}
+
+void rebuild_queue::stop()
+{
+	if (!_worker.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_should_continue = false;
+	}
+
+	_condition.notify_one();
+	_worker.join();
+
+	// Every object is shared, so the render context can release what the worker left behind
+	if (_ready)
+	{
+		release_build(*_ready);
+		_ready.reset();
+	}
+
+	if (_ready_variant)
+	{
+		release_build(*_ready_variant);
+		_ready_variant.reset();
+	}
+}
+
+void rebuild_queue::request()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		++_requested;
+	}
+
+	_condition.notify_one();
+}
+
+void rebuild_queue::request_variant(std::string variant)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_variant = std::move(variant);
+	}
+
+	_condition.notify_one();
+}
+
+bool rebuild_queue::poll(raymarch_build_t& build)
+{
+	std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+	if (!lock.owns_lock())
+		return false;
+
+	/* The program comes first, a variant is held while one is still compiling since it would be released as soon as it arrives */
+	std::unique_ptr<raymarch_build_t>* ready = nullptr;
+	if (_ready)
+	{
+		if (!_completed(*_ready))
+			return false;
+		ready = &_ready;
+	}
+	else if (_ready_variant && _completed(*_ready_variant))
+		ready = &_ready_variant;
+	else
+		return false;
+
+	if ((*ready)->fence)
+		glDeleteSync((*ready)->fence);
+	(*ready)->fence = nullptr;
+
+	build = std::move(**ready);
+	ready->reset();
+
+	return true;
+}
+
+bool rebuild_queue::_completed(raymarch_build_t& build) const
+{
+	/* A failed variant has nothing to wait for */
+	if (!build.program.valid())
+		return true;
+
+	/* A zero timeout only checks the status, the compiler context already flushed the fence */
+	GLenum status = glClientWaitSync(build.fence, 0, 0);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return false;
+
+	if (_parallel_compile)
+	{
+		for (auto pass : build.program.passes)
+		{
+			if (pass == invalid_handle)
+				continue;
+
+			int32_t completed = GL_FALSE;
+			glGetProgramiv(pass, COMPLETION_STATUS_KHR, &completed);
+			if (!completed)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void rebuild_queue::_run()
+{
+	_setup();
+
+	while (true)
+	{
+		auto build = std::make_unique<raymarch_build_t>();
+		uint64_t generation;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this]() { return !_should_continue || _requested != _built || !_variant.empty(); });
+
+			if (!_should_continue)
+				break;
+
+			generation = _requested;
+
+			/* A variant waits for any pending rebuild, so it is built from the latest source */
+			if (_requested == _built)
+			{
+				build->variant = std::move(_variant);
+				_variant.clear();
+			}
+		}
+
+		build->generation = generation;
+		bool success = _build(*build);
+
+		/* The program is linked already, so once the fence is signaled too poll finds it completed as soon as it is woken up */
+		if (success)
+		{
+			build->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glClientWaitSync(build->fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		}
+
+		if (_hand_over(std::move(build), generation, success) && _notify)
+			_notify();
+	}
+}
+
+bool rebuild_queue::_hand_over(std::unique_ptr<raymarch_build_t> build, uint64_t generation, bool success)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (!build->variant.empty())
+	{
+		/* The render thread drops the variants of an older source by itself, and remembers the failed ones without a program */
+		if (!success)
+			release_build(*build);
+
+		if (_ready_variant)
+			release_build(*_ready_variant);
+		_ready_variant = std::move(build);
+		return true;
+	}
+
+	_built = generation;
+
+	/* Latest wins, a newer request makes this build useless */
+	if (!success || _requested != generation)
+	{
+		release_build(*build);
+		return false;
+	}
+
+	if (_ready)
+		release_build(*_ready);
+	_ready = std::move(build);
+	return true;
+}
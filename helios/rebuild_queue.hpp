@@ -0,0 +1,93 @@
+#pragma once
+
+#include "common.hpp"
+#include "raymarch_program.hpp"
+#include "uniform_utils.hpp"
+#include "scene_vm.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/* Everything produced by a single compile of the raymarch program, which must be swapped in all together */
+struct raymarch_build_t
+{
+	raymarch_program_t program;
+	uniform_registry uniforms;
+	scene_program_t scene_program;
+	/* The scene changes over time, so the depth of a frame can not be reused by the next one */
+	bool reads_time = false;
+
+	/* Hash of the assembled source without any define, a variant is only valid for the program built from the same one */
+	uint64_t key = 0;
+	/* Defines of a specialized variant, empty for the program reading every setting from the uniforms */
+	std::string variant;
+
+	/* Signaled when every command issued by the compiler context for this build has completed */
+	GLsync fence = nullptr;
+	uint64_t generation = 0;
+};
+
+/* Compiles the raymarch program on a worker thread owning its own shared context.
+ * Requests are coalesced: only the latest one is built, and a build overtaken by a newer request is thrown away.
+ * The render thread polls for a completed build without ever blocking, and receives the program and its uniforms at once.
+ * Specialized variants are built only when no rebuild is pending, and likewise only the latest one requested.
+ * A variant which fails to build is still handed over, without a program, so it is not requested again.
+ * No variant is handed over while a rebuilt program is still compiling, the program releases every variant once it arrives.
+ */
+class rebuild_queue
+{
+public:
+	/* Called on the worker thread, setup once before anything else and build for every request.
+	 * Notify is called once a build or a variant is ready for poll, to wake up a render thread waiting for events.
+	 */
+	using setup_t = std::function<void()>;
+	using build_t = std::function<bool(raymarch_build_t&)>;
+	using notify_t = std::function<void()>;
+
+	rebuild_queue();
+	rebuild_queue(const rebuild_queue&) = delete;
+	~rebuild_queue();
+
+	rebuild_queue& operator=(const rebuild_queue&) = delete;
+
+	// Must be called from the render thread, with its context current
+	void start(setup_t setup, build_t build, notify_t notify);
+	void stop();
+
+	/* Can be called from any thread */
+	void request();
+	void request_variant(std::string variant);
+
+	/* Returns true and fills build only once the latest build or variant is ready to be used, never blocks */
+	bool poll(raymarch_build_t& build);
+
+private:
+	void _run();
+	/* False if the build is thrown away, so there is nothing to poll */
+	bool _hand_over(std::unique_ptr<raymarch_build_t> build, uint64_t generation, bool success);
+	bool _completed(raymarch_build_t& build) const;
+
+	setup_t _setup;
+	build_t _build;
+	notify_t _notify;
+
+	std::thread _worker;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+
+	bool _should_continue;
+	bool _parallel_compile;
+	uint64_t _requested;
+	uint64_t _built;
+	/* Empty when no variant is waiting to be built */
+	std::string _variant;
+
+	/* The last completed build and variant, not yet picked up by the render thread */
+	std::unique_ptr<raymarch_build_t> _ready;
+	std::unique_ptr<raymarch_build_t> _ready_variant;
+};
@@ -0,0 +1,83 @@
+#include "resolution_controller.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/* Frames averaged before every decision */
+static constexpr uint32_t SAMPLES = 8;
+/* Smaller growths are ignored, so the resolution does not flicker around the target */
+static constexpr float HYSTERESIS = .05f;
+/* The scale never grows faster than this in a single step */
+static constexpr float MAX_GROWTH = 1.1f;
+
+resolution_controller::resolution_controller() :
+	_scale(1.f), _first_frame(0), _next_frame(0), _sum(0.f), _samples(0)
+{
+}
+
+bool resolution_controller::update(const dynamic_resolution_t& settings, const frame_timings_t& last, uint64_t current_frame)
+{
+	float min_scale = std::min(std::max(settings.min_scale, .1f), 1.f);
+	float max_scale = std::min(std::max(settings.max_scale, min_scale), 1.f);
+
+	if (!settings.enabled || settings.target_ms <= 0.f)
+	{
+		bool changed = _scale != 1.f;
+		_set_scale(1.f, current_frame);
+		return changed;
+	}
+
+	/* The bounds changed from the GUI */
+	if (_scale < min_scale || _scale > max_scale)
+	{
+		_set_scale(std::min(std::max(_scale, min_scale), max_scale), current_frame);
+		return true;
+	}
+
+	if (last.gpu <= 0.f || last.frame < std::max(_first_frame, _next_frame))
+		return false;
+
+	_sum += last.gpu;
+	_next_frame = last.frame + 1;
+	if (++_samples < SAMPLES)
+		return false;
+
+	float average = _sum / static_cast<float>(_samples);
+	_sum = 0.f;
+	_samples = 0;
+
+	/* Over the target it always shrinks, but it only grows with enough room below it, so it settles just under the target */
+	float ideal = std::min(std::max(_scale * std::sqrt(settings.target_ms / average), min_scale), max_scale);
+	if (ideal >= _scale && ideal < _scale * (1.f + HYSTERESIS) && ideal != max_scale)
+		return false;
+
+	float scale = std::min(ideal, _scale * MAX_GROWTH);
+	if (scale == _scale)
+		return false;
+
+	_set_scale(scale, current_frame);
+	return true;
+}
+
+void resolution_controller::skip(uint64_t current_frame)
+{
+	_first_frame = current_frame + 1;
+	_sum = 0.f;
+	_samples = 0;
+}
+
+uint32_t resolution_controller::scaled(uint32_t size) const
+{
+	return std::max(1u, static_cast<uint32_t>(std::lround(static_cast<float>(size) * _scale)));
+}
+
+void resolution_controller::_set_scale(float scale, uint64_t current_frame)
+{
+	if (scale == _scale)
+		return;
+
+	_scale = scale;
+	_first_frame = current_frame;
+	_sum = 0.f;
+	_samples = 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "gpu_profiler.hpp"
+
+#include <cstdint>
+
+/* Settings of the dynamic resolution, the scale applies to both dimensions of the configured resolution */
+struct dynamic_resolution_t
+{
+	bool enabled = true;
+	/* GPU time of a whole frame the resolution is scaled to hold */
+	float target_ms = 16.6f;
+	float min_scale = .5f;
+	float max_scale = 1.f;
+};
+
+/* The cost of the raymarch grows with the number of pixels, so the scale is moved by the square root of the ratio
+ * between the target and the GPU time measured at the current scale, averaged over a few frames.
+ * Timings of frames rendered before the last change are still in flight when it happens and are ignored.
+ * It shrinks as much as needed at once, but grows a little at a time, since missing the target is worse than a lower resolution.
+ */
+class resolution_controller
+{
+public:
+	resolution_controller();
+	~resolution_controller() = default;
+
+	/* Feeds the newest timings of the profiler before a frame is recorded, returns true if the scale changed */
+	bool update(const dynamic_resolution_t& settings, const frame_timings_t& last, uint64_t current_frame);
+	/* The frame about to be recorded does not raymarch, so its timings and those of the frames before it are ignored */
+	void skip(uint64_t current_frame);
+
+	float scale() const { return _scale; }
+
+	/* The resolution the raymarch is dispatched at, never below a single pixel */
+	uint32_t scaled(uint32_t size) const;
+
+private:
+	void _set_scale(float scale, uint64_t current_frame);
+
+	float _scale;
+	/* First frame rendered at the current scale */
+	uint64_t _first_frame;
+	/* Oldest frame whose timings were not accumulated yet */
+	uint64_t _next_frame;
+	float _sum;
+	uint32_t _samples;
+};
@@ -0,0 +1,1337 @@
+#include "scene_compiler.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* The AST is only exposed through the internal headers of glslang, which are not warning-free */
+#pragma warning(push, 0)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#pragma GCC diagnostic ignored "-Wreorder"
+#pragma GCC diagnostic ignored "-Wdeprecated-copy"
+#pragma clang diagnostic ignored "-Weverything"
+#include "MachineIndependent/localintermediate.h"
+#pragma GCC diagnostic pop
+#pragma warning(pop)
+
+using namespace glslang;
+
+/* Loops are fully unrolled, this is the maximum number of iterations of a single loop */
+static constexpr uint32_t MAX_UNROLLED_ITERATIONS = 256;
+static constexpr size_t MAX_CALL_DEPTH = 32;
+static constexpr uint32_t MAX_REGISTERS = std::numeric_limits<uint16_t>::max();
+
+namespace
+{
+
+/* A value of the program, registers are in SSA form and are never written twice */
+struct value_t
+{
+	uint32_t reg;
+	uint8_t size;
+};
+
+struct register_info_t
+{
+	uint8_t size;
+	bool constant;
+	bool pinned;
+	float value[4];
+};
+
+/* Same layout of vm_instruction_t, but with virtual registers */
+struct node_t
+{
+	vm_opcode op;
+	uint8_t size;
+	uint32_t dst;
+	uint32_t src[4];
+	uint8_t component[4];
+};
+
+/* Local variables, return value and a flag which tells which points already returned, for every inlined call */
+struct frame_t
+{
+	std::unordered_map<int32_t, value_t> locals;
+	value_t result;
+	value_t returned;
+};
+
+/* Everything a branch can modify, saved before compiling it and merged afterwards */
+struct state_t
+{
+	std::unordered_map<int32_t, value_t> locals;
+	std::unordered_map<int32_t, value_t> globals;
+	value_t result;
+	value_t returned;
+};
+
+uint32_t operand_count(const node_t& node)
+{
+	switch (node.op)
+	{
+		case vm_opcode::SHUFFLE:
+			return node.size;
+
+		case vm_opcode::NEG: case vm_opcode::ABS: case vm_opcode::SIGN: case vm_opcode::FLOOR: case vm_opcode::CEIL:
+		case vm_opcode::FRACT: case vm_opcode::TRUNC: case vm_opcode::ROUND: case vm_opcode::SQRT: case vm_opcode::INVERSE_SQRT:
+		case vm_opcode::EXP: case vm_opcode::LOG: case vm_opcode::EXP2: case vm_opcode::LOG2: case vm_opcode::SIN:
+		case vm_opcode::COS: case vm_opcode::TAN: case vm_opcode::ASIN: case vm_opcode::ACOS: case vm_opcode::ATAN:
+		case vm_opcode::SINH: case vm_opcode::COSH: case vm_opcode::TANH: case vm_opcode::NOT:
+		case vm_opcode::LENGTH: case vm_opcode::ANY: case vm_opcode::ALL:
+			return 1;
+
+		case vm_opcode::CLAMP: case vm_opcode::MIX: case vm_opcode::SMOOTHSTEP: case vm_opcode::FMA: case vm_opcode::SELECT:
+			return 3;
+
+		default:
+			return 2;
+	}
+}
+
+bool is_integer(TBasicType type)
+{
+	return type == EbtInt || type == EbtUint || type == EbtInt64 || type == EbtUint64;
+}
+
+bool is_floating(TBasicType type)
+{
+	return type == EbtFloat || type == EbtDouble;
+}
+
+class scene_compiler
+{
+public:
+	bool compile(const TIntermediate& intermediate, scene_program_t& program);
+
+private:
+	std::vector<node_t> _nodes;
+	std::vector<register_info_t> _registers;
+	std::map<std::string, uint32_t> _constants;
+	std::map<std::string, uint32_t> _expressions;
+	std::vector<std::pair<std::string, value_t>> _uniforms;
+
+	std::unordered_map<std::string, TIntermAggregate*> _functions;
+	std::unordered_map<int32_t, value_t> _globals;
+	std::vector<frame_t> _frames;
+
+	std::string _error;
+
+	/* Program construction */
+	value_t new_register(uint8_t size, bool pinned);
+	value_t constant(const float* value, uint8_t size);
+	value_t constant(float value, uint8_t size);
+	value_t emit(vm_opcode op, uint8_t size, value_t a, value_t b = {}, value_t c = {});
+	value_t emit(node_t node);
+	value_t shuffle(const std::vector<std::pair<uint32_t, uint8_t>>& components);
+	value_t splat(value_t v, uint8_t size);
+	value_t component(value_t v, uint8_t c);
+	value_t select(value_t condition, value_t a, value_t b);
+	value_t uniform(const std::string& name, uint8_t size);
+	value_t fail(const std::string& error);
+
+	/* Variables and control flow */
+	bool check_type(const TType& type);
+	value_t load(const TIntermSymbol* symbol);
+	void store(const TIntermSymbol* symbol, value_t v);
+	void assign(TIntermTyped* target, value_t v);
+	state_t save() const;
+	void restore(const state_t& state);
+	void merge(value_t condition, const state_t& a, const state_t& b);
+	bool returned() const;
+
+	/* AST lowering */
+	value_t visit(TIntermNode* node);
+	value_t visit_constant(const TIntermConstantUnion* node);
+	value_t visit_binary(TIntermBinary* node);
+	value_t visit_unary(TIntermUnary* node);
+	value_t visit_aggregate(TIntermAggregate* node);
+	value_t visit_constructor(TIntermAggregate* node);
+	value_t visit_call(TIntermAggregate* node);
+	value_t visit_selection(TIntermSelection* node);
+	value_t visit_loop(TIntermLoop* node);
+	value_t visit_branch(TIntermBranch* node);
+	value_t arithmetic(TOperator op, value_t a, value_t b, TBasicType type);
+	value_t convert(value_t v, TBasicType from, TBasicType to);
+
+	bool finalize(value_t result, scene_program_t& program);
+};
+
+value_t scene_compiler::new_register(uint8_t size, bool pinned)
+{
+	register_info_t info = {};
+	info.size = size;
+	info.pinned = pinned;
+	_registers.push_back(info);
+
+	return { static_cast<uint32_t>(_registers.size() - 1), size };
+}
+
+value_t scene_compiler::constant(const float* value, uint8_t size)
+{
+	std::string key(1, static_cast<char>(size));
+	key.append(reinterpret_cast<const char*>(value), size * sizeof(float));
+
+	auto it = _constants.find(key);
+	if (it != _constants.end())
+		return { it->second, size };
+
+	value_t v = new_register(size, true);
+	_registers[v.reg].constant = true;
+	std::copy(value, value + size, _registers[v.reg].value);
+
+	_constants[key] = v.reg;
+	return v;
+}
+
+value_t scene_compiler::constant(float value, uint8_t size)
+{
+	float values[4] = { value, value, value, value };
+	return constant(values, size);
+}
+
+value_t scene_compiler::emit(vm_opcode op, uint8_t size, value_t a, value_t b, value_t c)
+{
+	node_t node = {};
+	node.op = op;
+	node.size = size;
+	node.src[0] = a.reg;
+	node.src[1] = b.reg;
+	node.src[2] = c.reg;
+
+	/* Single operand reductions still read the second one */
+	if (op == vm_opcode::LENGTH || op == vm_opcode::ANY || op == vm_opcode::ALL)
+		node.src[1] = a.reg;
+
+	/* Reductions store the size of the operands in the first component */
+	if (op == vm_opcode::DOT || op == vm_opcode::LENGTH || op == vm_opcode::ANY || op == vm_opcode::ALL)
+		node.component[0] = a.size;
+
+	return emit(node);
+}
+
+value_t scene_compiler::emit(node_t node)
+{
+	uint32_t operands = operand_count(node);
+
+	bool folded = true;
+	for (uint32_t i = 0; i < operands; ++i)
+		folded &= _registers[node.src[i]].constant;
+
+	/* A select with a condition known at compile time is just one of its operands */
+	if (node.op == vm_opcode::SELECT && _registers[node.src[0]].constant)
+	{
+		const float* mask = _registers[node.src[0]].value;
+		bool all_true = true;
+		bool all_false = true;
+
+		for (uint32_t c = 0; c < node.size; ++c)
+		{
+			all_true &= mask[c] != 0.f;
+			all_false &= mask[c] == 0.f;
+		}
+
+		if (all_true)
+			return { node.src[1], node.size };
+		if (all_false)
+			return { node.src[2], node.size };
+	}
+
+	/* Constant folding, the instruction is executed right away on a single lane */
+	if (folded)
+	{
+		float registers[5 * 4] = {};
+
+		vm_instruction_t instruction = {};
+		instruction.op = node.op;
+		instruction.size = node.size;
+		instruction.dst = 4;
+
+		for (uint32_t i = 0; i < operands; ++i)
+		{
+			instruction.src[i] = static_cast<uint16_t>(i);
+			instruction.component[i] = node.component[i];
+			std::copy(_registers[node.src[i]].value, _registers[node.src[i]].value + 4, registers + i * 4);
+		}
+
+		if (node.op == vm_opcode::LENGTH || node.op == vm_opcode::ANY || node.op == vm_opcode::ALL)
+			instruction.src[1] = 0;
+
+		execute_instruction(instruction, registers, 1);
+		return constant(registers + 16, node.size);
+	}
+
+	/* Registers are never written twice, so the same instruction always produces the same value */
+	std::string key(reinterpret_cast<const char*>(&node.op), sizeof(node.op));
+	key.push_back(static_cast<char>(node.size));
+	key.append(reinterpret_cast<const char*>(node.src), operands * sizeof(uint32_t));
+	key.append(reinterpret_cast<const char*>(node.component), sizeof(node.component));
+
+	auto it = _expressions.find(key);
+	if (it != _expressions.end())
+		return { it->second, node.size };
+
+	value_t dst = new_register(node.size, false);
+	node.dst = dst.reg;
+
+	_nodes.push_back(node);
+	_expressions[key] = dst.reg;
+
+	return dst;
+}
+
+value_t scene_compiler::shuffle(const std::vector<std::pair<uint32_t, uint8_t>>& components)
+{
+	uint8_t size = static_cast<uint8_t>(components.size());
+
+	/* Identity swizzles do not need any instruction */
+	bool identity = _registers[components[0].first].size == size;
+	for (uint8_t c = 0; c < size; ++c)
+		identity &= components[c].first == components[0].first && components[c].second == c;
+
+	if (identity)
+		return { components[0].first, size };
+
+	node_t node = {};
+	node.op = vm_opcode::SHUFFLE;
+	node.size = size;
+
+	for (uint8_t c = 0; c < size; ++c)
+	{
+		node.src[c] = components[c].first;
+		node.component[c] = components[c].second;
+	}
+
+	return emit(node);
+}
+
+value_t scene_compiler::splat(value_t v, uint8_t size)
+{
+	if (v.size == size)
+		return v;
+
+	return shuffle(std::vector<std::pair<uint32_t, uint8_t>>(size, { v.reg, 0 }));
+}
+
+value_t scene_compiler::component(value_t v, uint8_t c)
+{
+	return shuffle({ { v.reg, c } });
+}
+
+value_t scene_compiler::select(value_t condition, value_t a, value_t b)
+{
+	return emit(vm_opcode::SELECT, a.size, splat(condition, a.size), a, b);
+}
+
+value_t scene_compiler::uniform(const std::string& name, uint8_t size)
+{
+	for (const auto& u : _uniforms)
+		if (u.first == name)
+			return u.second;
+
+	value_t v = new_register(size, true);
+	_uniforms.emplace_back(name, v);
+	return v;
+}
+
+value_t scene_compiler::fail(const std::string& error)
+{
+	if (_error.empty())
+		_error = error;
+
+	return constant(0.f, 1);
+}
+
+bool scene_compiler::check_type(const TType& type)
+{
+	if (type.isMatrix())
+		fail("matrices are not supported");
+	else if (type.isArray())
+		fail("arrays are not supported");
+	else if (type.isStruct())
+		fail("structs are not supported");
+	else if (type.getBasicType() == EbtSampler)
+		fail("samplers are not supported");
+
+	return _error.empty();
+}
+
+value_t scene_compiler::load(const TIntermSymbol* symbol)
+{
+	const TType& type = symbol->getType();
+	uint8_t size = static_cast<uint8_t>(type.getVectorSize());
+
+	if (type.getQualifier().storage == EvqUniform)
+	{
+		if (!check_type(type))
+			return constant(0.f, 1);
+		return uniform(symbol->getName().c_str(), size);
+	}
+
+	if (!check_type(type))
+		return constant(0.f, 1);
+
+	bool global = _frames.empty() || type.getQualifier().storage == EvqGlobal;
+	auto& variables = global ? _globals : _frames.back().locals;
+
+	auto it = variables.find(symbol->getId());
+	if (it != variables.end())
+		return it->second;
+
+	/* Constants declared with an initializer keep their value in the symbol */
+	if (symbol->getConstArray().size() == static_cast<int32_t>(size))
+	{
+		float values[4] = {};
+		for (int32_t c = 0; c < symbol->getConstArray().size(); ++c)
+			values[c] = static_cast<float>(symbol->getConstArray()[c].getDConst());
+		return constant(values, size);
+	}
+
+	// Reading an uninitialized variable is undefined in GLSL, we just use 0
+	value_t v = constant(0.f, size);
+	variables[symbol->getId()] = v;
+	return v;
+}
+
+void scene_compiler::store(const TIntermSymbol* symbol, value_t v)
+{
+	const TType& type = symbol->getType();
+
+	if (type.getQualifier().storage == EvqUniform)
+	{
+		fail("uniforms are read-only");
+		return;
+	}
+
+	bool global = _frames.empty() || type.getQualifier().storage == EvqGlobal;
+	auto& variables = global ? _globals : _frames.back().locals;
+	variables[symbol->getId()] = v;
+}
+
+void scene_compiler::assign(TIntermTyped* target, value_t v)
+{
+	if (auto symbol = target->getAsSymbolNode())
+	{
+		store(symbol, v);
+		return;
+	}
+
+	auto binary = target->getAsBinaryNode();
+	if (!binary || (binary->getOp() != EOpVectorSwizzle && binary->getOp() != EOpIndexDirect))
+	{
+		fail("unsupported assignment");
+		return;
+	}
+
+	/* Writing some components of a vector replaces the whole vector with a new value */
+	value_t base = visit(binary->getLeft());
+
+	std::vector<std::pair<uint32_t, uint8_t>> components;
+	for (uint8_t c = 0; c < base.size; ++c)
+		components.emplace_back(base.reg, c);
+
+	if (binary->getOp() == EOpIndexDirect)
+	{
+		auto index = binary->getRight()->getAsConstantUnion();
+		components[index->getConstArray()[0].getIConst()] = { v.reg, 0 };
+	}
+	else
+	{
+		auto& selectors = binary->getRight()->getAsAggregate()->getSequence();
+		for (size_t c = 0; c < selectors.size(); ++c)
+		{
+			int32_t index = selectors[c]->getAsConstantUnion()->getConstArray()[0].getIConst();
+			components[index] = { v.reg, static_cast<uint8_t>(c) };
+		}
+	}
+
+	assign(binary->getLeft(), shuffle(components));
+}
+
+state_t scene_compiler::save() const
+{
+	state_t state;
+	state.globals = _globals;
+
+	if (!_frames.empty())
+	{
+		state.locals = _frames.back().locals;
+		state.result = _frames.back().result;
+		state.returned = _frames.back().returned;
+	}
+
+	return state;
+}
+
+void scene_compiler::restore(const state_t& state)
+{
+	_globals = state.globals;
+
+	if (!_frames.empty())
+	{
+		_frames.back().locals = state.locals;
+		_frames.back().result = state.result;
+		_frames.back().returned = state.returned;
+	}
+}
+
+void scene_compiler::merge(value_t condition, const state_t& a, const state_t& b)
+{
+	/* Both branches are always executed, every variable takes the value of the branch selected by the condition */
+	auto merge_variables = [this, condition](const std::unordered_map<int32_t, value_t>& va,
+											 const std::unordered_map<int32_t, value_t>& vb)
+	{
+		std::unordered_map<int32_t, value_t> merged = va;
+
+		for (auto& v : merged)
+		{
+			auto it = vb.find(v.first);
+			value_t other = it != vb.end() ? it->second : constant(0.f, v.second.size);
+
+			if (other.reg != v.second.reg)
+				v.second = select(condition, v.second, other);
+		}
+
+		for (const auto& v : vb)
+			if (merged.find(v.first) == merged.end())
+				merged[v.first] = select(condition, constant(0.f, v.second.size), v.second);
+
+		return merged;
+	};
+
+	_globals = merge_variables(a.globals, b.globals);
+
+	if (!_frames.empty())
+	{
+		frame_t& frame = _frames.back();
+		frame.locals = merge_variables(a.locals, b.locals);
+		frame.result = a.result.reg != b.result.reg ? select(condition, a.result, b.result) : a.result;
+		frame.returned = a.returned.reg != b.returned.reg ? select(condition, a.returned, b.returned) : a.returned;
+	}
+}
+
+bool scene_compiler::returned() const
+{
+	if (_frames.empty())
+		return false;
+
+	const register_info_t& flag = _registers[_frames.back().returned.reg];
+	return flag.constant && flag.value[0] != 0.f;
+}
+
+value_t scene_compiler::visit(TIntermNode* node)
+{
+	if (!node || !_error.empty())
+		return constant(0.f, 1);
+
+	if (auto typed = node->getAsTyped())
+		if (typed->getBasicType() != EbtVoid && !check_type(typed->getType()))
+			return constant(0.f, 1);
+
+	if (auto n = node->getAsConstantUnion())
+		return visit_constant(n);
+	if (auto n = node->getAsSymbolNode())
+		return load(n);
+	if (auto n = node->getAsBinaryNode())
+		return visit_binary(n);
+	if (auto n = node->getAsUnaryNode())
+		return visit_unary(n);
+	if (auto n = node->getAsAggregate())
+		return visit_aggregate(n);
+	if (auto n = node->getAsSelectionNode())
+		return visit_selection(n);
+	if (auto n = node->getAsBranchNode())
+		return visit_branch(n);
+	if (auto n = dynamic_cast<TIntermLoop*>(node))
+		return visit_loop(n);
+
+	return fail("unsupported statement");
+}
+
+value_t scene_compiler::visit_constant(const TIntermConstantUnion* node)
+{
+	const TConstUnionArray& array = node->getConstArray();
+	uint8_t size = static_cast<uint8_t>(node->getVectorSize());
+
+	float values[4] = {};
+	for (uint8_t c = 0; c < size; ++c)
+	{
+		switch (array[c].getType())
+		{
+			case EbtInt:	values[c] = static_cast<float>(array[c].getIConst()); break;
+			case EbtUint:	values[c] = static_cast<float>(array[c].getUConst()); break;
+			case EbtBool:	values[c] = array[c].getBConst() ? 1.f : 0.f; break;
+			default:		values[c] = static_cast<float>(array[c].getDConst()); break;
+		}
+	}
+
+	return constant(values, size);
+}
+
+value_t scene_compiler::arithmetic(TOperator op, value_t a, value_t b, TBasicType type)
+{
+	uint8_t size = std::max(a.size, b.size);
+	a = splat(a, size);
+	b = splat(b, size);
+
+	switch (op)
+	{
+		case EOpAdd:
+		case EOpAddAssign:
+			return emit(vm_opcode::ADD, size, a, b);
+
+		case EOpSub:
+		case EOpSubAssign:
+			return emit(vm_opcode::SUB, size, a, b);
+
+		case EOpMul:
+		case EOpMulAssign:
+		case EOpVectorTimesScalar:
+		case EOpVectorTimesScalarAssign:
+			return emit(vm_opcode::MUL, size, a, b);
+
+		case EOpDiv:
+		case EOpDivAssign:
+		{
+			value_t q = emit(vm_opcode::DIV, size, a, b);
+			return is_integer(type) ? emit(vm_opcode::TRUNC, size, q) : q;
+		}
+
+		case EOpMod:
+		case EOpModAssign:
+		{
+			/* The % operator is only defined on integers and truncates the quotient */
+			value_t q = emit(vm_opcode::TRUNC, size, emit(vm_opcode::DIV, size, a, b));
+			return emit(vm_opcode::SUB, size, a, emit(vm_opcode::MUL, size, b, q));
+		}
+
+		default:
+			return fail("unsupported arithmetic operator");
+	}
+}
+
+value_t scene_compiler::convert(value_t v, TBasicType from, TBasicType to)
+{
+	if (to == EbtBool && from != EbtBool)
+		return emit(vm_opcode::NOT_EQUAL, v.size, v, constant(0.f, v.size));
+
+	if (is_integer(to) && is_floating(from))
+		return emit(vm_opcode::TRUNC, v.size, v);
+
+	return v;
+}
+
+value_t scene_compiler::visit_binary(TIntermBinary* node)
+{
+	TOperator op = node->getOp();
+	TIntermTyped* left = node->getLeft();
+	TIntermTyped* right = node->getRight();
+
+	switch (op)
+	{
+		case EOpAssign:
+		{
+			value_t v = visit(right);
+			assign(left, v);
+			return v;
+		}
+
+		case EOpAddAssign:
+		case EOpSubAssign:
+		case EOpMulAssign:
+		case EOpDivAssign:
+		case EOpModAssign:
+		case EOpVectorTimesScalarAssign:
+		{
+			value_t v = arithmetic(op, visit(left), visit(right), node->getBasicType());
+			assign(left, v);
+			return v;
+		}
+
+		case EOpAdd:
+		case EOpSub:
+		case EOpMul:
+		case EOpDiv:
+		case EOpMod:
+		case EOpVectorTimesScalar:
+			return arithmetic(op, visit(left), visit(right), node->getBasicType());
+
+		case EOpVectorSwizzle:
+		{
+			value_t base = visit(left);
+			std::vector<std::pair<uint32_t, uint8_t>> components;
+
+			for (auto selector : right->getAsAggregate()->getSequence())
+				components.emplace_back(base.reg, static_cast<uint8_t>(selector->getAsConstantUnion()->getConstArray()[0].getIConst()));
+
+			return shuffle(components);
+		}
+
+		case EOpIndexDirect:
+		{
+			if (!check_type(left->getType()))
+				return constant(0.f, 1);
+			value_t base = visit(left);
+			return component(base, static_cast<uint8_t>(right->getAsConstantUnion()->getConstArray()[0].getIConst()));
+		}
+
+		case EOpIndexIndirect:
+		{
+			if (!check_type(left->getType()))
+				return constant(0.f, 1);
+
+			/* Dynamic indexing of a vector is a chain of selects over its components */
+			value_t base = visit(left);
+			value_t index = visit(right);
+			value_t v = component(base, 0);
+
+			for (uint8_t c = 1; c < base.size; ++c)
+				v = select(emit(vm_opcode::EQUAL, 1, index, constant(c, 1)), component(base, c), v);
+
+			return v;
+		}
+
+		case EOpIndexDirectStruct:
+		{
+			/* Members of the uniform blocks are bound by name, like plain uniforms */
+			const TType& block = left->getType();
+			auto symbol = left->getAsSymbolNode();
+
+			if (!symbol || block.getBasicType() != EbtBlock || block.getQualifier().storage != EvqUniform)
+				return fail("structs are not supported");
+
+			int32_t index = right->getAsConstantUnion()->getConstArray()[0].getIConst();
+			const TType& member = *(*block.getStruct())[index].type;
+
+			if (!check_type(member))
+				return constant(0.f, 1);
+
+			return uniform(member.getFieldName().c_str(), static_cast<uint8_t>(member.getVectorSize()));
+		}
+
+		case EOpComma:
+			visit(left);
+			return visit(right);
+
+		case EOpLogicalAnd:
+			return emit(vm_opcode::AND, 1, visit(left), visit(right));
+		case EOpLogicalOr:
+			return emit(vm_opcode::OR, 1, visit(left), visit(right));
+		case EOpLogicalXor:
+			return emit(vm_opcode::XOR, 1, visit(left), visit(right));
+
+		case EOpEqual:
+		case EOpNotEqual:
+		{
+			/* The == and != operators compare the whole vector */
+			value_t a = visit(left);
+			value_t b = visit(right);
+			value_t equal = emit(vm_opcode::EQUAL, a.size, a, b);
+
+			if (a.size > 1)
+				equal = emit(vm_opcode::ALL, 1, equal);
+
+			return op == EOpEqual ? equal : emit(vm_opcode::NOT, 1, equal);
+		}
+
+		case EOpVectorEqual:
+		case EOpVectorNotEqual:
+		case EOpLessThan:
+		case EOpGreaterThan:
+		case EOpLessThanEqual:
+		case EOpGreaterThanEqual:
+		{
+			static const std::unordered_map<int32_t, vm_opcode> comparisons =
+			{
+				{ EOpVectorEqual,		vm_opcode::EQUAL },
+				{ EOpVectorNotEqual,	vm_opcode::NOT_EQUAL },
+				{ EOpLessThan,			vm_opcode::LESS },
+				{ EOpGreaterThan,		vm_opcode::GREATER },
+				{ EOpLessThanEqual,		vm_opcode::LESS_EQUAL },
+				{ EOpGreaterThanEqual,	vm_opcode::GREATER_EQUAL }
+			};
+
+			value_t a = visit(left);
+			value_t b = visit(right);
+			return emit(comparisons.at(op), a.size, a, b);
+		}
+
+		default:
+			return fail("unsupported binary operator");
+	}
+}
+
+value_t scene_compiler::visit_unary(TIntermUnary* node)
+{
+	static const std::unordered_map<int32_t, vm_opcode> builtins =
+	{
+		{ EOpNegative,			vm_opcode::NEG },
+		{ EOpLogicalNot,		vm_opcode::NOT },
+		{ EOpVectorLogicalNot,	vm_opcode::NOT },
+		{ EOpSin,				vm_opcode::SIN },
+		{ EOpCos,				vm_opcode::COS },
+		{ EOpTan,				vm_opcode::TAN },
+		{ EOpAsin,				vm_opcode::ASIN },
+		{ EOpAcos,				vm_opcode::ACOS },
+		{ EOpAtan,				vm_opcode::ATAN },
+		{ EOpSinh,				vm_opcode::SINH },
+		{ EOpCosh,				vm_opcode::COSH },
+		{ EOpTanh,				vm_opcode::TANH },
+		{ EOpExp,				vm_opcode::EXP },
+		{ EOpLog,				vm_opcode::LOG },
+		{ EOpExp2,				vm_opcode::EXP2 },
+		{ EOpLog2,				vm_opcode::LOG2 },
+		{ EOpSqrt,				vm_opcode::SQRT },
+		{ EOpInverseSqrt,		vm_opcode::INVERSE_SQRT },
+		{ EOpAbs,				vm_opcode::ABS },
+		{ EOpSign,				vm_opcode::SIGN },
+		{ EOpFloor,				vm_opcode::FLOOR },
+		{ EOpTrunc,				vm_opcode::TRUNC },
+		{ EOpRound,				vm_opcode::ROUND },
+		{ EOpRoundEven,			vm_opcode::ROUND },
+		{ EOpCeil,				vm_opcode::CEIL },
+		{ EOpFract,				vm_opcode::FRACT }
+	};
+
+	TOperator op = node->getOp();
+	TIntermTyped* operand = node->getOperand();
+	TBasicType from = operand->getBasicType();
+	TBasicType to = node->getBasicType();
+
+	auto builtin = builtins.find(op);
+	if (builtin != builtins.end())
+	{
+		value_t v = visit(operand);
+		return emit(builtin->second, v.size, v);
+	}
+
+	switch (op)
+	{
+		case EOpPostIncrement:
+		case EOpPostDecrement:
+		case EOpPreIncrement:
+		case EOpPreDecrement:
+		{
+			value_t v = visit(operand);
+			vm_opcode step = op == EOpPostIncrement || op == EOpPreIncrement ? vm_opcode::ADD : vm_opcode::SUB;
+			value_t updated = emit(step, v.size, v, constant(1.f, v.size));
+			assign(operand, updated);
+			return op == EOpPostIncrement || op == EOpPostDecrement ? v : updated;
+		}
+
+		case EOpRadians:
+		case EOpDegrees:
+		{
+			value_t v = visit(operand);
+			float scale = op == EOpRadians ? 3.14159265358979f / 180.f : 180.f / 3.14159265358979f;
+			return emit(vm_opcode::MUL, v.size, v, constant(scale, v.size));
+		}
+
+		case EOpLength:
+		{
+			value_t v = visit(operand);
+			return emit(vm_opcode::LENGTH, 1, v);
+		}
+
+		case EOpNormalize:
+		{
+			value_t v = visit(operand);
+			return emit(vm_opcode::DIV, v.size, v, splat(emit(vm_opcode::LENGTH, 1, v), v.size));
+		}
+
+		case EOpAny:
+		case EOpAll:
+		{
+			value_t v = visit(operand);
+			return emit(op == EOpAny ? vm_opcode::ANY : vm_opcode::ALL, 1, v);
+		}
+
+		default:
+			break;
+	}
+
+	/* Every scalar type is stored as a float, conversions only need to truncate or normalize booleans */
+	if (op >= EOpConvIntToBool && op <= EOpConvInt64ToUint64)
+		return convert(visit(operand), from, to);
+
+	return fail("unsupported unary operator");
+}
+
+value_t scene_compiler::visit_aggregate(TIntermAggregate* node)
+{
+	TOperator op = node->getOp();
+	auto& args = node->getSequence();
+
+	if (op == EOpSequence)
+	{
+		for (auto statement : args)
+		{
+			visit(statement);
+
+			/* Everything after an unconditional return is dead code */
+			if (returned() || !_error.empty())
+				break;
+		}
+
+		return constant(0.f, 1);
+	}
+
+	if (op == EOpLinkerObjects)
+		return constant(0.f, 1);
+
+	if (op == EOpFunctionCall)
+		return visit_call(node);
+
+	if (op > EOpConstructGuardStart && op < EOpConstructGuardEnd)
+		return visit_constructor(node);
+
+	std::vector<value_t> values;
+	for (auto arg : args)
+		values.push_back(visit(arg));
+
+	uint8_t size = static_cast<uint8_t>(node->getVectorSize());
+
+	/* Scalar arguments of component-wise functions (e.g. min(vec3, float)) are broadcast to the result size */
+	auto broadcast = [this, &values](uint8_t n)
+	{
+		for (auto& v : values)
+			v = splat(v, n);
+	};
+
+	switch (op)
+	{
+		case EOpMin:
+		case EOpMax:
+		case EOpPow:
+		case EOpMod:
+		case EOpAtan:
+		case EOpStep:
+		{
+			static const std::unordered_map<int32_t, vm_opcode> builtins =
+			{
+				{ EOpMin,	vm_opcode::MIN },
+				{ EOpMax,	vm_opcode::MAX },
+				{ EOpPow,	vm_opcode::POW },
+				{ EOpMod,	vm_opcode::MOD },
+				{ EOpAtan,	vm_opcode::ATAN2 },
+				{ EOpStep,	vm_opcode::STEP }
+			};
+
+			broadcast(size);
+			return emit(builtins.at(op), size, values[0], values[1]);
+		}
+
+		case EOpClamp:
+		case EOpSmoothStep:
+		case EOpFma:
+			broadcast(size);
+			return emit(op == EOpClamp ? vm_opcode::CLAMP : (op == EOpFma ? vm_opcode::FMA : vm_opcode::SMOOTHSTEP),
+						size, values[0], values[1], values[2]);
+
+		case EOpMix:
+			broadcast(size);
+			if (args[2]->getAsTyped()->getBasicType() == EbtBool)
+				return emit(vm_opcode::SELECT, size, values[2], values[1], values[0]);
+			return emit(vm_opcode::MIX, size, values[0], values[1], values[2]);
+
+		case EOpDot:
+			return emit(vm_opcode::DOT, 1, values[0], values[1]);
+
+		case EOpDistance:
+			return emit(vm_opcode::LENGTH, 1, emit(vm_opcode::SUB, values[0].size, values[0], values[1]));
+
+		case EOpCross:
+			return emit(vm_opcode::CROSS, 3, values[0], values[1]);
+
+		case EOpReflect:
+		{
+			/* I - 2 * dot(N, I) * N */
+			value_t d = emit(vm_opcode::DOT, 1, values[1], values[0]);
+			value_t scale = splat(emit(vm_opcode::MUL, 1, d, constant(2.f, 1)), size);
+			return emit(vm_opcode::SUB, size, values[0], emit(vm_opcode::MUL, size, scale, values[1]));
+		}
+
+		case EOpLessThan:
+		case EOpGreaterThan:
+		case EOpLessThanEqual:
+		case EOpGreaterThanEqual:
+		case EOpVectorEqual:
+		case EOpVectorNotEqual:
+		{
+			static const std::unordered_map<int32_t, vm_opcode> comparisons =
+			{
+				{ EOpVectorEqual,		vm_opcode::EQUAL },
+				{ EOpVectorNotEqual,	vm_opcode::NOT_EQUAL },
+				{ EOpLessThan,			vm_opcode::LESS },
+				{ EOpGreaterThan,		vm_opcode::GREATER },
+				{ EOpLessThanEqual,		vm_opcode::LESS_EQUAL },
+				{ EOpGreaterThanEqual,	vm_opcode::GREATER_EQUAL }
+			};
+
+			return emit(comparisons.at(op), size, values[0], values[1]);
+		}
+
+		default:
+			return fail("unsupported function or operator");
+	}
+}
+
+value_t scene_compiler::visit_constructor(TIntermAggregate* node)
+{
+	if (node->getOp() == EOpConstructStruct)
+		return fail("structs are not supported");
+
+	TBasicType to = node->getBasicType();
+	uint8_t size = static_cast<uint8_t>(node->getVectorSize());
+
+	/* Every component of every argument, in order */
+	std::vector<std::pair<uint32_t, uint8_t>> components;
+	for (auto arg : node->getSequence())
+	{
+		value_t v = convert(visit(arg), arg->getAsTyped()->getBasicType(), to);
+		for (uint8_t c = 0; c < v.size; ++c)
+			components.emplace_back(v.reg, c);
+	}
+
+	if (components.empty())
+		return fail("empty constructor");
+
+	/* vecN(scalar) fills every component, otherwise the extra components are dropped */
+	if (components.size() == 1)
+		components.resize(size, components[0]);
+	else if (components.size() > size)
+		components.resize(size);
+
+	return shuffle(components);
+}
+
+value_t scene_compiler::visit_call(TIntermAggregate* node)
+{
+	auto it = _functions.find(node->getName().c_str());
+	if (it == _functions.end())
+		return fail(std::string("function ") + node->getName().c_str() + " has no definition");
+
+	if (_frames.size() >= MAX_CALL_DEPTH)
+		return fail("too many nested calls");
+
+	auto& args = node->getSequence();
+	auto& definition = it->second->getSequence();
+	auto& params = definition[0]->getAsAggregate()->getSequence();
+
+	/* Arguments are evaluated in the caller frame */
+	std::vector<value_t> values;
+	for (size_t i = 0; i < args.size(); ++i)
+	{
+		TStorageQualifier storage = params[i]->getAsTyped()->getQualifier().storage;
+		values.push_back(storage == EvqOut ? constant(0.f, static_cast<uint8_t>(args[i]->getAsTyped()->getVectorSize()))
+										   : visit(args[i]));
+	}
+
+	const TType& return_type = it->second->getType();
+
+	frame_t frame;
+	frame.result = constant(0.f, return_type.getBasicType() == EbtVoid ? 1 : static_cast<uint8_t>(return_type.getVectorSize()));
+	frame.returned = constant(0.f, 1);
+
+	for (size_t i = 0; i < params.size(); ++i)
+		frame.locals[params[i]->getAsSymbolNode()->getId()] = values[i];
+
+	_frames.push_back(frame);
+
+	if (definition.size() > 1)
+		visit(definition[1]);
+
+	frame = _frames.back();
+	_frames.pop_back();
+
+	/* Output parameters are copied back to the arguments */
+	for (size_t i = 0; i < params.size(); ++i)
+	{
+		TStorageQualifier storage = params[i]->getAsTyped()->getQualifier().storage;
+		if (storage == EvqOut || storage == EvqInOut)
+			assign(args[i]->getAsTyped(), frame.locals[params[i]->getAsSymbolNode()->getId()]);
+	}
+
+	return frame.result;
+}
+
+value_t scene_compiler::visit_selection(TIntermSelection* node)
+{
+	value_t condition = visit(node->getCondition());
+
+	/* Branches known at compile time (e.g. depending on an unrolled loop counter) are compiled alone */
+	const register_info_t& info = _registers[condition.reg];
+	if (info.constant)
+		return visit(info.value[0] != 0.f ? node->getTrueBlock() : node->getFalseBlock());
+
+	state_t before = save();
+	value_t a = visit(node->getTrueBlock());
+	state_t after_true = save();
+
+	restore(before);
+	value_t b = visit(node->getFalseBlock());
+	state_t after_false = save();
+
+	merge(condition, after_true, after_false);
+
+	/* The ternary operator */
+	if (node->getBasicType() != EbtVoid)
+		return select(condition, a, b);
+
+	return constant(0.f, 1);
+}
+
+value_t scene_compiler::visit_loop(TIntermLoop* node)
+{
+	/* Loops are unrolled while their condition is known at compile time */
+	auto test = [this, node]()
+	{
+		value_t condition = visit(node->getTest());
+		const register_info_t& info = _registers[condition.reg];
+
+		if (!info.constant)
+			fail("loop conditions must be known at compile time");
+
+		return _error.empty() && info.value[0] != 0.f;
+	};
+
+	for (uint32_t iteration = 0; _error.empty(); ++iteration)
+	{
+		if (iteration == MAX_UNROLLED_ITERATIONS)
+			return fail("loop has too many iterations");
+
+		if (node->testFirst() && node->getTest() && !test())
+			break;
+
+		visit(node->getBody());
+		if (returned())
+			break;
+
+		if (node->getTerminal())
+			visit(node->getTerminal());
+
+		if (!node->testFirst() && node->getTest() && !test())
+			break;
+	}
+
+	return constant(0.f, 1);
+}
+
+value_t scene_compiler::visit_branch(TIntermBranch* node)
+{
+	if (node->getFlowOp() != EOpReturn)
+		return fail("break, continue and discard are not supported");
+
+	/* Only the points which did not return yet take the new value */
+	if (node->getExpression())
+	{
+		value_t v = visit(node->getExpression());
+		frame_t& frame = _frames.back();
+		frame.result = select(frame.returned, frame.result, v);
+	}
+
+	_frames.back().returned = constant(1.f, 1);
+	return constant(0.f, 1);
+}
+
+bool scene_compiler::compile(const TIntermediate& intermediate, scene_program_t& program)
+{
+	auto root = intermediate.getTreeRoot() ? intermediate.getTreeRoot()->getAsAggregate() : nullptr;
+	if (!root)
+		return false;
+
+	/* The point passed to scene() is always the first register */
+	value_t point = new_register(3, true);
+
+	TIntermAggregate* scene = nullptr;
+	for (auto node : root->getSequence())
+	{
+		auto function = node->getAsAggregate();
+		if (!function || function->getOp() != EOpFunction)
+			continue;
+
+		std::string name = function->getName().c_str();
+		_functions[name] = function;
+
+		if (name.compare(0, 6, "scene(") == 0)
+			scene = function;
+	}
+
+	if (!scene)
+	{
+		fail("scene() is not defined");
+	}
+	else
+	{
+		/* Initializers of the global variables */
+		for (auto node : root->getSequence())
+		{
+			auto aggregate = node->getAsAggregate();
+			if (!aggregate || (aggregate->getOp() != EOpFunction && aggregate->getOp() != EOpLinkerObjects))
+				visit(node);
+		}
+	}
+
+	value_t result = {};
+	if (_error.empty())
+	{
+		auto& definition = scene->getSequence();
+		auto& params = definition[0]->getAsAggregate()->getSequence();
+
+		if (params.size() != 1 || params[0]->getAsTyped()->getVectorSize() != 3 ||
+			scene->getType().getVectorSize() != 1 || scene->getType().getBasicType() != EbtFloat)
+		{
+			fail("scene() must take a vec3 and return a float");
+		}
+		else
+		{
+			frame_t frame;
+			frame.result = constant(0.f, 1);
+			frame.returned = constant(0.f, 1);
+			frame.locals[params[0]->getAsSymbolNode()->getId()] = point;
+
+			_frames.push_back(frame);
+			if (definition.size() > 1)
+				visit(definition[1]);
+
+			result = _frames.back().result;
+			_frames.pop_back();
+		}
+	}
+
+	if (_error.empty())
+		finalize(result, program);
+
+	if (!_error.empty())
+	{
+		std::cout << "WARNING: Could not compile scene() for the CPU, " << _error << "!" << std::endl;
+		program = scene_program_t{};
+		return false;
+	}
+
+	return true;
+}
+
+bool scene_compiler::finalize(value_t result, scene_program_t& program)
+{
+	/* Dead code elimination, starting from the returned value */
+	std::vector<bool> used(_registers.size(), false);
+	std::vector<bool> live(_nodes.size(), false);
+	used[result.reg] = true;
+
+	for (size_t n = _nodes.size(); n-- > 0; )
+	{
+		const node_t& node = _nodes[n];
+		if (!used[node.dst])
+			continue;
+
+		live[n] = true;
+		for (uint32_t i = 0; i < operand_count(node); ++i)
+			used[node.src[i]] = true;
+	}
+
+	/* Pinned registers (the point, constants and uniforms) are filled before the execution and never reused */
+	std::vector<uint32_t> physical(_registers.size(), std::numeric_limits<uint32_t>::max());
+	uint32_t next = 0;
+
+	physical[0] = next++;
+	for (uint32_t r = 1; r < _registers.size(); ++r)
+		if (_registers[r].pinned && used[r])
+			physical[r] = next++;
+
+	/* Linear scan over the straight code, a register is released after its last read */
+	std::vector<size_t> last_use(_registers.size(), 0);
+	for (size_t n = 0; n < _nodes.size(); ++n)
+		if (live[n])
+			for (uint32_t i = 0; i < operand_count(_nodes[n]); ++i)
+				last_use[_nodes[n].src[i]] = n;
+	last_use[result.reg] = std::numeric_limits<size_t>::max();
+
+	std::vector<uint32_t> free_registers;
+	std::vector<bool> released(_registers.size(), false);
+	for (size_t n = 0; n < _nodes.size(); ++n)
+	{
+		if (!live[n])
+			continue;
+
+		const node_t& node = _nodes[n];
+		uint32_t operands = operand_count(node);
+
+		vm_instruction_t instruction = {};
+		instruction.op = node.op;
+		instruction.size = node.size;
+
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			instruction.src[i] = static_cast<uint16_t>(physical[node.src[i < operands ? i : 0]]);
+			instruction.component[i] = node.component[i];
+		}
+
+		if (free_registers.empty())
+		{
+			physical[node.dst] = next++;
+		}
+		else
+		{
+			physical[node.dst] = free_registers.back();
+			free_registers.pop_back();
+		}
+
+		instruction.dst = static_cast<uint16_t>(physical[node.dst]);
+		program.code.push_back(instruction);
+
+		for (uint32_t i = 0; i < operands; ++i)
+		{
+			uint32_t src = node.src[i];
+			if (!_registers[src].pinned && last_use[src] == n && !released[src])
+			{
+				free_registers.push_back(physical[src]);
+				released[src] = true;
+			}
+		}
+	}
+
+	if (next >= MAX_REGISTERS)
+	{
+		fail("the scene is too big");
+		return false;
+	}
+
+	for (uint32_t r = 1; r < _registers.size(); ++r)
+	{
+		const register_info_t& info = _registers[r];
+		if (!info.constant || !used[r])
+			continue;
+
+		vm_constant_t c = {};
+		c.reg = static_cast<uint16_t>(physical[r]);
+		c.size = info.size;
+		std::copy(info.value, info.value + 4, c.value);
+		program.constants.push_back(c);
+	}
+
+	for (const auto& u : _uniforms)
+		if (used[u.second.reg])
+			program.uniforms.push_back({ u.first, static_cast<uint16_t>(physical[u.second.reg]), u.second.size });
+
+	program.input = 0;
+	program.output = static_cast<uint16_t>(physical[result.reg]);
+	program.num_registers = static_cast<uint16_t>(next);
+
+	return true;
+}
+
+}
+
+bool compile_scene(const TIntermediate& intermediate, scene_program_t& program)
+{
+	program = scene_program_t{};
+
+	scene_compiler compiler;
+	return compiler.compile(intermediate, program);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "scene_vm.hpp"
+
+namespace glslang
+{
+class TIntermediate;
+}
+
+/* Lowers scene() (and every function it calls) from the AST of the linked compute shader to bytecode.
+ * Matrices, arrays, structs, break/continue and loops with a trip count not known at compile time
+ * are not supported, in that case a warning is printed and false is returned.
+ */
+bool compile_scene(const glslang::TIntermediate& intermediate, scene_program_t& program);
@@ -0,0 +1,670 @@
+#include "scene_description.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+
+static constexpr const char* OBJECTS_KEY = "objects";
+static constexpr const char* TYPE_KEY = "type";
+static constexpr const char* CHILDREN_KEY = "children";
+static constexpr const char* POSITION_KEY = "position";
+static constexpr const char* ROTATION_KEY = "rotation";
+static constexpr const char* SCALE_KEY = "scale";
+static constexpr const char* RADIUS_KEY = "radius";
+static constexpr const char* SIZE_KEY = "size";
+static constexpr const char* A_KEY = "a";
+static constexpr const char* B_KEY = "b";
+static constexpr const char* NORMAL_KEY = "normal";
+static constexpr const char* OFFSET_KEY = "offset";
+static constexpr const char* K_KEY = "k";
+
+/* A box is not worth its test for fewer objects than these */
+static constexpr size_t LEAF_OBJECTS = 2;
+
+/* Starting distance of an union, farther than anything a ray can reach */
+static constexpr const char* FAR_DISTANCE = "1e10";
+
+enum class scene_operation : uint32_t
+{
+	NONE,
+	UNION,
+	SUBTRACTION,
+	INTERSECTION,
+	BLEND
+};
+
+struct scene_object_t
+{
+	/* Library function of a primitive and the arguments after the point */
+	std::string function;
+	std::string arguments;
+
+	scene_operation operation = scene_operation::NONE;
+	float k = 0.f;
+	std::vector<scene_object_t> children;
+
+	/* From the space of the parent to the space of the object */
+	glm::vec3 position = glm::vec3(0.f);
+	glm::mat3 rotation = glm::mat3(1.f);
+	float scale = 1.f;
+
+	/* Box which holds the whole surface, in the space of the parent. Planes have none */
+	glm::vec3 min = glm::vec3(0.f);
+	glm::vec3 max = glm::vec3(0.f);
+	bool bounded = false;
+};
+
+struct scene_writer_t
+{
+	std::ostringstream stream;
+	uint32_t next = 0;
+
+	std::string variable(const char* prefix) { return prefix + std::to_string(next++); }
+	void line(uint32_t indent, const std::string& text) { stream << std::string(indent, '\t') << text << "\n"; }
+};
+
+static std::string glsl_float(float f)
+{
+	std::ostringstream stream;
+	stream << std::setprecision(7) << f;
+
+	/* Integers would be parsed as ints by GLSL */
+	std::string s = stream.str();
+	if (s.find_first_of(".e") == std::string::npos)
+		s += ".0";
+	return s;
+}
+
+static std::string glsl_vec(const float* v, uint32_t size)
+{
+	std::string s = "vec" + std::to_string(size) + "(";
+	for (uint32_t i = 0; i < size; ++i)
+		s += (i > 0 ? ", " : "") + glsl_float(v[i]);
+	return s + ")";
+}
+
+static bool read_float(const rapidjson::Value& value, const char* key, float& f)
+{
+	if (!value.HasMember(key) || !value[key].IsNumber())
+		return false;
+
+	f = static_cast<float>(value[key].GetDouble());
+	return std::isfinite(f);
+}
+
+static bool read_floats(const rapidjson::Value& value, const char* key, float* floats, rapidjson::SizeType size)
+{
+	if (!value.HasMember(key) || !value[key].IsArray() || value[key].Size() != size)
+		return false;
+
+	for (rapidjson::SizeType i = 0; i < size; ++i)
+	{
+		const auto& element = value[key][i];
+		if (!element.IsNumber())
+			return false;
+
+		floats[i] = static_cast<float>(element.GetDouble());
+		if (!std::isfinite(floats[i]))
+			return false;
+	}
+
+	return true;
+}
+
+static bool read_primitive(const std::string& type, const rapidjson::Value& value, scene_object_t& object)
+{
+	glm::vec3 extent(0.f);
+	float radius = 0.f;
+	glm::vec2 size2(0.f);
+	glm::vec3 size3(0.f);
+
+	if (type == "sphere")
+	{
+		if (!read_float(value, RADIUS_KEY, radius))
+			return false;
+
+		object.function = "sd_sphere";
+		object.arguments = glsl_float(radius);
+		extent = glm::vec3(std::abs(radius));
+	}
+	else if (type == "box")
+	{
+		if (!read_floats(value, SIZE_KEY, glm::value_ptr(size3), 3))
+			return false;
+
+		object.function = "sd_box";
+		object.arguments = glsl_vec(glm::value_ptr(size3), 3);
+		extent = glm::abs(size3);
+	}
+	else if (type == "round_box")
+	{
+		if (!read_floats(value, SIZE_KEY, glm::value_ptr(size3), 3) || !read_float(value, RADIUS_KEY, radius))
+			return false;
+
+		object.function = "ud_round_box";
+		object.arguments = glsl_vec(glm::value_ptr(size3), 3) + ", " + glsl_float(radius);
+		extent = glm::abs(size3) + std::abs(radius);
+	}
+	else if (type == "torus")
+	{
+		if (!read_floats(value, RADIUS_KEY, glm::value_ptr(size2), 2))
+			return false;
+
+		object.function = "sd_torus";
+		object.arguments = glsl_vec(glm::value_ptr(size2), 2);
+		float outer = std::abs(size2.x) + std::abs(size2.y);
+		extent = glm::vec3(outer, std::abs(size2.y), outer);
+	}
+	else if (type == "capped_cylinder")
+	{
+		if (!read_floats(value, SIZE_KEY, glm::value_ptr(size2), 2))
+			return false;
+
+		object.function = "sd_capped_cylinder";
+		object.arguments = glsl_vec(glm::value_ptr(size2), 2);
+		extent = glm::vec3(std::abs(size2.x), std::abs(size2.y), std::abs(size2.x));
+	}
+	else if (type == "hexagonal_prism" || type == "triangular_prism")
+	{
+		if (!read_floats(value, SIZE_KEY, glm::value_ptr(size2), 2))
+			return false;
+
+		/* The hexagon is h.x from the center along y and farther along x, the triangle is within h.x along both */
+		bool hexagonal = type == "hexagonal_prism";
+		object.function = hexagonal ? "sd_hexagonal_prism" : "sd_triangular_prism";
+		object.arguments = glsl_vec(glm::value_ptr(size2), 2);
+		extent = glm::vec3(std::abs(size2.x) / (hexagonal ? .866025f : 1.f), std::abs(size2.x), std::abs(size2.y));
+	}
+	else if (type == "capsule")
+	{
+		glm::vec3 a, b;
+		if (!read_floats(value, A_KEY, glm::value_ptr(a), 3) || !read_floats(value, B_KEY, glm::value_ptr(b), 3) ||
+			!read_float(value, RADIUS_KEY, radius))
+			return false;
+
+		object.function = "sd_capsule";
+		object.arguments = glsl_vec(glm::value_ptr(a), 3) + ", " + glsl_vec(glm::value_ptr(b), 3) + ", " + glsl_float(radius);
+		object.min = glm::min(a, b) - std::abs(radius);
+		object.max = glm::max(a, b) + std::abs(radius);
+		object.bounded = true;
+		return true;
+	}
+	else if (type == "plane")
+	{
+		glm::vec3 normal;
+		float offset = 0.f;
+		if (!read_floats(value, NORMAL_KEY, glm::value_ptr(normal), 3) || glm::length(normal) == 0.f || !read_float(value, OFFSET_KEY, offset))
+			return false;
+
+		glm::vec4 plane(glm::normalize(normal), offset);
+		object.function = "sd_plane";
+		object.arguments = glsl_vec(glm::value_ptr(plane), 4);
+		object.bounded = false;
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+
+	object.min = -extent;
+	object.max = extent;
+	object.bounded = true;
+	return true;
+}
+
+static void bound_operation(scene_object_t& object)
+{
+	const auto& children = object.children;
+
+	if (object.operation == scene_operation::SUBTRACTION)
+	{
+		/* Nothing is ever added to the first child */
+		object.min = children.front().min;
+		object.max = children.front().max;
+		object.bounded = children.front().bounded;
+		return;
+	}
+
+	if (object.operation == scene_operation::INTERSECTION)
+	{
+		object.bounded = false;
+		for (const auto& child : children)
+		{
+			if (!child.bounded)
+				continue;
+
+			object.min = object.bounded ? glm::max(object.min, child.min) : child.min;
+			object.max = object.bounded ? glm::min(object.max, child.max) : child.max;
+			object.bounded = true;
+		}
+
+		/* Children which do not overlap leave an empty surface, the box shrinks to a point */
+		object.max = glm::max(object.min, object.max);
+		return;
+	}
+
+	object.bounded = std::all_of(children.begin(), children.end(), [](const scene_object_t& child) { return child.bounded; });
+	if (!object.bounded)
+		return;
+
+	object.min = children.front().min;
+	object.max = children.front().max;
+	for (const auto& child : children)
+	{
+		object.min = glm::min(object.min, child.min);
+		object.max = glm::max(object.max, child.max);
+	}
+
+	/* Every blend takes at most k / 4 from the smaller distance, so the surface grows at most by as much */
+	if (object.operation == scene_operation::BLEND)
+	{
+		float growth = object.k * .25f * static_cast<float>(children.size() - 1);
+		object.min -= growth;
+		object.max += growth;
+	}
+}
+
+static glm::mat3 rotation_matrix(const glm::vec3& degrees)
+{
+	glm::vec3 c = glm::cos(glm::radians(degrees));
+	glm::vec3 s = glm::sin(glm::radians(degrees));
+
+	glm::mat3 x(1.f, 0.f, 0.f, 0.f, c.x, s.x, 0.f, -s.x, c.x);
+	glm::mat3 y(c.y, 0.f, -s.y, 0.f, 1.f, 0.f, s.y, 0.f, c.y);
+	glm::mat3 z(c.z, s.z, 0.f, -s.z, c.z, 0.f, 0.f, 0.f, 1.f);
+
+	/* Right angles leave some tiny residues which are better written as zeros */
+	glm::mat3 rotation = z * y * x;
+	for (int32_t c = 0; c < 3; ++c)
+		for (int32_t r = 0; r < 3; ++r)
+			if (std::abs(rotation[c][r]) < 1e-6f)
+				rotation[c][r] = 0.f;
+
+	return rotation;
+}
+
+static bool read_object(const rapidjson::Value& value, scene_object_t& object, std::string& error)
+{
+	static const std::unordered_map<std::string, scene_operation> operations =
+	{
+		{ "union",			scene_operation::UNION },
+		{ "subtraction",	scene_operation::SUBTRACTION },
+		{ "intersection",	scene_operation::INTERSECTION },
+		{ "blend",			scene_operation::BLEND }
+	};
+
+	if (!value.IsObject() || !value.HasMember(TYPE_KEY) || !value[TYPE_KEY].IsString())
+	{
+		error = "an object has no type";
+		return false;
+	}
+
+	std::string type = value[TYPE_KEY].GetString();
+	auto operation = operations.find(type);
+
+	if (operation != operations.end())
+	{
+		object.operation = operation->second;
+
+		if (object.operation == scene_operation::BLEND && (!read_float(value, K_KEY, object.k) || object.k <= 0.f))
+		{
+			error = "a blend needs a positive k";
+			return false;
+		}
+
+		if (!value.HasMember(CHILDREN_KEY) || !value[CHILDREN_KEY].IsArray() || value[CHILDREN_KEY].Empty())
+		{
+			error = "an object of type " + type + " has no children";
+			return false;
+		}
+
+		for (const auto& child : value[CHILDREN_KEY].GetArray())
+		{
+			object.children.emplace_back();
+			if (!read_object(child, object.children.back(), error))
+				return false;
+		}
+
+		bound_operation(object);
+	}
+	else if (!read_primitive(type, value, object))
+	{
+		error = "an object of type " + type + " is unknown or misses some of its parameters";
+		return false;
+	}
+
+	glm::vec3 position(0.f), rotation(0.f);
+	if ((value.HasMember(POSITION_KEY) && !read_floats(value, POSITION_KEY, glm::value_ptr(position), 3)) ||
+		(value.HasMember(ROTATION_KEY) && !read_floats(value, ROTATION_KEY, glm::value_ptr(rotation), 3)) ||
+		(value.HasMember(SCALE_KEY) && (!read_float(value, SCALE_KEY, object.scale) || object.scale <= 0.f)))
+	{
+		error = "an object of type " + type + " has an invalid transform";
+		return false;
+	}
+
+	object.position = position;
+	object.rotation = rotation_matrix(rotation);
+
+	if (!object.bounded)
+		return true;
+
+	/* The box in the space of the parent holds the one of the object, whatever its rotation */
+	glm::vec3 min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max());
+	for (uint32_t corner = 0; corner < 8; ++corner)
+	{
+		glm::vec3 local((corner & 1) ? object.max.x : object.min.x, (corner & 2) ? object.max.y : object.min.y,
+						(corner & 4) ? object.max.z : object.min.z);
+		glm::vec3 world = object.scale * (object.rotation * local) + object.position;
+
+		min = glm::min(min, world);
+		max = glm::max(max, world);
+	}
+
+	object.min = min;
+	object.max = max;
+	return true;
+}
+
+static std::string write_object(scene_writer_t& writer, const scene_object_t& object, const std::string& point, uint32_t indent);
+
+static std::string box_test(const glm::vec3& min, const glm::vec3& max, const std::string& point)
+{
+	glm::vec3 center = (min + max) * .5f;
+	glm::vec3 extent = (max - min) * .5f;
+	return "ud_box(" + point + " - " + glsl_vec(glm::value_ptr(center), 3) + ", " + glsl_vec(glm::value_ptr(extent), 3) + ")";
+}
+
+using object_iterator = std::vector<const scene_object_t*>::iterator;
+
+struct bvh_node_t
+{
+	glm::vec3 min;
+	glm::vec3 max;
+
+	/* Points below the split along the axis are nearer to the first child, leaves have no children */
+	int32_t axis = 0;
+	float split = 0.f;
+	std::unique_ptr<bvh_node_t> children[2];
+
+	std::vector<const scene_object_t*> objects;
+	uint32_t leaf = 0;
+};
+
+static std::unique_ptr<bvh_node_t> build_hierarchy(object_iterator first, object_iterator last, uint32_t& leaves)
+{
+	auto node = std::make_unique<bvh_node_t>();
+	node->min = (*first)->min;
+	node->max = (*first)->max;
+
+	glm::vec3 centroid_min = ((*first)->min + (*first)->max) * .5f, centroid_max = centroid_min;
+	for (auto it = first; it != last; ++it)
+	{
+		glm::vec3 centroid = ((*it)->min + (*it)->max) * .5f;
+		node->min = glm::min(node->min, (*it)->min);
+		node->max = glm::max(node->max, (*it)->max);
+		centroid_min = glm::min(centroid_min, centroid);
+		centroid_max = glm::max(centroid_max, centroid);
+	}
+
+	size_t count = static_cast<size_t>(last - first);
+	if (count <= LEAF_OBJECTS)
+	{
+		node->objects.assign(first, last);
+		node->leaf = leaves++;
+		return node;
+	}
+
+	/* Split in half along the axis the centers are spread the most */
+	glm::vec3 spread = centroid_max - centroid_min;
+	int32_t axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+
+	auto middle = first + static_cast<std::ptrdiff_t>(count / 2);
+	std::nth_element(first, middle, last, [axis](const scene_object_t* a, const scene_object_t* b)
+	{
+		return a->min[axis] + a->max[axis] < b->min[axis] + b->max[axis];
+	});
+
+	node->axis = axis;
+	node->split = ((*middle)->min[axis] + (*middle)->max[axis]) * .5f;
+	node->children[0] = build_hierarchy(first, middle, leaves);
+	node->children[1] = build_hierarchy(middle, last, leaves);
+
+	return node;
+}
+
+static void write_leaf(scene_writer_t& writer, const bvh_node_t& node, const std::string& point, const std::string& distance, uint32_t indent)
+{
+	for (const auto* object : node.objects)
+	{
+		std::string d = write_object(writer, *object, point, indent);
+		writer.line(indent, distance + " = op_union(" + distance + ", " + d + ");");
+	}
+}
+
+static void write_nearest_leaf(scene_writer_t& writer, const bvh_node_t& node, const std::string& point, const std::string& distance,
+							   const std::string& nearest, uint32_t indent)
+{
+	if (!node.children[0])
+	{
+		writer.line(indent, nearest + " = " + std::to_string(node.leaf) + ";");
+		write_leaf(writer, node, point, distance, indent);
+		return;
+	}
+
+	static const char* axes[] = { ".x", ".y", ".z" };
+	writer.line(indent, "if (" + point + axes[node.axis] + " < " + glsl_float(node.split) + ")");
+	writer.line(indent, "{");
+	write_nearest_leaf(writer, *node.children[0], point, distance, nearest, indent + 1);
+	writer.line(indent, "}");
+	writer.line(indent, "else");
+	writer.line(indent, "{");
+	write_nearest_leaf(writer, *node.children[1], point, distance, nearest, indent + 1);
+	writer.line(indent, "}");
+}
+
+static void write_hierarchy(scene_writer_t& writer, const bvh_node_t& node, const std::string& point, const std::string& distance,
+							const std::string& nearest, uint32_t indent, bool root)
+{
+	/* Outside of the box the distance to it is never more than the one to any surface inside of it, so when it is more
+	 * than the closest distance found so far none of them can make it smaller. Inside of it the distance to the box is 0 while the
+	 * objects might be negative, so the box is always opened there. The distance of the union is the same with or without the test.
+	 * The root is always opened, since the union starts far from everything, and a single primitive is as cheap as its box.
+	 * The leaf evaluated first is never evaluated again.
+	 */
+	std::vector<std::string> conditions;
+	if (!node.children[0] && !nearest.empty())
+		conditions.push_back(nearest + " != " + std::to_string(node.leaf));
+	if (!root && (node.objects.size() != 1 || !node.objects.front()->children.empty()))
+		conditions.push_back(box_test(node.min, node.max, point) + " <= max(" + distance + ", 0.0)");
+
+	bool test = !conditions.empty();
+	if (test)
+	{
+		writer.line(indent, "if (" + conditions.front() + (conditions.size() > 1 ? " && " + conditions.back() : "") + ")");
+		writer.line(indent++, "{");
+	}
+
+	if (node.children[0])
+	{
+		write_hierarchy(writer, *node.children[0], point, distance, nearest, indent, false);
+		write_hierarchy(writer, *node.children[1], point, distance, nearest, indent, false);
+	}
+	else
+	{
+		write_leaf(writer, node, point, distance, indent);
+	}
+
+	if (test)
+		writer.line(--indent, "}");
+}
+
+static std::string write_union(scene_writer_t& writer, const std::vector<scene_object_t>& objects, const std::string& point, uint32_t indent)
+{
+	std::string distance = writer.variable("d");
+	writer.line(indent, "float " + distance + " = " + FAR_DISTANCE + ";");
+
+	/* Unbounded objects come first, the distance they leave lets the hierarchy skip more boxes */
+	std::vector<const scene_object_t*> bounded;
+	for (const auto& object : objects)
+	{
+		if (object.bounded)
+		{
+			bounded.push_back(&object);
+			continue;
+		}
+
+		std::string d = write_object(writer, object, point, indent);
+		writer.line(indent, distance + " = op_union(" + distance + ", " + d + ");");
+	}
+
+	if (bounded.empty())
+		return distance;
+
+	/* The leaf on the same side of every split as the point is usually near it, the distance it leaves lets the hierarchy skip
+	 * most of the boxes after it
+	 */
+	uint32_t leaves = 0;
+	auto root = build_hierarchy(bounded.begin(), bounded.end(), leaves);
+
+	std::string nearest;
+	if (root->children[0])
+	{
+		nearest = writer.variable("l");
+		writer.line(indent, "int " + nearest + ";");
+		write_nearest_leaf(writer, *root, point, distance, nearest, indent);
+	}
+
+	write_hierarchy(writer, *root, point, distance, nearest, indent, true);
+
+	return distance;
+}
+
+static std::string write_operation(scene_writer_t& writer, const scene_object_t& object, const std::string& point, uint32_t indent)
+{
+	if (object.operation == scene_operation::UNION)
+		return write_union(writer, object.children, point, indent);
+
+	std::string distance = write_object(writer, object.children.front(), point, indent);
+
+	for (size_t i = 1; i < object.children.size(); ++i)
+	{
+		const auto& child = object.children[i];
+
+		/* A child only changes the distance where it is below the negated one, which outside of its box needs the box to be too */
+		bool test = object.operation == scene_operation::SUBTRACTION && child.bounded && !child.children.empty();
+		if (test)
+		{
+			writer.line(indent, "if (" + box_test(child.min, child.max, point) + " <= max(-" + distance + ", 0.0))");
+			writer.line(indent++, "{");
+		}
+
+		std::string d = write_object(writer, child, point, indent);
+
+		switch (object.operation)
+		{
+			case scene_operation::SUBTRACTION:
+				writer.line(indent, distance + " = op_subtraction(" + d + ", " + distance + ");");
+				break;
+			case scene_operation::INTERSECTION:
+				writer.line(indent, distance + " = op_intersection(" + distance + ", " + d + ");");
+				break;
+			default:
+				writer.line(indent, distance + " = op_blend(" + distance + ", " + d + ", " + glsl_float(object.k) + ");");
+				break;
+		}
+
+		if (test)
+			writer.line(--indent, "}");
+	}
+
+	return distance;
+}
+
+static std::string write_object(scene_writer_t& writer, const scene_object_t& object, const std::string& point, uint32_t indent)
+{
+	/* The point is brought in the space of the object, the distance back in the one of the parent */
+	std::string local = point;
+	bool rotated = object.rotation != glm::mat3(1.f);
+
+	if (object.position != glm::vec3(0.f) || rotated || object.scale != 1.f)
+	{
+		local = writer.variable("p");
+		if (object.position != glm::vec3(0.f))
+			writer.line(indent, "vec3 " + local + " = " + point + " - " + glsl_vec(glm::value_ptr(object.position), 3) + ";");
+		else
+			writer.line(indent, "vec3 " + local + " = " + point + ";");
+
+		if (rotated)
+		{
+			const auto& r = object.rotation;
+			writer.line(indent, local + " = vec3(dot(" + local + ", " + glsl_vec(glm::value_ptr(r[0]), 3) + "), dot(" + local + ", " +
+						glsl_vec(glm::value_ptr(r[1]), 3) + "), dot(" + local + ", " + glsl_vec(glm::value_ptr(r[2]), 3) + "));");
+		}
+
+		if (object.scale != 1.f)
+			writer.line(indent, local + " /= " + glsl_float(object.scale) + ";");
+	}
+
+	std::string distance;
+	if (object.operation == scene_operation::NONE)
+	{
+		distance = writer.variable("d");
+		writer.line(indent, "float " + distance + " = " + object.function + "(" + local + ", " + object.arguments + ");");
+	}
+	else
+	{
+		distance = write_operation(writer, object, local, indent);
+	}
+
+	if (object.scale != 1.f)
+		writer.line(indent, distance + " *= " + glsl_float(object.scale) + ";");
+
+	return distance;
+}
+
+bool compile_scene_description(const fs::path& path, std::string& source)
+{
+	if (!fs::exists(path))
+	{
+		std::cout << "ERROR: The scene description " << path << " does not exist!" << std::endl;
+		return false;
+	}
+
+	rapidjson::Document doc;
+	std::string content = get_content_of_file(path);
+	doc.Parse(content.c_str());
+
+	if (doc.HasParseError() || !doc.IsObject() || !doc.HasMember(OBJECTS_KEY) || !doc[OBJECTS_KEY].IsArray() || doc[OBJECTS_KEY].Empty())
+	{
+		std::cout << "ERROR: The scene description " << path << " is not valid!" << std::endl;
+		return false;
+	}
+
+	std::vector<scene_object_t> objects;
+	std::string error;
+	for (const auto& value : doc[OBJECTS_KEY].GetArray())
+	{
+		objects.emplace_back();
+		if (!read_object(value, objects.back(), error))
+		{
+			std::cout << "ERROR: The scene description " << path << " is not valid, " << error << "!" << std::endl;
+			return false;
+		}
+	}
+
+	scene_writer_t writer;
+	writer.line(0, "/* Generated from " + path.filename().string() + " */");
+	writer.line(0, "float scene(in vec3 point)");
+	writer.line(0, "{");
+	std::string distance = write_union(writer, objects, "point", 1);
+	writer.line(1, "return " + distance + ";");
+	writer.line(0, "}");
+
+	source = writer.stream.str();
+	return true;
+}
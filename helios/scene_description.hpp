@@ -0,0 +1,19 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <string>
+
+/* A scene description is a JSON tree of primitives of raymarch_library.comp and CSG operations, which is compiled
+ * into the scene() function of the raymarch program in place of a hand-written one:
+ *
+ *	{ "objects": [ { "type": "sphere", "radius": 0.5, "position": [x, y, z] },
+ *				   { "type": "blend", "k": 0.2, "rotation": [x, y, z], "scale": 2, "children": [ ... ] }, ... ] }
+ *
+ * The objects are joined by an union, as are the children of an "union", while "subtraction" removes every other child from the
+ * first one and "intersection" and "blend" join them with op_intersection and op_blend. Rotations are in degrees around x, y and z
+ * in this order, the scale is uniform, the children of an operation live in its space.
+ * The children of every union are sorted into a hierarchy of boxes, a box is only opened when it holds the point or is nearer than the
+ * closest object found so far, so most of the objects of a large scene are skipped by the test of a box which holds them.
+ */
+bool compile_scene_description(const fs::path& path, std::string& source);
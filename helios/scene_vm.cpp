@@ -0,0 +1,238 @@
+#include "scene_vm.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+
+/* Every operation is applied component by component over all the lanes, the loops are simple enough to be vectorized */
+template <typename Op>
+inline void unary(const vm_instruction_t& i, float* registers, uint32_t lanes, Op op)
+{
+	for (uint32_t c = 0; c < i.size; ++c)
+	{
+		float* dst = registers + (i.dst * 4u + c) * lanes;
+		const float* a = registers + (i.src[0] * 4u + c) * lanes;
+
+		for (uint32_t l = 0; l < lanes; ++l)
+			dst[l] = op(a[l]);
+	}
+}
+
+template <typename Op>
+inline void binary(const vm_instruction_t& i, float* registers, uint32_t lanes, Op op)
+{
+	for (uint32_t c = 0; c < i.size; ++c)
+	{
+		float* dst = registers + (i.dst * 4u + c) * lanes;
+		const float* a = registers + (i.src[0] * 4u + c) * lanes;
+		const float* b = registers + (i.src[1] * 4u + c) * lanes;
+
+		for (uint32_t l = 0; l < lanes; ++l)
+			dst[l] = op(a[l], b[l]);
+	}
+}
+
+template <typename Op>
+inline void ternary(const vm_instruction_t& i, float* registers, uint32_t lanes, Op op)
+{
+	for (uint32_t c = 0; c < i.size; ++c)
+	{
+		float* dst = registers + (i.dst * 4u + c) * lanes;
+		const float* a = registers + (i.src[0] * 4u + c) * lanes;
+		const float* b = registers + (i.src[1] * 4u + c) * lanes;
+		const float* t = registers + (i.src[2] * 4u + c) * lanes;
+
+		for (uint32_t l = 0; l < lanes; ++l)
+			dst[l] = op(a[l], b[l], t[l]);
+	}
+}
+
+/* Sums op(a, b) over the first n components */
+template <typename Op>
+inline void reduce(const vm_instruction_t& i, float* registers, uint32_t lanes, float init, Op op)
+{
+	float* dst = registers + i.dst * 4u * lanes;
+	std::fill(dst, dst + lanes, init);
+
+	for (uint32_t c = 0; c < i.component[0]; ++c)
+	{
+		const float* a = registers + (i.src[0] * 4u + c) * lanes;
+		const float* b = registers + (i.src[1] * 4u + c) * lanes;
+
+		for (uint32_t l = 0; l < lanes; ++l)
+			dst[l] = op(dst[l], a[l], b[l]);
+	}
+}
+
+inline float truth(bool b)
+{
+	return b ? 1.f : 0.f;
+}
+
+}
+
+void execute_instruction(const vm_instruction_t& i, float* registers, uint32_t lanes)
+{
+	switch (i.op)
+	{
+		case vm_opcode::SHUFFLE:
+			for (uint32_t c = 0; c < i.size; ++c)
+			{
+				const float* src = registers + (i.src[c] * 4u + i.component[c]) * lanes;
+				std::copy(src, src + lanes, registers + (i.dst * 4u + c) * lanes);
+			}
+			break;
+
+		case vm_opcode::ADD:	binary(i, registers, lanes, [](float a, float b) { return a + b; }); break;
+		case vm_opcode::SUB:	binary(i, registers, lanes, [](float a, float b) { return a - b; }); break;
+		case vm_opcode::MUL:	binary(i, registers, lanes, [](float a, float b) { return a * b; }); break;
+		case vm_opcode::DIV:	binary(i, registers, lanes, [](float a, float b) { return a / b; }); break;
+		case vm_opcode::MOD:	binary(i, registers, lanes, [](float a, float b) { return a - b * std::floor(a / b); }); break;
+		case vm_opcode::MIN:	binary(i, registers, lanes, [](float a, float b) { return b < a ? b : a; }); break;
+		case vm_opcode::MAX:	binary(i, registers, lanes, [](float a, float b) { return a < b ? b : a; }); break;
+		case vm_opcode::POW:	binary(i, registers, lanes, [](float a, float b) { return std::pow(a, b); }); break;
+		case vm_opcode::ATAN2:	binary(i, registers, lanes, [](float a, float b) { return std::atan2(a, b); }); break;
+		case vm_opcode::STEP:	binary(i, registers, lanes, [](float e, float x) { return x < e ? 0.f : 1.f; }); break;
+
+		case vm_opcode::NEG:			unary(i, registers, lanes, [](float a) { return -a; }); break;
+		case vm_opcode::ABS:			unary(i, registers, lanes, [](float a) { return std::fabs(a); }); break;
+		case vm_opcode::SIGN:			unary(i, registers, lanes, [](float a) { return a > 0.f ? 1.f : (a < 0.f ? -1.f : 0.f); }); break;
+		case vm_opcode::FLOOR:			unary(i, registers, lanes, [](float a) { return std::floor(a); }); break;
+		case vm_opcode::CEIL:			unary(i, registers, lanes, [](float a) { return std::ceil(a); }); break;
+		case vm_opcode::FRACT:			unary(i, registers, lanes, [](float a) { return a - std::floor(a); }); break;
+		case vm_opcode::TRUNC:			unary(i, registers, lanes, [](float a) { return std::trunc(a); }); break;
+		case vm_opcode::ROUND:			unary(i, registers, lanes, [](float a) { return std::round(a); }); break;
+		case vm_opcode::SQRT:			unary(i, registers, lanes, [](float a) { return std::sqrt(a); }); break;
+		case vm_opcode::INVERSE_SQRT:	unary(i, registers, lanes, [](float a) { return 1.f / std::sqrt(a); }); break;
+		case vm_opcode::EXP:			unary(i, registers, lanes, [](float a) { return std::exp(a); }); break;
+		case vm_opcode::LOG:			unary(i, registers, lanes, [](float a) { return std::log(a); }); break;
+		case vm_opcode::EXP2:			unary(i, registers, lanes, [](float a) { return std::exp2(a); }); break;
+		case vm_opcode::LOG2:			unary(i, registers, lanes, [](float a) { return std::log2(a); }); break;
+		case vm_opcode::SIN:			unary(i, registers, lanes, [](float a) { return std::sin(a); }); break;
+		case vm_opcode::COS:			unary(i, registers, lanes, [](float a) { return std::cos(a); }); break;
+		case vm_opcode::TAN:			unary(i, registers, lanes, [](float a) { return std::tan(a); }); break;
+		case vm_opcode::ASIN:			unary(i, registers, lanes, [](float a) { return std::asin(a); }); break;
+		case vm_opcode::ACOS:			unary(i, registers, lanes, [](float a) { return std::acos(a); }); break;
+		case vm_opcode::ATAN:			unary(i, registers, lanes, [](float a) { return std::atan(a); }); break;
+		case vm_opcode::SINH:			unary(i, registers, lanes, [](float a) { return std::sinh(a); }); break;
+		case vm_opcode::COSH:			unary(i, registers, lanes, [](float a) { return std::cosh(a); }); break;
+		case vm_opcode::TANH:			unary(i, registers, lanes, [](float a) { return std::tanh(a); }); break;
+
+		case vm_opcode::CLAMP:
+			ternary(i, registers, lanes, [](float x, float lo, float hi) { return std::min(std::max(x, lo), hi); });
+			break;
+
+		case vm_opcode::MIX:
+			ternary(i, registers, lanes, [](float a, float b, float t) { return a + (b - a) * t; });
+			break;
+
+		case vm_opcode::SMOOTHSTEP:
+			ternary(i, registers, lanes, [](float e0, float e1, float x)
+			{
+				float t = std::min(std::max((x - e0) / (e1 - e0), 0.f), 1.f);
+				return t * t * (3.f - 2.f * t);
+			});
+			break;
+
+		case vm_opcode::FMA:
+			ternary(i, registers, lanes, [](float a, float b, float c) { return a * b + c; });
+			break;
+
+		case vm_opcode::SELECT:
+			ternary(i, registers, lanes, [](float m, float a, float b) { return m != 0.f ? a : b; });
+			break;
+
+		case vm_opcode::LESS:			binary(i, registers, lanes, [](float a, float b) { return truth(a < b); }); break;
+		case vm_opcode::LESS_EQUAL:		binary(i, registers, lanes, [](float a, float b) { return truth(a <= b); }); break;
+		case vm_opcode::GREATER:		binary(i, registers, lanes, [](float a, float b) { return truth(a > b); }); break;
+		case vm_opcode::GREATER_EQUAL:	binary(i, registers, lanes, [](float a, float b) { return truth(a >= b); }); break;
+		case vm_opcode::EQUAL:			binary(i, registers, lanes, [](float a, float b) { return truth(!(a < b) && !(b < a)); }); break;
+		case vm_opcode::NOT_EQUAL:		binary(i, registers, lanes, [](float a, float b) { return truth(a < b || b < a); }); break;
+		case vm_opcode::AND:			binary(i, registers, lanes, [](float a, float b) { return truth(a != 0.f && b != 0.f); }); break;
+		case vm_opcode::OR:				binary(i, registers, lanes, [](float a, float b) { return truth(a != 0.f || b != 0.f); }); break;
+		case vm_opcode::XOR:			binary(i, registers, lanes, [](float a, float b) { return truth((a != 0.f) != (b != 0.f)); }); break;
+		case vm_opcode::NOT:			unary(i, registers, lanes, [](float a) { return truth(a == 0.f); }); break;
+
+		case vm_opcode::DOT:
+			reduce(i, registers, lanes, 0.f, [](float acc, float a, float b) { return acc + a * b; });
+			break;
+
+		case vm_opcode::LENGTH:
+		{
+			reduce(i, registers, lanes, 0.f, [](float acc, float a, float) { return acc + a * a; });
+			float* dst = registers + i.dst * 4u * lanes;
+			for (uint32_t l = 0; l < lanes; ++l)
+				dst[l] = std::sqrt(dst[l]);
+			break;
+		}
+
+		case vm_opcode::ANY:
+			reduce(i, registers, lanes, 0.f, [](float acc, float a, float) { return truth(acc != 0.f || a != 0.f); });
+			break;
+
+		case vm_opcode::ALL:
+			reduce(i, registers, lanes, 1.f, [](float acc, float a, float) { return truth(acc != 0.f && a != 0.f); });
+			break;
+
+		case vm_opcode::CROSS:
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				uint32_t c1 = (c + 1) % 3;
+				uint32_t c2 = (c + 2) % 3;
+
+				float* dst = registers + (i.dst * 4u + c) * lanes;
+				const float* a1 = registers + (i.src[0] * 4u + c1) * lanes;
+				const float* a2 = registers + (i.src[0] * 4u + c2) * lanes;
+				const float* b1 = registers + (i.src[1] * 4u + c1) * lanes;
+				const float* b2 = registers + (i.src[1] * 4u + c2) * lanes;
+
+				for (uint32_t l = 0; l < lanes; ++l)
+					dst[l] = a1[l] * b2[l] - a2[l] * b1[l];
+			}
+			break;
+
+		default:
+			assert(false);
+			break;
+	}
+}
+
+void execute_scene_program(const scene_program_t& program, const float* uniform_values,
+						   const float* x, const float* y, const float* z, float* distance, uint32_t count)
+{
+	// Reused between calls, the CPU renderer evaluates the scene from every worker at the same time
+	static thread_local std::vector<float> registers;
+	registers.resize(static_cast<size_t>(program.num_registers) * 4 * VM_BATCH_SIZE);
+
+	for (uint32_t first = 0; first < count; first += VM_BATCH_SIZE)
+	{
+		uint32_t lanes = std::min(count - first, VM_BATCH_SIZE);
+		float* r = registers.data();
+
+		/* Constants and uniforms are the same for every point, but the registers are laid out for this batch size */
+		auto fill = [r, lanes](uint16_t reg, uint8_t size, const float* value)
+		{
+			for (uint32_t c = 0; c < size; ++c)
+				std::fill_n(r + (reg * 4u + c) * lanes, lanes, value[c]);
+		};
+
+		for (const auto& constant : program.constants)
+			fill(constant.reg, constant.size, constant.value);
+
+		for (size_t u = 0; u < program.uniforms.size(); ++u)
+			fill(program.uniforms[u].reg, program.uniforms[u].size, uniform_values + u * 4);
+
+		std::copy(x + first, x + first + lanes, r + (program.input * 4u + 0) * lanes);
+		std::copy(y + first, y + first + lanes, r + (program.input * 4u + 1) * lanes);
+		std::copy(z + first, z + first + lanes, r + (program.input * 4u + 2) * lanes);
+
+		for (const auto& instruction : program.code)
+			execute_instruction(instruction, r, lanes);
+
+		const float* result = r + program.output * 4u * lanes;
+		std::copy(result, result + lanes, distance + first);
+	}
+}
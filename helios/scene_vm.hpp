@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Bytecode of the scene() function, lowered from the glslang AST by compile_scene().
+ * Every user function is inlined, loops are unrolled and branches are predicated, so a program is
+ * a straight sequence of instructions without any jump, evaluated for a whole batch of points at once.
+ * Registers hold up to 4 components for every point of the batch, ints and bools are stored as floats.
+ */
+
+enum class vm_opcode : uint8_t
+{
+	/* dst[i] = src[i][component[i]], used for swizzles, constructors and splats */
+	SHUFFLE = 0,
+
+	/* Component-wise, every operand has the same size of the result */
+	ADD,
+	SUB,
+	MUL,
+	DIV,
+	MOD,
+	MIN,
+	MAX,
+	POW,
+	ATAN2,
+	STEP,
+
+	NEG,
+	ABS,
+	SIGN,
+	FLOOR,
+	CEIL,
+	FRACT,
+	TRUNC,
+	ROUND,
+	SQRT,
+	INVERSE_SQRT,
+	EXP,
+	LOG,
+	EXP2,
+	LOG2,
+	SIN,
+	COS,
+	TAN,
+	ASIN,
+	ACOS,
+	ATAN,
+	SINH,
+	COSH,
+	TANH,
+
+	CLAMP,
+	MIX,
+	SMOOTHSTEP,
+	FMA,
+	SELECT,
+
+	/* Comparisons and logical operators, the results are 0 or 1 */
+	LESS,
+	LESS_EQUAL,
+	GREATER,
+	GREATER_EQUAL,
+	EQUAL,
+	NOT_EQUAL,
+	AND,
+	OR,
+	XOR,
+	NOT,
+
+	/* Reductions of operands with component[0] components to a scalar */
+	DOT,
+	LENGTH,
+	ANY,
+	ALL,
+
+	CROSS,
+
+	COUNT
+};
+
+struct vm_instruction_t
+{
+	vm_opcode op;
+	uint8_t size;
+	uint16_t dst;
+	uint16_t src[4];
+	uint8_t component[4];
+};
+
+/* Registers filled before the execution, either with a constant or with the value of a uniform */
+struct vm_constant_t
+{
+	uint16_t reg;
+	uint8_t size;
+	float value[4];
+};
+
+struct vm_uniform_t
+{
+	std::string name;
+	uint16_t reg;
+	uint8_t size;
+};
+
+struct scene_program_t
+{
+	std::vector<vm_instruction_t> code;
+	std::vector<vm_constant_t> constants;
+	std::vector<vm_uniform_t> uniforms;
+
+	uint16_t num_registers = 0;
+	/* The point passed to scene() and the returned distance */
+	uint16_t input = 0;
+	uint16_t output = 0;
+
+	bool valid() const { return num_registers > 0; }
+};
+
+/* Maximum number of points evaluated in a single pass over the bytecode */
+static constexpr uint32_t VM_BATCH_SIZE = 64;
+
+/* Executes a single instruction, registers are laid out as [register][component][lane] */
+void execute_instruction(const vm_instruction_t& instruction, float* registers, uint32_t lanes);
+
+/* Evaluates the program at count points, uniform_values holds 4 floats for every entry of program.uniforms
+ * Thread safe, every thread uses its own registers
+ */
+void execute_scene_program(const scene_program_t& program, const float* uniform_values,
+						   const float* x, const float* y, const float* z, float* distance, uint32_t count);
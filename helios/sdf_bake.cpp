@@ -0,0 +1,209 @@
+#include "sdf_bake.hpp"
+#include "uniform_blocks.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/* The atlas is sampled from this texture unit, the first one is used by the copy program */
+static constexpr uint32_t BAKE_ATLAS_UNIT = 1;
+
+/* Largest atlas along every axis, the minimum size of a 3D texture OpenGL guarantees */
+static constexpr uint32_t MAX_ATLAS_SIZE = 2048;
+
+/* Header of _hl_bake_table, the groups of the indirect dispatch, the cells of the band and the bricks allocated so far */
+static constexpr uint32_t EMPTY_BAKE_HEADER[] = { 0, 1, 1, 0, 0, 0, 0, 0 };
+/* Only the groups and the band are cleared before a band, the bricks keep counting */
+static constexpr GLsizeiptr BAND_HEADER_SIZE = sizeof(uint32_t) * 4;
+static constexpr GLintptr BRICK_COUNT_OFFSET = sizeof(uint32_t) * 4;
+
+sdf_bake::sdf_bake() :
+	_table(invalid_handle), _band(invalid_handle), _staging(invalid_handle), _atlas(invalid_handle), _resolution(0), _atlas_bricks(0),
+	_layer(0), _bricks(0), _bricks_fence(nullptr), _ready(false), _created(false)
+{
+}
+
+bool sdf_bake::create(uint32_t resolution, uint32_t max_bricks)
+{
+	if (_created)
+		return true;
+
+	if (resolution == 0)
+		return false;
+
+	_resolution = resolution;
+	_atlas_bricks = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<float>(std::max(max_bricks, 1u)))));
+	_atlas_bricks = std::min(_atlas_bricks, MAX_ATLAS_SIZE / BAKE_BRICK_SIZE);
+
+	GLsizeiptr cells = static_cast<GLsizeiptr>(resolution) * resolution * resolution;
+	auto atlas_size = static_cast<int32_t>(_atlas_bricks * BAKE_BRICK_SIZE);
+	GLsizeiptr texels = static_cast<GLsizeiptr>(atlas_size) * atlas_size * atlas_size;
+
+	glGenBuffers(1, &_table);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _table);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(EMPTY_BAKE_HEADER) + cells * sizeof(uint32_t) * 2, nullptr, GL_DYNAMIC_COPY);
+
+	/* In the worst case every cell of the box is in the same band */
+	glGenBuffers(1, &_band);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _band);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, cells * sizeof(uint32_t), nullptr, GL_DYNAMIC_COPY);
+
+	glGenBuffers(1, &_staging);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _staging);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, texels * sizeof(float), nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	/* Half floats are enough, the distances near the surfaces are never read from the atlas */
+	glGenTextures(1, &_atlas);
+	glActiveTexture(GL_TEXTURE0 + BAKE_ATLAS_UNIT);
+	glBindTexture(GL_TEXTURE_3D, _atlas);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glTexStorage3D(GL_TEXTURE_3D, 1, GL_R16F, atlas_size, atlas_size, atlas_size);
+	glActiveTexture(GL_TEXTURE0);
+
+	/* Nothing else uses these bindings, so they stay bound for both the bake and the baked march */
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindings::BAKE_TABLE, _table);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindings::BAKE_BAND, _band);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindings::BAKE_STAGING, _staging);
+
+	if (glGetError() != GL_NO_ERROR)
+	{
+		std::cout << "ERROR: Failed to create the buffers of the bake!" << std::endl;
+		destroy();
+		return false;
+	}
+
+	_created = true;
+	restart();
+	return true;
+}
+
+void sdf_bake::destroy()
+{
+	if (_table != invalid_handle)
+		glDeleteBuffers(1, &_table);
+	if (_band != invalid_handle)
+		glDeleteBuffers(1, &_band);
+	if (_staging != invalid_handle)
+		glDeleteBuffers(1, &_staging);
+	if (_atlas != invalid_handle)
+		glDeleteTextures(1, &_atlas);
+
+	if (_bricks_fence)
+		glDeleteSync(_bricks_fence);
+
+	_table = invalid_handle;
+	_band = invalid_handle;
+	_staging = invalid_handle;
+	_atlas = invalid_handle;
+	_bricks_fence = nullptr;
+	_ready = false;
+	_created = false;
+}
+
+void sdf_bake::restart()
+{
+	if (!_created)
+		return;
+
+	/* The header is cleared below, so the count of the previous bake can not be read anymore */
+	if (_bricks_fence)
+		glDeleteSync(_bricks_fence);
+	_bricks_fence = nullptr;
+
+	/* The bricks of the previous bake might still be counted by a dispatch in flight */
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _table);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(EMPTY_BAKE_HEADER), EMPTY_BAKE_HEADER);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	_layer = 0;
+	_ready = false;
+}
+
+bool sdf_bake::step(uint32_t layers, const glm::uvec2& group_size, const raymarch_program_t& program, dispatch_buffer_t& dispatch)
+{
+	if (!_created || _ready)
+		return _ready;
+
+	uint32_t band = std::min(std::max(layers, 1u), _resolution - _layer);
+
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, _table);
+	glBufferSubData(GL_DISPATCH_INDIRECT_BUFFER, 0, BAND_HEADER_SIZE, EMPTY_BAKE_HEADER);
+
+	/* Every row of invocations is a row of cells, the layers of the band are stacked along y */
+	dispatch_block_t parameters = {};
+	parameters.bake_layers = glm::ivec2(_layer, band);
+	bind_dispatch_block(dispatch, parameters);
+	glUseProgram(program[raymarch_pass::BAKE_CLASSIFY]);
+	glDispatchCompute((_resolution + group_size.x - 1) / group_size.x, (_resolution * band + group_size.y - 1) / group_size.y, 1);
+
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	glUseProgram(program[raymarch_pass::BAKE_FILL]);
+	glDispatchComputeIndirect(0);
+
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+	_layer += band;
+	if (_layer >= _resolution)
+		_finish();
+
+	return _ready;
+}
+
+void sdf_bake::_finish()
+{
+	auto atlas_size = static_cast<int32_t>(_atlas_bricks * BAKE_BRICK_SIZE);
+
+	glMemoryBarrier(GL_PIXEL_BUFFER_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// The samples never leave the GPU, the storage buffer is the source of the upload
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _staging);
+	glActiveTexture(GL_TEXTURE0 + BAKE_ATLAS_UNIT);
+	glBindTexture(GL_TEXTURE_3D, _atlas);
+	glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, atlas_size, atlas_size, atlas_size, GL_RED, GL_FLOAT, nullptr);
+	glActiveTexture(GL_TEXTURE0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	/* The march reads the atlas after the upload anyway, only the number of bricks waits for the GPU */
+	_bricks_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_ready = true;
+}
+
+bool sdf_bake::collect()
+{
+	if (!_bricks_fence)
+		return true;
+
+	GLenum status = glClientWaitSync(_bricks_fence, 0, 0);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return false;
+
+	glDeleteSync(_bricks_fence);
+	_bricks_fence = nullptr;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, _table);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, BRICK_COUNT_OFFSET, sizeof(_bricks), &_bricks);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	if (_bricks > capacity())
+	{
+		std::cout << "WARNING: The scene needs " << _bricks << " bricks but only " << capacity()
+				  << " fit in the atlas, the other cells are marched on the exact scene!" << std::endl;
+	}
+
+	return true;
+}
+
+float sdf_bake::progress() const
+{
+	if (_resolution == 0)
+		return 0.f;
+
+	return static_cast<float>(_layer) / static_cast<float>(_resolution);
+}
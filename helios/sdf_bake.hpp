@@ -0,0 +1,68 @@
+#pragma once
+
+#include "common.hpp"
+#include "raymarch_program.hpp"
+#include "uniform_buffer.hpp"
+
+#include <cstdint>
+
+// Mirrored by _HL_BAKE_BRICK in raymarch_main.comp
+static constexpr uint32_t BAKE_BRICK_SIZE = 8;
+
+/* The bake is made by the raymarch program itself, a band of layers of cells at a time so a new scene never stalls
+ * the frames: a dispatch evaluates the scene at the center of every cell of the band and allocates a brick to those near a surface,
+ * then an indirect one fills the samples of those bricks only. Nothing is read back but the number of bricks, once the last band is done
+ * and the samples are copied from the storage buffer they were written to into the atlas, through a fence so the CPU never waits for it.
+ */
+class sdf_bake
+{
+public:
+	sdf_bake();
+	sdf_bake(const sdf_bake&) = delete;
+	~sdf_bake() = default;
+
+	sdf_bake& operator=(const sdf_bake&) = delete;
+
+	// Every function requires a current GL context
+	/* The atlas holds at least max_bricks bricks, as many as fill a cube of them */
+	bool create(uint32_t resolution, uint32_t max_bricks);
+	void destroy();
+
+	/* Forgets the current bake, the next step starts again from the first layer */
+	void restart();
+	/* Bakes the next layers of cells with the bake passes of the raymarch program, returns true once every cell is baked */
+	bool step(uint32_t layers, const glm::uvec2& group_size, const raymarch_program_t& program, dispatch_buffer_t& dispatch);
+	/* Reads the number of bricks of a complete bake once the GPU is done with it, returns false while it is still in flight */
+	bool collect();
+
+	bool created() const { return _created; }
+	bool ready() const { return _ready; }
+	float progress() const;
+
+	uint32_t resolution() const { return _resolution; }
+	/* Bricks along every axis of the atlas */
+	uint32_t atlas_bricks() const { return _atlas_bricks; }
+	uint32_t capacity() const { return _atlas_bricks * _atlas_bricks * _atlas_bricks; }
+	/* Bricks the last complete bake needed, those past the capacity are marched on the exact scene. Only known a frame or more
+	 * after the bake is ready, until then it is the count of the previous one
+	 */
+	uint32_t bricks() const { return _bricks; }
+
+private:
+	void _finish();
+
+	uint32_t _table;
+	uint32_t _band;
+	uint32_t _staging;
+	uint32_t _atlas;
+
+	uint32_t _resolution;
+	uint32_t _atlas_bricks;
+	/* First layer of cells not baked yet */
+	uint32_t _layer;
+	uint32_t _bricks;
+	/* Signaled once the number of bricks of the complete bake can be read without stalling */
+	GLsync _bricks_fence;
+	bool _ready;
+	bool _created;
+};
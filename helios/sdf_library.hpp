@@ -0,0 +1,179 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+/* Native port of the distance functions in raymarch_library.comp.
+ * Names and semantics are kept identical to the GLSL version, so the CPU renderer
+ * produces the same images as the compute shader. Keep the two files in sync!
+ */
+namespace sdf
+{
+
+using glm::vec2;
+using glm::vec3;
+using glm::vec4;
+
+inline float length_n(const vec3& point, int n)
+{
+	float t = glm::pow(point.x, float(n)) + glm::pow(point.y, float(n)) + glm::pow(point.z, float(n));
+	return glm::pow(t, 1.f / n);
+}
+
+inline float length8(const vec3& point)
+{
+	vec3 p = point * point;
+	p = p * p;
+	p = p * p;
+	return glm::pow(p.x + p.y + p.z, 1.f / 8);
+}
+
+inline float length_n(const vec2& point, int n)
+{
+	float t = glm::pow(point.x, float(n)) + glm::pow(point.y, float(n));
+	return glm::pow(t, 1.f / n);
+}
+
+inline float length8(const vec2& point)
+{
+	vec2 p = point * point;
+	p = p * p;
+	p = p * p;
+	return glm::pow(p.x + p.y, 1.f / 8);
+}
+
+inline vec3 rotate_y(const vec3& v, float t)
+{
+	float cost = glm::cos(t);
+	float sint = glm::sin(t);
+	return vec3(v.x * cost + v.z * sint, v.y, -v.x * sint + v.z * cost);
+}
+
+inline vec3 rotate_x(const vec3& v, float t)
+{
+	float cost = glm::cos(t);
+	float sint = glm::sin(t);
+	return vec3(v.x, v.y * cost - v.z * sint, v.y * sint + v.z * cost);
+}
+
+inline float sd_sphere(const vec3& point, float radius)
+{
+	return glm::length(point) - radius;
+}
+
+inline float ud_box(const vec3& point, const vec3& box)
+{
+	return glm::length(glm::max(glm::abs(point) - box, 0.f));
+}
+
+inline float sd_box(const vec3& point, const vec3& box)
+{
+	vec3 d = glm::abs(point) - box;
+	return glm::min(glm::max(d.x, glm::max(d.y, d.z)), 0.f) +
+		   glm::length(glm::max(d, 0.f));
+}
+
+inline float ud_round_box(const vec3& point, const vec3& box, float radius)
+{
+	return glm::length(glm::max(glm::abs(point) - box, 0.f)) - radius;
+}
+
+inline float sd_torus(const vec3& point, const vec2& radius)
+{
+	vec2 q = vec2(glm::length(vec2(point.x, point.z)) - radius.x, point.y);
+	return glm::length(q) - radius.y;
+}
+
+inline float sd_cylinder(const vec3& point, const vec3& c)
+{
+	return glm::length(vec2(point.x, point.z) - vec2(c.x, c.y)) - c.z;
+}
+
+// NOTE(Corralx): c must be normalized
+inline float sd_cone(const vec3& point, const vec2& c)
+{
+	float q = glm::length(vec2(point.x, point.y));
+	return glm::dot(c, vec2(q, point.z));
+}
+
+// NOTE(Corralx): n must be normalized
+inline float sd_plane(const vec3& point, const vec4& n)
+{
+	return glm::dot(point, vec3(n)) + n.w;
+}
+
+inline float sd_plane_simple(const vec3& point)
+{
+	return point.y;
+}
+
+inline float sd_hexagonal_prism(const vec3& point, const vec2& h)
+{
+	vec3 q = glm::abs(point);
+	return glm::max(q.z - h.y, glm::max((q.x * 0.866025f + q.y * 0.5f), q.y) - h.x);
+}
+
+inline float sd_triangular_prism(const vec3& point, const vec2& h)
+{
+	vec3 q = glm::abs(point);
+	return glm::max(q.z - h.y, glm::max(q.x * 0.866025f + point.y * 0.5f, -point.y) - h.x * 0.5f);
+}
+
+inline float sd_capsule(const vec3& point, const vec3& a, const vec3& b, float r)
+{
+	vec3 pa = point - a;
+	vec3 ba = b - a;
+	float h = glm::clamp(glm::dot(pa, ba) / glm::dot(ba, ba), 0.f, 1.f);
+	return glm::length(pa - ba * h) - r;
+}
+
+inline float sd_capped_cylinder(const vec3& point, const vec2& h)
+{
+	vec2 d = glm::abs(vec2(glm::length(vec2(point.x, point.z)), point.y)) - h;
+	return glm::min(glm::max(d.x, d.y), 0.f) + glm::length(glm::max(d, 0.f));
+}
+
+inline float sd_torus82(const vec3& point, const vec2& t)
+{
+	vec2 q = vec2(glm::length(vec2(point.x, point.z)) - t.x, point.y);
+	return length8(q) - t.y;
+}
+
+inline float sd_torus88(const vec3& point, const vec2& t)
+{
+	vec2 q = vec2(length8(vec2(point.x, point.z)) - t.x, point.y);
+	return length8(q) - t.y;
+}
+
+inline float sd_torus_nm(const vec3& point, const vec2& t, int n, int m)
+{
+	vec2 q = vec2(length_n(vec2(point.x, point.z), n) - t.x, point.y);
+	return length_n(q, m) - t.y;
+}
+
+inline float op_union(float d1, float d2)
+{
+	return glm::min(d1, d2);
+}
+
+inline float op_subtraction(float d1, float d2)
+{
+	return glm::max(-d1, d2);
+}
+
+inline float op_intersection(float d1, float d2)
+{
+	return glm::max(d1, d2);
+}
+
+inline vec3 op_repeate(const vec3& point, const vec3& c)
+{
+	return glm::mod(point, c) - 0.5f * c;
+}
+
+inline float op_blend(float d1, float d2, float k)
+{
+	float h = glm::clamp(0.5f + 0.5f * (d2 - d1) / k, 0.f, 1.f);
+	return glm::mix(d2, d1, h) - k * h * (1.f - h);
+}
+
+}
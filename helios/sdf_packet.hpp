@@ -0,0 +1,171 @@
+#pragma once
+
+#include "simd.hpp"
+
+#include <cmath>
+
+/* Packet version of the distance functions in raymarch_library.comp (see sdf_library.hpp).
+ * F is the lane type, either a plain float or one of the simd:: registers, so every function
+ * evaluates the same primitive for 1, 4, 8 or 16 points at once.
+ * Uniform-like arguments (radii, sizes, angles, ...) are plain floats broadcast to every lane.
+ * For the same reason explained in simd.hpp, everything lives in an anonymous namespace.
+ */
+namespace packet
+{
+namespace
+{
+
+using simd::min;
+using simd::max;
+using simd::abs;
+using simd::sqrt;
+using simd::floor;
+
+template <typename F>
+struct vec2_t
+{
+	F x, y;
+};
+
+template <typename F>
+struct vec3_t
+{
+	F x, y, z;
+};
+
+template <typename F>
+inline vec3_t<F> operator+(const vec3_t<F>& a, const vec3_t<F>& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+
+template <typename F>
+inline vec3_t<F> operator-(const vec3_t<F>& a, const vec3_t<F>& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+
+template <typename F>
+inline vec3_t<F> operator*(const vec3_t<F>& a, F s) { return { a.x * s, a.y * s, a.z * s }; }
+
+template <typename F>
+inline vec3_t<F> broadcast(float x, float y, float z) { return { F(x), F(y), F(z) }; }
+
+template <typename F>
+inline F dot(const vec3_t<F>& a, const vec3_t<F>& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+template <typename F>
+inline F length(const vec3_t<F>& a) { return sqrt(dot(a, a)); }
+
+template <typename F>
+inline F length(const vec2_t<F>& a) { return sqrt(a.x * a.x + a.y * a.y); }
+
+template <typename F>
+inline vec3_t<F> abs(const vec3_t<F>& a) { return { abs(a.x), abs(a.y), abs(a.z) }; }
+
+template <typename F>
+inline vec3_t<F> max(const vec3_t<F>& a, F b) { return { max(a.x, b), max(a.y, b), max(a.z, b) }; }
+
+template <typename F>
+inline vec2_t<F> max(const vec2_t<F>& a, F b) { return { max(a.x, b), max(a.y, b) }; }
+
+template <typename F>
+inline F mod(F x, F y) { return x - y * floor(x / y); }
+
+template <typename F>
+inline vec3_t<F> rotate_y(const vec3_t<F>& v, float t)
+{
+	F cost = F(::cosf(t));
+	F sint = F(::sinf(t));
+	return { v.x * cost + v.z * sint, v.y, -v.x * sint + v.z * cost };
+}
+
+template <typename F>
+inline vec3_t<F> rotate_x(const vec3_t<F>& v, float t)
+{
+	F cost = F(::cosf(t));
+	F sint = F(::sinf(t));
+	return { v.x, v.y * cost - v.z * sint, v.y * sint + v.z * cost };
+}
+
+template <typename F>
+inline F sd_sphere(const vec3_t<F>& point, float radius)
+{
+	return length(point) - F(radius);
+}
+
+template <typename F>
+inline F ud_box(const vec3_t<F>& point, const vec3_t<F>& box)
+{
+	return length(max(abs(point) - box, F(0.f)));
+}
+
+template <typename F>
+inline F sd_box(const vec3_t<F>& point, const vec3_t<F>& box)
+{
+	vec3_t<F> d = abs(point) - box;
+	return min(max(d.x, max(d.y, d.z)), F(0.f)) + length(max(d, F(0.f)));
+}
+
+template <typename F>
+inline F sd_torus(const vec3_t<F>& point, float radius_x, float radius_y)
+{
+	vec2_t<F> q = { length(vec2_t<F>{ point.x, point.z }) - F(radius_x), point.y };
+	return length(q) - F(radius_y);
+}
+
+template <typename F>
+inline F sd_cylinder(const vec3_t<F>& point, float cx, float cy, float cz)
+{
+	return length(vec2_t<F>{ point.x - F(cx), point.z - F(cy) }) - F(cz);
+}
+
+template <typename F>
+inline F sd_plane_simple(const vec3_t<F>& point)
+{
+	return point.y;
+}
+
+template <typename F>
+inline F sd_capsule(const vec3_t<F>& point, const vec3_t<F>& a, const vec3_t<F>& b, float r)
+{
+	vec3_t<F> pa = point - a;
+	vec3_t<F> ba = b - a;
+	F h = simd::clamp<F>(dot(pa, ba) / dot(ba, ba), F(0.f), F(1.f));
+	return length(pa - ba * h) - F(r);
+}
+
+template <typename F>
+inline F sd_capped_cylinder(const vec3_t<F>& point, float hx, float hy)
+{
+	vec2_t<F> d = { abs(length(vec2_t<F>{ point.x, point.z })) - F(hx), abs(point.y) - F(hy) };
+	return min(max(d.x, d.y), F(0.f)) + length(max(d, F(0.f)));
+}
+
+template <typename F>
+inline F op_union(F d1, F d2)
+{
+	return min(d1, d2);
+}
+
+template <typename F>
+inline F op_subtraction(F d1, F d2)
+{
+	return max(-d1, d2);
+}
+
+template <typename F>
+inline F op_intersection(F d1, F d2)
+{
+	return max(d1, d2);
+}
+
+template <typename F>
+inline vec3_t<F> op_repeate(const vec3_t<F>& point, float cx, float cy, float cz)
+{
+	return { mod(point.x, F(cx)) - F(.5f * cx), mod(point.y, F(cy)) - F(.5f * cy), mod(point.z, F(cz)) - F(.5f * cz) };
+}
+
+template <typename F>
+inline F op_blend(F d1, F d2, float k)
+{
+	F h = simd::clamp<F>(F(.5f) + F(.5f) * (d2 - d1) / F(k), F(0.f), F(1.f));
+	return simd::mix<F>(d2, d1, h) - F(k) * h * (F(1.f) - h);
+}
+
+}
+}
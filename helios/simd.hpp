@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+/* MSVC has no switch for SSE4.1, its intrinsics are always available on x64 */
+#if defined(__SSE4_1__) || (defined(_MSC_VER) && defined(_M_X64))
+#define HELIOS_SIMD_SSE4 1
+#endif
+
+#if defined(HELIOS_SIMD_SSE4) || defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/* Thin wrappers over the SSE4.1, AVX2 and AVX-512 registers, so the packet code
+ * can be written once as templates and instantiated for every instruction set.
+ * Each wrapper is only available when the translation unit is compiled for its instruction set.
+ * Everything lives in an anonymous namespace on purpose: the translation units including this header
+ * are compiled with different ISA flags, and a shared inline symbol could otherwise be resolved by the linker
+ * to a copy using instructions the running CPU does not support.
+ */
+namespace simd
+{
+namespace
+{
+
+/* Scalar fallback, lanes are plain floats and masks are plain booleans */
+template <typename F>
+struct traits;
+
+template <>
+struct traits<float>
+{
+	using mask_t = bool;
+	static constexpr uint32_t width = 1;
+
+	static float load(const float* p) { return *p; }
+	static void store(float* p, float v) { *p = v; }
+};
+
+inline float min(float a, float b) { return a < b ? a : b; }
+inline float max(float a, float b) { return a > b ? a : b; }
+inline float abs(float a) { return std::fabs(a); }
+inline float sqrt(float a) { return std::sqrt(a); }
+inline float floor(float a) { return std::floor(a); }
+inline float select(bool mask, float a, float b) { return mask ? a : b; }
+inline bool any(bool mask) { return mask; }
+inline bool and_not(bool a, bool b) { return a && !b; }
+
+#if defined(HELIOS_SIMD_SSE4)
+struct m32x4 { __m128 v; };
+
+struct f32x4
+{
+	f32x4() = default;
+	f32x4(float f) : v(_mm_set1_ps(f)) {}
+	explicit f32x4(__m128 x) : v(x) {}
+
+	__m128 v;
+};
+
+template <>
+struct traits<f32x4>
+{
+	using mask_t = m32x4;
+	static constexpr uint32_t width = 4;
+
+	static f32x4 load(const float* p) { return f32x4(_mm_loadu_ps(p)); }
+	static void store(float* p, f32x4 a) { _mm_storeu_ps(p, a.v); }
+};
+
+inline f32x4 operator+(f32x4 a, f32x4 b) { return f32x4(_mm_add_ps(a.v, b.v)); }
+inline f32x4 operator-(f32x4 a, f32x4 b) { return f32x4(_mm_sub_ps(a.v, b.v)); }
+inline f32x4 operator*(f32x4 a, f32x4 b) { return f32x4(_mm_mul_ps(a.v, b.v)); }
+inline f32x4 operator/(f32x4 a, f32x4 b) { return f32x4(_mm_div_ps(a.v, b.v)); }
+inline f32x4 operator-(f32x4 a) { return f32x4(_mm_xor_ps(a.v, _mm_set1_ps(-0.f))); }
+
+inline m32x4 operator<(f32x4 a, f32x4 b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline m32x4 operator>(f32x4 a, f32x4 b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+inline m32x4 operator&(m32x4 a, m32x4 b) { return { _mm_and_ps(a.v, b.v) }; }
+inline m32x4 operator|(m32x4 a, m32x4 b) { return { _mm_or_ps(a.v, b.v) }; }
+inline m32x4 and_not(m32x4 a, m32x4 b) { return { _mm_andnot_ps(b.v, a.v) }; }
+inline bool any(m32x4 m) { return _mm_movemask_ps(m.v) != 0; }
+
+inline f32x4 min(f32x4 a, f32x4 b) { return f32x4(_mm_min_ps(a.v, b.v)); }
+inline f32x4 max(f32x4 a, f32x4 b) { return f32x4(_mm_max_ps(a.v, b.v)); }
+inline f32x4 abs(f32x4 a) { return f32x4(_mm_andnot_ps(_mm_set1_ps(-0.f), a.v)); }
+inline f32x4 sqrt(f32x4 a) { return f32x4(_mm_sqrt_ps(a.v)); }
+inline f32x4 floor(f32x4 a) { return f32x4(_mm_floor_ps(a.v)); }
+inline f32x4 select(m32x4 m, f32x4 a, f32x4 b) { return f32x4(_mm_blendv_ps(b.v, a.v, m.v)); }
+#endif
+
+#if defined(__AVX2__)
+struct m32x8 { __m256 v; };
+
+struct f32x8
+{
+	f32x8() = default;
+	f32x8(float f) : v(_mm256_set1_ps(f)) {}
+	explicit f32x8(__m256 x) : v(x) {}
+
+	__m256 v;
+};
+
+template <>
+struct traits<f32x8>
+{
+	using mask_t = m32x8;
+	static constexpr uint32_t width = 8;
+
+	static f32x8 load(const float* p) { return f32x8(_mm256_loadu_ps(p)); }
+	static void store(float* p, f32x8 a) { _mm256_storeu_ps(p, a.v); }
+};
+
+inline f32x8 operator+(f32x8 a, f32x8 b) { return f32x8(_mm256_add_ps(a.v, b.v)); }
+inline f32x8 operator-(f32x8 a, f32x8 b) { return f32x8(_mm256_sub_ps(a.v, b.v)); }
+inline f32x8 operator*(f32x8 a, f32x8 b) { return f32x8(_mm256_mul_ps(a.v, b.v)); }
+inline f32x8 operator/(f32x8 a, f32x8 b) { return f32x8(_mm256_div_ps(a.v, b.v)); }
+inline f32x8 operator-(f32x8 a) { return f32x8(_mm256_xor_ps(a.v, _mm256_set1_ps(-0.f))); }
+
+inline m32x8 operator<(f32x8 a, f32x8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+inline m32x8 operator>(f32x8 a, f32x8 b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+inline m32x8 operator&(m32x8 a, m32x8 b) { return { _mm256_and_ps(a.v, b.v) }; }
+inline m32x8 operator|(m32x8 a, m32x8 b) { return { _mm256_or_ps(a.v, b.v) }; }
+inline m32x8 and_not(m32x8 a, m32x8 b) { return { _mm256_andnot_ps(b.v, a.v) }; }
+inline bool any(m32x8 m) { return _mm256_movemask_ps(m.v) != 0; }
+
+inline f32x8 min(f32x8 a, f32x8 b) { return f32x8(_mm256_min_ps(a.v, b.v)); }
+inline f32x8 max(f32x8 a, f32x8 b) { return f32x8(_mm256_max_ps(a.v, b.v)); }
+inline f32x8 abs(f32x8 a) { return f32x8(_mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v)); }
+inline f32x8 sqrt(f32x8 a) { return f32x8(_mm256_sqrt_ps(a.v)); }
+inline f32x8 floor(f32x8 a) { return f32x8(_mm256_floor_ps(a.v)); }
+inline f32x8 select(m32x8 m, f32x8 a, f32x8 b) { return f32x8(_mm256_blendv_ps(b.v, a.v, m.v)); }
+#endif
+
+#if defined(__AVX512F__)
+struct m32x16 { __mmask16 v; };
+
+struct f32x16
+{
+	f32x16() = default;
+	f32x16(float f) : v(_mm512_set1_ps(f)) {}
+	explicit f32x16(__m512 x) : v(x) {}
+
+	__m512 v;
+};
+
+template <>
+struct traits<f32x16>
+{
+	using mask_t = m32x16;
+	static constexpr uint32_t width = 16;
+
+	static f32x16 load(const float* p) { return f32x16(_mm512_loadu_ps(p)); }
+	static void store(float* p, f32x16 a) { _mm512_storeu_ps(p, a.v); }
+};
+
+inline f32x16 operator+(f32x16 a, f32x16 b) { return f32x16(_mm512_add_ps(a.v, b.v)); }
+inline f32x16 operator-(f32x16 a, f32x16 b) { return f32x16(_mm512_sub_ps(a.v, b.v)); }
+inline f32x16 operator*(f32x16 a, f32x16 b) { return f32x16(_mm512_mul_ps(a.v, b.v)); }
+inline f32x16 operator/(f32x16 a, f32x16 b) { return f32x16(_mm512_div_ps(a.v, b.v)); }
+inline f32x16 operator-(f32x16 a) { return f32x16(_mm512_sub_ps(_mm512_setzero_ps(), a.v)); }
+
+inline m32x16 operator<(f32x16 a, f32x16 b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ) }; }
+inline m32x16 operator>(f32x16 a, f32x16 b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ) }; }
+inline m32x16 operator&(m32x16 a, m32x16 b) { return { static_cast<__mmask16>(a.v & b.v) }; }
+inline m32x16 operator|(m32x16 a, m32x16 b) { return { static_cast<__mmask16>(a.v | b.v) }; }
+inline m32x16 and_not(m32x16 a, m32x16 b) { return { static_cast<__mmask16>(a.v & ~b.v) }; }
+inline bool any(m32x16 m) { return m.v != 0; }
+
+inline f32x16 min(f32x16 a, f32x16 b) { return f32x16(_mm512_min_ps(a.v, b.v)); }
+inline f32x16 max(f32x16 a, f32x16 b) { return f32x16(_mm512_max_ps(a.v, b.v)); }
+inline f32x16 abs(f32x16 a) { return f32x16(_mm512_abs_ps(a.v)); }
+inline f32x16 sqrt(f32x16 a) { return f32x16(_mm512_sqrt_ps(a.v)); }
+inline f32x16 floor(f32x16 a) { return f32x16(_mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)); }
+inline f32x16 select(m32x16 m, f32x16 a, f32x16 b) { return f32x16(_mm512_mask_blend_ps(m.v, b.v, a.v)); }
+#endif
+
+/* Helpers shared by every lane type */
+template <typename F>
+inline F clamp(F v, F lo, F hi) { return min(max(v, lo), hi); }
+
+template <typename F>
+inline F mix(F a, F b, F t) { return a + (b - a) * t; }
+
+}
+}
@@ -0,0 +1,133 @@
+#include "task_scheduler.hpp"
+
+#include <algorithm>
+
+task_scheduler::task_scheduler(uint32_t num_workers) :
+	_queues(), _threads(), _mutex(), _wake_up(), _finished(),
+	_task(nullptr), _remaining(0), _generation(0), _should_continue(true)
+{
+	if (num_workers == 0)
+		num_workers = std::max(std::thread::hardware_concurrency(), 1u);
+
+	for (uint32_t i = 0; i < num_workers; ++i)
+		_queues.emplace_back(std::make_unique<queue_t>());
+
+	/* The first queue belongs to the thread calling parallel_for() */
+	for (uint32_t i = 1; i < num_workers; ++i)
+		_threads.emplace_back(&task_scheduler::_worker, this, i);
+}
+
+task_scheduler::~task_scheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_should_continue = false;
+	}
+	_wake_up.notify_all();
+
+	for (auto& thread : _threads)
+		thread.join();
+}
+
+void task_scheduler::parallel_for(uint32_t count, const task_t& task)
+{
+	if (count == 0)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_task = &task;
+		_remaining = count;
+
+		/* Split the range in contiguous blocks, one per worker */
+		uint32_t workers = num_workers();
+		for (uint32_t w = 0; w < workers; ++w)
+		{
+			uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(count) * w / workers);
+			uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(count) * (w + 1) / workers);
+
+			std::lock_guard<std::mutex> queue_lock(_queues[w]->mutex);
+			for (uint32_t i = begin; i < end; ++i)
+				_queues[w]->tasks.push_back(i);
+		}
+
+		++_generation;
+	}
+	_wake_up.notify_all();
+
+	_run_tasks(0);
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_finished.wait(lock, [this]() { return _remaining == 0; });
+	_task = nullptr;
+}
+
+void task_scheduler::_worker(uint32_t index)
+{
+	uint64_t last_generation = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake_up.wait(lock, [&]() { return !_should_continue || _generation != last_generation; });
+
+			if (!_should_continue)
+				return;
+
+			last_generation = _generation;
+		}
+
+		_run_tasks(index);
+	}
+}
+
+void task_scheduler::_run_tasks(uint32_t index)
+{
+	uint32_t task = 0;
+	while (_pop(index, task) || _steal(index, task))
+	{
+		(*_task)(task);
+
+		if (--_remaining == 0)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_finished.notify_all();
+		}
+	}
+}
+
+bool task_scheduler::_pop(uint32_t index, uint32_t& task)
+{
+	auto& queue = *_queues[index];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+
+	if (queue.tasks.empty())
+		return false;
+
+	task = queue.tasks.front();
+	queue.tasks.pop_front();
+	return true;
+}
+
+bool task_scheduler::_steal(uint32_t index, uint32_t& task)
+{
+	uint32_t workers = num_workers();
+
+	/* Steal from the back of the other queues, which is the work their owner would reach last */
+	for (uint32_t offset = 1; offset < workers; ++offset)
+	{
+		auto& queue = *_queues[(index + offset) % workers];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.tasks.empty())
+			continue;
+
+		task = queue.tasks.back();
+		queue.tasks.pop_back();
+		return true;
+	}
+
+	return false;
+}
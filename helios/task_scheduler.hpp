@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Fork-join pool with per-worker queues and work stealing.
+ * Tasks are distributed in contiguous blocks so each worker starts on coherent work,
+ * and a worker that runs out of tasks steals from the back of the others' queues.
+ * This way one expensive task can only hold back its own worker, never the whole batch.
+ */
+class task_scheduler
+{
+public:
+	using task_t = std::function<void(uint32_t)>;
+
+	// A value of 0 uses one worker for every hardware thread
+	explicit task_scheduler(uint32_t num_workers = 0);
+	task_scheduler(const task_scheduler&) = delete;
+	task_scheduler(task_scheduler&&) = delete;
+	~task_scheduler();
+
+	task_scheduler& operator=(const task_scheduler&) = delete;
+	task_scheduler& operator=(task_scheduler&&) = delete;
+
+	/* Calls task(i) for every i in [0, count), the calling thread takes part in the work too */
+	void parallel_for(uint32_t count, const task_t& task);
+
+	uint32_t num_workers() const { return static_cast<uint32_t>(_queues.size()); }
+
+private:
+	struct queue_t
+	{
+		std::mutex mutex;
+		std::deque<uint32_t> tasks;
+	};
+
+	void _worker(uint32_t index);
+	void _run_tasks(uint32_t index);
+	bool _pop(uint32_t index, uint32_t& task);
+	bool _steal(uint32_t index, uint32_t& task);
+
+	std::vector<std::unique_ptr<queue_t>> _queues;
+	std::vector<std::thread> _threads;
+
+	std::mutex _mutex;
+	std::condition_variable _wake_up;
+	std::condition_variable _finished;
+
+	const task_t* _task;
+	std::atomic<uint32_t> _remaining;
+	uint64_t _generation;
+	bool _should_continue;
+};
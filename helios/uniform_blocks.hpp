@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+/* CPU mirrors of the std140 uniform blocks declared in raymarch_base.comp and copy.frag.
+ * vec3 are aligned to 16 bytes and followed by a float or by an explicit padding, bools are 32 bits wide.
+ * Keep them in sync with the shaders, the static_asserts below only catch a wrong size.
+ */
+
+// NOTE(Corralx): We are using a custom namespace to hide the names and avoid pollution
+namespace bindings
+{
+
+constexpr uint32_t RAYMARCH_PARAMETERS			= 0;
+constexpr uint32_t POSTPROCESS_PARAMETERS		= 1;
+constexpr uint32_t USER_PARAMETERS				= 2;
+constexpr uint32_t DISPATCH_PARAMETERS			= 3;
+
+/* Shader storage blocks */
+constexpr uint32_t RAYMARCH_STATISTICS			= 0;
+constexpr uint32_t EDGE_LIST					= 1;
+constexpr uint32_t BAKE_TABLE					= 2;
+constexpr uint32_t BAKE_BAND					= 3;
+constexpr uint32_t BAKE_STAGING					= 4;
+
+}
+
+struct raymarch_block_t
+{
+	float epsilon;
+	float z_far;
+	float normal_epsilon;
+	float starting_step;
+	int32_t max_iterations;
+	uint32_t enable_shadow;
+	uint32_t soft_shadow;
+	float shadow_quality;
+	float shadow_epsilon;
+	float shadow_starting_step;
+	float shadow_max_step;
+	uint32_t enable_ambient_occlusion;
+	float ambient_occlusion_step;
+	int32_t ambient_occlusion_iterations;
+	uint32_t debug_mode;
+	int32_t debug_range;
+	uint32_t march_mode;
+	float relaxation;
+	float reprojection_backoff;
+	int32_t antialiasing_samples;
+};
+
+struct camera_block_t
+{
+	glm::vec3 position;
+	float focal_length;
+	glm::vec3 view;
+	float _padding0;
+	glm::vec3 up;
+	float _padding1;
+	glm::vec3 right;
+	float _padding2;
+};
+
+struct light_block_t
+{
+	glm::vec3 direction;
+	float _padding0;
+	glm::vec3 color;
+	float _padding1;
+};
+
+struct scene_block_t
+{
+	glm::vec3 sky_color;
+	float floor_height;
+};
+
+struct frame_block_t
+{
+	float time;
+	uint32_t screen_width;
+	uint32_t screen_height;
+	float _padding;
+};
+
+struct bake_block_t
+{
+	glm::vec3 min;
+	uint32_t resolution;
+	glm::vec3 max;
+	uint32_t atlas_bricks;
+};
+
+/* _hl_raymarch_parameters */
+struct raymarch_parameters_block_t
+{
+	raymarch_block_t raymarch;
+	camera_block_t camera;
+	light_block_t light;
+	scene_block_t scene;
+	frame_block_t frame;
+	camera_block_t previous_camera;
+	bake_block_t bake;
+};
+
+/* _hl_dispatch_parameters, what changes between the dispatches of a single frame */
+struct dispatch_block_t
+{
+	int32_t cone_factor;
+	int32_t cone_input_factor;
+	int32_t reprojection;
+	int32_t interlace;
+	int32_t interlace_phase;
+	int32_t reconstruction;
+	glm::vec2 jitter;
+	glm::ivec2 bake_layers;
+	int32_t accumulated_samples;
+	int32_t _padding;
+};
+
+/* _hl_postprocess_parameters */
+struct postprocess_block_t
+{
+	uint32_t screen_width;
+	uint32_t screen_height;
+	float vignette_radius;
+	float vignette_smoothness;
+	uint32_t render_width;
+	uint32_t render_height;
+	uint32_t _padding[2];
+};
+
+static_assert(sizeof(raymarch_block_t) == 80, "raymarch_block_t does not match the std140 layout");
+static_assert(sizeof(camera_block_t) == 64, "camera_block_t does not match the std140 layout");
+static_assert(sizeof(light_block_t) == 32, "light_block_t does not match the std140 layout");
+static_assert(sizeof(scene_block_t) == 16, "scene_block_t does not match the std140 layout");
+static_assert(sizeof(frame_block_t) == 16, "frame_block_t does not match the std140 layout");
+static_assert(sizeof(bake_block_t) == 32, "bake_block_t does not match the std140 layout");
+static_assert(sizeof(raymarch_parameters_block_t) == 304, "raymarch_parameters_block_t does not match the std140 layout");
+static_assert(sizeof(dispatch_block_t) == 48, "dispatch_block_t does not match the std140 layout");
+static_assert(sizeof(postprocess_block_t) == 32, "postprocess_block_t does not match the std140 layout");
@@ -0,0 +1,215 @@
+#include "uniform_buffer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+/* Granularity of the dirty tracking, the size of a vec4 */
+static constexpr uint32_t DIRTY_ROW_SIZE = 16;
+static constexpr uint8_t ALL_COPIES_DIRTY = (1u << UNIFORM_BUFFER_COPIES) - 1;
+
+/* A copy is never waited for longer than this, after that it is overwritten anyway */
+static constexpr uint64_t FENCE_TIMEOUT = 1000000000;
+
+static uint32_t align_to(uint32_t value, uint32_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+bool create_uniform_buffer(uniform_buffer_t& buffer, const std::vector<uint32_t>& block_sizes, uint32_t first_binding)
+{
+	int32_t alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	uint32_t offset_alignment = std::max(static_cast<uint32_t>(alignment), DIRTY_ROW_SIZE);
+
+	/* Every block must start at an offset the binding accepts */
+	buffer.block_sizes = block_sizes;
+	buffer.block_offsets.clear();
+	buffer.copy_size = 0;
+	for (uint32_t size : block_sizes)
+	{
+		buffer.block_offsets.push_back(buffer.copy_size);
+		buffer.copy_size = align_to(buffer.copy_size + size, offset_alignment);
+	}
+
+	buffer.data.assign(buffer.copy_size, 0);
+	/* The storage starts undefined, so every copy is written at least once, zeros included */
+	buffer.dirty.assign(buffer.copy_size / DIRTY_ROW_SIZE, ALL_COPIES_DIRTY);
+	buffer.current = 0;
+	buffer.first_binding = first_binding;
+
+	auto total_size = static_cast<GLsizeiptr>(buffer.copy_size) * UNIFORM_BUFFER_COPIES;
+
+	glGenBuffers(1, &buffer.buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer.buffer);
+
+	/* Persistent mappings need immutable storage, which is only core since OpenGL 4.4 */
+	bool persistent = gl3wIsSupported(4, 4) != 0;
+	if (persistent)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, total_size, nullptr, flags);
+		buffer.mapped = static_cast<uint8_t*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, total_size, flags));
+	}
+	else
+	{
+		glBufferData(GL_UNIFORM_BUFFER, total_size, nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	if (glGetError() != GL_NO_ERROR || (persistent && !buffer.mapped))
+	{
+		std::cout << "ERROR: Failed to create the uniform buffer!" << std::endl;
+		destroy_uniform_buffer(buffer);
+		return false;
+	}
+
+	return true;
+}
+
+void destroy_uniform_buffer(uniform_buffer_t& buffer)
+{
+	for (auto& fence : buffer.fences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	if (buffer.buffer != invalid_handle)
+	{
+		if (buffer.mapped)
+		{
+			glBindBuffer(GL_UNIFORM_BUFFER, buffer.buffer);
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+
+		glDeleteBuffers(1, &buffer.buffer);
+	}
+
+	buffer.buffer = invalid_handle;
+	buffer.mapped = nullptr;
+}
+
+void update_uniform_block(uniform_buffer_t& buffer, uint32_t block, uint32_t offset, const void* data, uint32_t size)
+{
+	assert(block < buffer.block_offsets.size());
+	assert(offset + size <= buffer.block_sizes[block]);
+
+	uint8_t* destination = buffer.data.data() + buffer.block_offsets[block] + offset;
+	if (std::memcmp(destination, data, size) == 0)
+		return;
+
+	std::memcpy(destination, data, size);
+
+	/* Every copy has to receive the new value before it is used again */
+	uint32_t first_row = (buffer.block_offsets[block] + offset) / DIRTY_ROW_SIZE;
+	uint32_t last_row = (buffer.block_offsets[block] + offset + size - 1) / DIRTY_ROW_SIZE;
+	std::fill(buffer.dirty.begin() + first_row, buffer.dirty.begin() + last_row + 1, ALL_COPIES_DIRTY);
+}
+
+void bind_uniform_buffer(uniform_buffer_t& buffer)
+{
+	uint32_t copy_offset = buffer.current * buffer.copy_size;
+	uint8_t copy_bit = static_cast<uint8_t>(1u << buffer.current);
+
+	/* The copy was last read UNIFORM_BUFFER_COPIES frames ago, so this should almost never block */
+	GLsync& fence = buffer.fences[buffer.current];
+	if (fence)
+	{
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	if (!buffer.mapped)
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer.buffer);
+
+	/* Contiguous dirty rows are written as a single range */
+	uint32_t rows = static_cast<uint32_t>(buffer.dirty.size());
+	for (uint32_t row = 0; row < rows; )
+	{
+		if (!(buffer.dirty[row] & copy_bit))
+		{
+			++row;
+			continue;
+		}
+
+		uint32_t first = row;
+		while (row < rows && (buffer.dirty[row] & copy_bit))
+			buffer.dirty[row++] &= static_cast<uint8_t>(~copy_bit);
+
+		uint32_t offset = first * DIRTY_ROW_SIZE;
+		uint32_t size = (row - first) * DIRTY_ROW_SIZE;
+
+		if (buffer.mapped)
+			std::memcpy(buffer.mapped + copy_offset + offset, buffer.data.data() + offset, size);
+		else
+			glBufferSubData(GL_UNIFORM_BUFFER, copy_offset + offset, size, buffer.data.data() + offset);
+	}
+
+	if (!buffer.mapped)
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	for (uint32_t block = 0; block < buffer.block_offsets.size(); ++block)
+		glBindBufferRange(GL_UNIFORM_BUFFER, buffer.first_binding + block, buffer.buffer,
+						  copy_offset + buffer.block_offsets[block], buffer.block_sizes[block]);
+}
+
+void advance_uniform_buffer(uniform_buffer_t& buffer)
+{
+	/* Without a persistent mapping the driver already takes care of the synchronization */
+	GLsync& fence = buffer.fences[buffer.current];
+	if (buffer.mapped && !fence)
+		fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	buffer.current = (buffer.current + 1) % UNIFORM_BUFFER_COPIES;
+}
+
+bool create_dispatch_buffer(dispatch_buffer_t& buffer, uint32_t block_size, uint32_t binding)
+{
+	int32_t alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+	buffer.slot_size = align_to(block_size, std::max(static_cast<uint32_t>(alignment), DIRTY_ROW_SIZE));
+	buffer.next = 0;
+	buffer.binding = binding;
+
+	glGenBuffers(1, &buffer.buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer.buffer);
+	glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(buffer.slot_size) * DISPATCH_BUFFER_SLOTS, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	if (glGetError() != GL_NO_ERROR)
+	{
+		std::cout << "ERROR: Failed to create the dispatch buffer!" << std::endl;
+		destroy_dispatch_buffer(buffer);
+		return false;
+	}
+
+	return true;
+}
+
+void destroy_dispatch_buffer(dispatch_buffer_t& buffer)
+{
+	if (buffer.buffer != invalid_handle)
+		glDeleteBuffers(1, &buffer.buffer);
+
+	buffer.buffer = invalid_handle;
+}
+
+void bind_dispatch_block(dispatch_buffer_t& buffer, const void* data, uint32_t size)
+{
+	assert(size <= buffer.slot_size);
+
+	uint32_t offset = buffer.next * buffer.slot_size;
+	buffer.next = (buffer.next + 1) % DISPATCH_BUFFER_SLOTS;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer.buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferRange(GL_UNIFORM_BUFFER, buffer.binding, buffer.buffer, offset, size);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/* Number of copies of the buffer, one for every frame the GPU can be behind */
+static constexpr uint32_t UNIFORM_BUFFER_COPIES = 3;
+
+/* A single buffer holding every uniform block, replicated once per frame in flight.
+ * With OpenGL 4.4 the buffer is persistently mapped and written directly, with a fence protecting every copy,
+ * otherwise each range is uploaded with glBufferSubData. In both cases a CPU copy of the content is kept,
+ * so only the ranges actually modified since the last time a copy was in use are written.
+ */
+struct uniform_buffer_t
+{
+	uint32_t buffer = invalid_handle;
+	uint8_t* mapped = nullptr;
+
+	std::vector<uint32_t> block_offsets;
+	std::vector<uint32_t> block_sizes;
+	uint32_t copy_size = 0;
+	uint32_t current = 0;
+	uint32_t first_binding = 0;
+
+	std::vector<uint8_t> data;
+	/* One entry every 16 bytes, with a bit for every copy still holding an old value */
+	std::vector<uint8_t> dirty;
+	GLsync fences[UNIFORM_BUFFER_COPIES] = {};
+};
+
+// Block i is bound to the uniform binding point first_binding + i
+bool create_uniform_buffer(uniform_buffer_t& buffer, const std::vector<uint32_t>& block_sizes, uint32_t first_binding = 0);
+void destroy_uniform_buffer(uniform_buffer_t& buffer);
+
+/* Writes size bytes at the given offset of a block, nothing is uploaded if the content did not change */
+void update_uniform_block(uniform_buffer_t& buffer, uint32_t block, uint32_t offset, const void* data, uint32_t size);
+
+template <typename T>
+inline void update_uniform_block(uniform_buffer_t& buffer, uint32_t block, uint32_t offset, const T& value)
+{
+	update_uniform_block(buffer, block, offset, &value, static_cast<uint32_t>(sizeof(T)));
+}
+
+/* Waits for the GPU to release the current copy, uploads its dirty ranges and binds every block */
+void bind_uniform_buffer(uniform_buffer_t& buffer);
+
+// Must be called after the last command reading the current copy has been issued
+void advance_uniform_buffer(uniform_buffer_t& buffer);
+
+/* Slots of the dispatch buffer, far more than the dispatches of a frame */
+static constexpr uint32_t DISPATCH_BUFFER_SLOTS = 64;
+
+/* A single small block which changes between the dispatches of a frame, so it can not live in a copy per frame.
+ * Every dispatch writes it to the next slot of a ring with glBufferSubData and binds that range, which never overwrites
+ * the slot a previous dispatch still reads.
+ */
+struct dispatch_buffer_t
+{
+	uint32_t buffer = invalid_handle;
+	uint32_t slot_size = 0;
+	uint32_t next = 0;
+	uint32_t binding = 0;
+};
+
+bool create_dispatch_buffer(dispatch_buffer_t& buffer, uint32_t block_size, uint32_t binding);
+void destroy_dispatch_buffer(dispatch_buffer_t& buffer);
+
+/* Uploads the block read by the next dispatch and binds it */
+void bind_dispatch_block(dispatch_buffer_t& buffer, const void* data, uint32_t size);
+
+template <typename T>
+inline void bind_dispatch_block(dispatch_buffer_t& buffer, const T& block)
+{
+	bind_dispatch_block(buffer, &block, static_cast<uint32_t>(sizeof(T)));
+}
@@ -3,45 +3,15 @@
 #include <memory>
 #include <unordered_map>
 #include <algorithm>
+#include <cassert>
+#include <cstring>
 #include <iostream>
 
 #include "common.hpp"
+#include "scene_compiler.hpp"
 
-/* TODO(Corralx): Find a better way to declare these, instead of hardcoding them.
-   Ideally we would like to use the declared location through the layout(...) syntax,
-   but glslang doesn't seems to expose that value to us
- */
-/* These are the uniforms reserved for internal use, that are not exposed in the User section of the GUI */
-static std::vector<std::string> default_uniforms =
-{
-	"_hl_epsilon",
-	"_hl_z_far",
-	"_hl_normal_epsilon",
-	"_hl_starting_step",
-	"_hl_max_iterations",
-	"_hl_enable_shadow",
-	"_hl_soft_shadow",
-	"_hl_shadow_quality",
-	"_hl_shadow_epsilon",
-	"_hl_shadow_starting_step",
-	"_hl_shadow_max_step",
-	"_hl_enable_ambient_occlusion",
-	"_hl_ambient_occlusion_step",
-	"_hl_ambient_occlusion_iterations",
-	"screen_width",
-	"screen_height",
-	"_hl_floor_height",
-	"_hl_sky_color",
-	"_hl_light_direction",
-	"_hl_light_color",
-	"_hl_camera_position",
-	"_hl_camera_view",
-	"_hl_camera_up",
-	"_hl_camera_right",
-	"_hl_focal_length",
-	"time",
-	"_hl_output_image"
-};
+/* Uniforms reserved for internal use start with this, like the images the application binds, and are not exposed on the GUI */
+static constexpr const char* INTERNAL_PREFIX = "_hl_";
 
 /* This maps OpenGL type identiers to our enum-based uniforms types */
 static const std::unordered_map<int32_t, uniform_type> uniform_type_dict =
@@ -62,9 +32,126 @@ static const std::unordered_map<int32_t, uniform_type> uniform_type_dict =
 	{ GL_DOUBLE,			uniform_type::DOUBLE },
 	{ GL_DOUBLE_VEC2,		uniform_type::DVEC2  },
 	{ GL_DOUBLE_VEC3,		uniform_type::DVEC3  },
-	{ GL_DOUBLE_VEC4,		uniform_type::DVEC4  }
+	{ GL_DOUBLE_VEC4,		uniform_type::DVEC4  },
+	{ GL_FLOAT_MAT2,		uniform_type::MAT2   },
+	{ GL_FLOAT_MAT3,		uniform_type::MAT3   },
+	{ GL_FLOAT_MAT4,		uniform_type::MAT4   }
 };
 
+/* Name of the block declared through the HL_PARAMETERS macro of raymarch_base.comp */
+static const std::string user_parameters_block = "_hl_user_parameters";
+
+uniform_layout_t get_uniform_layout(uniform_type type)
+{
+	// In std140 every element of an array and every column of a matrix is aligned to a vec4
+	switch (type)
+	{
+		case uniform_type::FLOAT:	return { 1, 1, 4, 16, 16 };
+		case uniform_type::VEC2:	return { 1, 2, 4, 16, 16 };
+		case uniform_type::VEC3:	return { 1, 3, 4, 16, 16 };
+		case uniform_type::VEC4:	return { 1, 4, 4, 16, 16 };
+		case uniform_type::BOOL:	return { 1, 1, 4, 16, 16 };
+		case uniform_type::INT:		return { 1, 1, 4, 16, 16 };
+		case uniform_type::IVEC2:	return { 1, 2, 4, 16, 16 };
+		case uniform_type::IVEC3:	return { 1, 3, 4, 16, 16 };
+		case uniform_type::IVEC4:	return { 1, 4, 4, 16, 16 };
+		case uniform_type::UINT:	return { 1, 1, 4, 16, 16 };
+		case uniform_type::UVEC2:	return { 1, 2, 4, 16, 16 };
+		case uniform_type::UVEC3:	return { 1, 3, 4, 16, 16 };
+		case uniform_type::UVEC4:	return { 1, 4, 4, 16, 16 };
+		case uniform_type::DOUBLE:	return { 1, 1, 8, 16, 16 };
+		case uniform_type::DVEC2:	return { 1, 2, 8, 16, 16 };
+		case uniform_type::DVEC3:	return { 1, 3, 8, 32, 32 };
+		case uniform_type::DVEC4:	return { 1, 4, 8, 32, 32 };
+		case uniform_type::MAT2:	return { 2, 2, 4, 16, 32 };
+		case uniform_type::MAT3:	return { 3, 3, 4, 16, 48 };
+		case uniform_type::MAT4:	return { 4, 4, 4, 16, 64 };
+	}
+
+	assert(false);
+	return { 1, 1, 4, 16, 16 };
+}
+
+uniform_registry::uniform_registry(std::vector<uniform_t> uniforms, uint32_t block_size) :
+	_uniforms(std::move(uniforms)), _indices(), _block_size(block_size)
+{
+	for (size_t i = 0; i < _uniforms.size(); ++i)
+		_indices[_uniforms[i].name] = i;
+}
+
+uniform_t* uniform_registry::find(const std::string& name)
+{
+	auto it = _indices.find(name);
+	return it != _indices.end() ? &_uniforms[it->second] : nullptr;
+}
+
+const uniform_t* uniform_registry::find(const std::string& name) const
+{
+	auto it = _indices.find(name);
+	return it != _indices.end() ? &_uniforms[it->second] : nullptr;
+}
+
+void uniform_registry::update(uniform_buffer_t& buffer, uint32_t block) const
+{
+	for (const auto& u : _uniforms)
+	{
+		uniform_layout_t layout = get_uniform_layout(u.type);
+
+		for (uint32_t e = 0; e < u.array_size; ++e)
+		{
+			for (uint32_t c = 0; c < layout.columns; ++c)
+			{
+				const uniform_value_t& value = u.values[e * layout.columns + c];
+
+				/* Large enough for a dvec4 */
+				uint8_t data[32];
+				for (uint32_t i = 0; i < layout.components; ++i)
+				{
+					uint8_t* component = data + i * layout.component_size;
+
+					switch (u.type)
+					{
+						case uniform_type::DOUBLE:
+						case uniform_type::DVEC2:
+						case uniform_type::DVEC3:
+						case uniform_type::DVEC4:
+						{
+							double d = static_cast<double>(value.vec4[static_cast<int32_t>(i)]);
+							std::memcpy(component, &d, sizeof(d));
+							break;
+						}
+
+						case uniform_type::BOOL:
+						{
+							uint32_t b = value.boolean ? 1 : 0;
+							std::memcpy(component, &b, sizeof(b));
+							break;
+						}
+
+						case uniform_type::INT:
+						case uniform_type::IVEC2:
+						case uniform_type::IVEC3:
+						case uniform_type::IVEC4:
+						case uniform_type::UINT:
+						case uniform_type::UVEC2:
+						case uniform_type::UVEC3:
+						case uniform_type::UVEC4:
+							std::memcpy(component, &value.ivec4[static_cast<int32_t>(i)], sizeof(int32_t));
+							break;
+
+						default:
+							std::memcpy(component, &value.vec4[static_cast<int32_t>(i)], sizeof(float));
+							break;
+					}
+				}
+
+				uint32_t offset = u.offset + e * layout.element_stride + c * layout.column_stride;
+				update_uniform_block(buffer, block, offset, data, layout.components * layout.component_size);
+			}
+		}
+	}
+}
+
 using namespace glslang;
 
 // We use C++11 magic statics to automagically manage glslang initialization/destruction
@@ -75,10 +162,13 @@ struct glslang_raii
 	~glslang_raii() { FinalizeProcess(); }
 };
 
-std::vector<uniform_t> extract_uniform(const std::string& source)
+bool extract_uniform(const std::string& source, uniform_registry& registry, scene_program_t* scene_program)
 {
 	static glslang_raii glslang_raii{};
 
+	if (scene_program)
+		*scene_program = scene_program_t{};
+
 	auto shader = std::make_unique<TShader>(EShLangCompute);
 	auto source_ptr = source.c_str();
 	shader->setStrings(&source_ptr, 1);
@@ -89,7 +179,7 @@ std::vector<uniform_t> extract_uniform(const std::string& source)
 		std::cout << shader->getInfoLog() << std::endl;
 		std::cout << shader->getInfoDebugLog() << std::endl;
 
-		return{};
+		return false;
 	}
 
 	auto program = std::make_unique<TProgram>();
@@ -101,22 +191,50 @@ std::vector<uniform_t> extract_uniform(const std::string& source)
 		std::cout << program->getInfoLog() << std::endl;
 		std::cout << program->getInfoDebugLog() << std::endl;
 
-		return{};
+		return false;
 	}
 
 	// Generate the reflection information for the AST
 	program->buildReflection();
 
+	if (scene_program)
+		compile_scene(*program->getIntermediate(EShLangCompute), *scene_program);
+
+	// The user parameters are optional, if the scene does not declare any the block does not exist
+	int32_t user_block = -1;
+	uint32_t block_size = 0;
+	for (int32_t i = 0; i < program->getNumLiveUniformBlocks(); ++i)
+	{
+		if (program->getUniformBlockName(i) == user_parameters_block)
+		{
+			user_block = i;
+			block_size = static_cast<uint32_t>(program->getUniformBlockSize(i));
+		}
+	}
+
 	std::vector<uniform_t> uniforms;
+	bool loose_uniforms = false;
 	int32_t num_uniforms = program->getNumLiveUniformVariables();
 	for (int32_t i = 0; i < num_uniforms; ++i)
 	{
 		std::string name = program->getUniformName(i);
 
-		// Skip default uniforms
-		if (std::find(default_uniforms.begin(), default_uniforms.end(), name) != default_uniforms.end())
+		// Skip the members of our own blocks and the internal uniforms outside of them
+		int32_t block = program->getUniformBlockIndex(i);
+		if (block >= 0 && block != user_block)
+			continue;
+		if (block < 0 && name.compare(0, std::strlen(INTERNAL_PREFIX), INTERNAL_PREFIX) == 0)
 			continue;
 
+		/* They could not be set anymore and would silently render as 0, so the scene must be fixed instead */
+		if (block < 0)
+		{
+			std::cout << "ERROR: Uniform \"" << name << "\" is not declared inside HL_PARAMETERS, move its declaration "
+						 "into the block \"HL_PARAMETERS { ... };\" and drop the uniform qualifier!" << std::endl;
+			loose_uniforms = true;
+			continue;
+		}
+
 		int32_t gl_type = program->getUniformType(i);
 		auto it_type = uniform_type_dict.find(gl_type);
 
@@ -128,72 +246,30 @@ std::vector<uniform_t> extract_uniform(const std::string& source)
 			continue;
 		}
 
-		uniforms.emplace_back(name, it_type->second);
+		uniforms.emplace_back(name, it_type->second, static_cast<uint32_t>(std::max(program->getUniformArraySize(i), 1)),
+							  static_cast<uint32_t>(program->getUniformBufferOffset(i)));
 	}
 
-	return uniforms;
+	if (loose_uniforms)
+		return false;
+
+	registry = uniform_registry(std::move(uniforms), block_size);
+	return true;
 }
 
-void copy_uniforms_value(std::vector<uniform_t>& old_uniforms, std::vector<uniform_t>& new_uniforms)
+void copy_uniforms_value(const uniform_registry& old_uniforms, uniform_registry& new_uniforms)
 {
-	for (auto& u : new_uniforms)
+	for (auto& u : new_uniforms.uniforms())
 	{
 		// We reuse the current value only if the uniform as the same name and the same type
-		auto it = std::find_if(old_uniforms.begin(), old_uniforms.end(), [&u](const uniform_t& old_u)
-		{
-			return u.name == old_u.name && u.type == old_u.type;
-		});
+		const uniform_t* old_u = old_uniforms.find(u.name);
 
 		// We haven't found the uniform, so it is new and will be initialized to 0
-		if (it == old_uniforms.end())
+		if (!old_u || old_u->type != u.type)
 			continue;
 
-		switch (u.type)
-		{
-			case uniform_type::FLOAT:
-			case uniform_type::VEC2:
-			case uniform_type::VEC3:
-			case uniform_type::VEC4:
-			case uniform_type::DOUBLE:
-			case uniform_type::DVEC2:
-			case uniform_type::DVEC3:
-			case uniform_type::DVEC4:
-				u.vec4 = it->vec4;
-				break;
-
-			case uniform_type::INT:
-			case uniform_type::IVEC2:
-			case uniform_type::IVEC3:
-			case uniform_type::IVEC4:
-			case uniform_type::UINT:
-			case uniform_type::UVEC2:
-			case uniform_type::UVEC3:
-			case uniform_type::UVEC4:
-				u.ivec4 = it->ivec4;
-				break;
-
-			case uniform_type::BOOL:
-				u.boolean = it->boolean;
-				break;
-
-			default:
-				assert(false);
-				break;
-		}
-	}
-}
-
-void get_uniforms_locations(std::vector<uniform_t>& uniforms, uint32_t program)
-{
-	for (auto& u : uniforms)
-	{
-		int32_t loc = glGetUniformLocation(program, u.name.c_str());
-
-		// NOTE(Corralx): This should not happen because glslang optimize away the unused uniforms too
-		if (loc == invalid_location)
-			std::cout << "Could not retrieve location for uniform \"" << u.name
-			<< "\" (Maybe it was optimized away?)" << std::endl;
-
-		u.location = loc;
+		// The values are plain unions, so every type can be copied in the same way
+		size_t count = std::min(u.values.size(), old_u->values.size());
+		std::copy(old_u->values.begin(), old_u->values.begin() + static_cast<std::ptrdiff_t>(count), u.values.begin());
 	}
 }
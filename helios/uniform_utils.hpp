@@ -1,12 +1,52 @@
 #pragma once
 
 #include "common.hpp"
-#include "uniforms_locations.hpp"
+#include "uniform_blocks.hpp"
+#include "uniform_buffer.hpp"
+#include "scene_vm.hpp"
 
 #include <cstdint>
 #include <vector>
 #include <string>
 #include <cctype>
+#include <unordered_map>
+
+/* What the raymarch program writes instead of the shaded color, mirrored by the _HL_DEBUG_* constants of raymarch_main.comp */
+enum class debug_mode : int32_t
+{
+	NONE = 0,
+	ITERATIONS,
+	SHADOW_STEPS,
+	SCENE_CALLS,
+	TERMINATION,
+	NORMALS,
+
+	COUNT
+};
+
+/* How the primary rays advance, mirrored by the _HL_MARCH_* constants of raymarch_main.comp */
+enum class march_mode : int32_t
+{
+	PLAIN = 0,
+	/* Over-relaxed steps with a screen space stopping criterion, from Enhanced Sphere Tracing */
+	OVER_RELAXED,
+	/* Plain steps, reading the bake of the scene far from its surfaces */
+	BAKED,
+
+	COUNT
+};
+
+/* Which of the pixels are traced every frame, mirrored by the _HL_INTERLACE_* constants of raymarch_main.comp */
+enum class interlace_mode : int32_t
+{
+	NONE = 0,
+	/* Half of the pixels in a checkerboard, alternating every frame */
+	HALF,
+	/* One pixel of every 2x2 block, each of them once every four frames */
+	QUARTER,
+
+	COUNT
+};
 
 struct raymarch_t
 {
@@ -16,6 +56,21 @@ struct raymarch_t
 	float normal_epsilon = .0001f;
 	float starting_step = 1.f;
 	int32_t max_iterations = 100;
+	march_mode march = march_mode::PLAIN;
+	/* Every step is this many times the distance to the scene, in [1, 2) */
+	float relaxation = 1.2f;
+	/* Starts the primary rays from the distances of the cone prepass, if it has any level */
+	bool cone_prepass = true;
+	/* Starts the primary rays from the depth of the previous frame, moved closer to the camera by this fraction of it */
+	bool reprojection = true;
+	float reprojection_backoff = .02f;
+	/* The pixels which are not traced are rebuilt from their neighbours and from the previous frame */
+	interlace_mode interlacing = interlace_mode::NONE;
+	/* Extra samples traced for every pixel on an edge, up to 8, 0 disables the antialiasing */
+	int32_t antialiasing_samples = 4;
+	/* Samples of every pixel accumulated while nothing changes, the view is rendered again only when something does */
+	bool progressive = true;
+	int32_t progressive_samples = 64;
 
 	/* Shadows */
 	bool enable_shadow = true;
@@ -29,6 +84,11 @@ struct raymarch_t
 	bool enable_ambient_occlusion = true;
 	float ambient_occlusion_step = .01f;
 	int32_t ambient_occlusion_iterations = 5;
+
+	/* Debug */
+	debug_mode debug = debug_mode::NONE;
+	/* The count shown at the top of the heatmaps */
+	int32_t debug_range = 100;
 };
 
 struct camera_t
@@ -60,6 +120,13 @@ struct scene_t
 	float floor_height;
 };
 
+/* Box the scene is baked in, the number of cells along every axis is fixed when the bake is created */
+struct bake_t
+{
+	glm::vec3 min = glm::vec3(-4.f);
+	glm::vec3 max = glm::vec3(4.f);
+};
+
 enum class uniform_type : uint8_t
 {
 	FLOAT = 0,
@@ -82,15 +149,42 @@ enum class uniform_type : uint8_t
 	DOUBLE,
 	DVEC2,
 	DVEC3,
-	DVEC4
+	DVEC4,
+
+	MAT2,
+	MAT3,
+	MAT4
+};
+
+/* How a value of the given type is laid out in a std140 block, matrices are arrays of column vectors */
+struct uniform_layout_t
+{
+	uint32_t columns;
+	uint32_t components;
+	uint32_t component_size;
+	uint32_t column_stride;
+	/* Distance between two elements of an array */
+	uint32_t element_stride;
+};
+
+uniform_layout_t get_uniform_layout(uniform_type type);
+
+// NOTE(Corralx): ImGui does not support doubles or unsigned ints
+union uniform_value_t
+{
+	uniform_value_t() : ivec4(0) {}
+
+	glm::vec4 vec4;
+	glm::ivec4 ivec4;
+	bool boolean;
 };
 
 // TODO(Corralx): Find a way to specify a default value?
 // Uniform initialization syntax seems to be bugged in a lot of implementations!
 struct uniform_t
 {
-	uniform_t(const std::string& n, uniform_type t) :
-		name(n), readable_name(""), location(invalid_location), type(t), ivec4(0)
+	uniform_t(const std::string& n, uniform_type t, uint32_t size = 1, uint32_t o = 0) :
+		name(n), readable_name(""), type(t), array_size(size), offset(o), values(size * get_uniform_layout(t).columns)
 	{
 		std::string temp = n;
 
@@ -119,20 +213,45 @@ struct uniform_t
 
 	std::string name;
 	std::string readable_name;
-	int32_t location;
 	uniform_type type;
 
-	// NOTE(Corralx): ImGui does not support doubles or unsigned ints
-	union
-	{
-		glm::vec4 vec4;
-		glm::ivec4 ivec4;
-		bool boolean;
-	};
+	// Like GL_UNIFORM_SIZE, only the elements up to the last one used by the shader are counted
+	uint32_t array_size;
+	/* Offset of the first element inside the block of the user parameters */
+	uint32_t offset;
+
+	/* A value for every column of every element */
+	std::vector<uniform_value_t> values;
+};
+
+/* The user parameters declared by the scene, which live in the std140 block _hl_user_parameters */
+class uniform_registry
+{
+public:
+	uniform_registry() = default;
+	uniform_registry(std::vector<uniform_t> uniforms, uint32_t block_size);
+
+	uniform_t* find(const std::string& name);
+	const uniform_t* find(const std::string& name) const;
+
+	std::vector<uniform_t>& uniforms() { return _uniforms; }
+	const std::vector<uniform_t>& uniforms() const { return _uniforms; }
+	bool empty() const { return _uniforms.empty(); }
+
+	uint32_t block_size() const { return _block_size; }
+
+	/* Writes every value to the block, only the ones modified since the last call are then uploaded */
+	void update(uniform_buffer_t& buffer, uint32_t block) const;
+
+private:
+	std::vector<uniform_t> _uniforms;
+	std::unordered_map<std::string, size_t> _indices;
+	uint32_t _block_size = 0;
 };
 
-// NOTE(Corralx): After the call, the locations of the uniforms in the real compiled program are still to be retrieved
-std::vector<uniform_t> extract_uniform(const std::string& source);
+/* False if the source does not compile or declares uniforms outside HL_PARAMETERS, the registry is left untouched then.
+ * When scene_program is not null, scene() is also compiled to bytecode for the CPU tracer from the same AST
+ */
+bool extract_uniform(const std::string& source, uniform_registry& registry, scene_program_t* scene_program = nullptr);
 
-void copy_uniforms_value(std::vector<uniform_t>& old_uniforms, std::vector<uniform_t>& new_uniforms);
-void get_uniforms_locations(std::vector<uniform_t>& uniforms, uint32_t program);
+void copy_uniforms_value(const uniform_registry& old_uniforms, uniform_registry& new_uniforms);
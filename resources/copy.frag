@@ -2,13 +2,55 @@
 
 layout(location = 0) out vec4 color_out;
 
-layout(location = 1022) uniform uint screen_width;
-layout(location = 1023) uniform uint screen_height;
-layout(location = 1020) uniform float vignette_radius;
-layout(location = 1021) uniform float vignette_smoothness;
+// Mirrored by postprocess_block_t on the CPU
+layout(std140, binding = 1) uniform _hl_postprocess_parameters
+{
+	uint  screen_width;
+	uint  screen_height;
+	float vignette_radius;
+	float vignette_smoothness;
+	/* Part of the source image written by the raymarch, smaller than the screen when the resolution is scaled */
+	uint  render_width;
+	uint  render_height;
+};
 
 layout(binding = 0) uniform sampler2D source_image;
 
+/* Fetches the source image at a position in texels, never outside of the part written by the raymarch */
+vec3 fetch(in vec2 position)
+{
+	vec2 render_size = vec2(render_width, render_height);
+	return texture(source_image, clamp(position, vec2(0.5), render_size - 0.5) / vec2(textureSize(source_image, 0))).xyz;
+}
+
+// Catmull-Rom filter on 4x4 texels, with the bilinear filter merging the inner 2x2 and the four corners dropped,
+// since their weight is tiny: 5 fetches instead of 16, and much sharper than a bilinear upscale.
+// http://vec3.ca/bicubic-filtering-in-fewer-taps/
+vec3 upscale(in vec2 position)
+{
+	vec2 center = floor(position - 0.5) + 0.5;
+	vec2 f = position - center;
+
+	vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+	vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+	vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+	vec2 w3 = f * f * (-0.5 + 0.5 * f);
+
+	vec2 w12 = w1 + w2;
+	vec2 p0 = center - 1.0;
+	vec2 p3 = center + 2.0;
+	vec2 p12 = center + w2 / w12;
+
+	vec3 color = fetch(vec2(p12.x, p0.y)) * w12.x * w0.y +
+				 fetch(vec2(p0.x, p12.y)) * w0.x * w12.y +
+				 fetch(p12) * w12.x * w12.y +
+				 fetch(vec2(p3.x, p12.y)) * w3.x * w12.y +
+				 fetch(vec2(p12.x, p3.y)) * w12.x * w3.y;
+
+	float weight = w12.x * w0.y + w0.x * w12.y + w12.x * w12.y + w3.x * w12.y + w12.x * w3.y;
+	return max(color / weight, vec3(0.0));
+}
+
 void vignette(in vec2 tex_coord, inout vec3 color)
 {
 	float dist = distance(tex_coord, vec2(0.5, 0.5));
@@ -18,7 +60,12 @@ void vignette(in vec2 tex_coord, inout vec3 color)
 void main()
 {
 	vec2 tex_coord = gl_FragCoord.xy / vec2(screen_width, screen_height);
-	vec3 color = texture(source_image, tex_coord).xyz;
+
+	vec3 color;
+	if (render_width == screen_width && render_height == screen_height)
+		color = texture(source_image, tex_coord).xyz;
+	else
+		color = upscale(tex_coord * vec2(render_width, render_height));
 
 	vignette(tex_coord, color);
 